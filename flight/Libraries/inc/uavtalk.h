@@ -48,21 +48,46 @@ typedef struct {
 	uint32_t txErrors;
 	uint32_t rxErrors;
 	uint32_t rxCRC;
+	uint32_t relayedObjects;	/**< Frames forwarded by UAVTalkRelayPacket */
+	uint32_t relayedBytes;
 } UAVTalkStats;
 
 typedef void* UAVTalkConnection;
 
+//! Protocol capabilities, advertised in the telemetry stats objects
+#define UAVTALK_CAP_OBJ_BATCH  0x00000001	/**< Can decode batch frames */
+#define UAVTALK_CAP_FILE_WINDOW 0x00000002	/**< Honours window/chunk size in file requests */
+#define UAVTALK_CAP_OBJ_DUMP   0x00000004	/**< Answers object dump requests */
+#define UAVTALK_CAP_OBJ_CRC    0x00000008	/**< Can send settings as checksums in a dump */
+
+//! Everything this implementation supports
+#define UAVTALK_CAPABILITIES   (UAVTALK_CAP_OBJ_BATCH | UAVTALK_CAP_FILE_WINDOW | \
+		UAVTALK_CAP_OBJ_DUMP | UAVTALK_CAP_OBJ_CRC)
+
+//! Object ID handed to the request callback when the peer asks for a dump;
+//! the instance ID then carries the dump flags below
+#define UAVTALK_OBJID_DUMP_ALL 0xFFFFFFFF
+
+//! Send settings objects as checksums rather than data
+#define UAVTALK_DUMP_SETTINGS_CRC 0x0001
+
 typedef enum {UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, UAVTALK_STATE_SIZE, UAVTALK_STATE_OBJID, UAVTALK_STATE_INSTID,
 	      UAVTALK_STATE_DATA, UAVTALK_STATE_CS, UAVTALK_STATE_COMPLETE} UAVTalkRxState;
 
 // Public functions
-UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream, UAVTalkAckCb ackCallback, UAVTalkReqCb reqCallback, UAVTalkFileCb fileCallback);
+UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream, UAVTalkAckCb ackCallback, UAVTalkAckCb nackCallback, UAVTalkReqCb reqCallback, UAVTalkFileCb fileCallback);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkSendObjectBatched(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkFlushBatch(UAVTalkConnection connection);
+bool UAVTalkBatchPending(UAVTalkConnection connection);
 int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId, uint16_t instId);
+int32_t UAVTalkSendDumpComplete(UAVTalkConnection connectionHandle, uint32_t count);
+int32_t UAVTalkSendChecksum(UAVTalkConnection connectionHandle, UAVObjHandle obj);
 void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
 		int numbytes);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connection, uint8_t rxbyte);
+/* Relays packets received with UAVTalkProcessInputStreamQuiet() only */
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats);
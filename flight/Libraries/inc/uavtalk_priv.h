@@ -55,21 +55,46 @@ typedef struct {
 } uavtalk_max_header;
 #define UAVTALK_MAX_HEADER_LENGTH       sizeof(uavtalk_max_header)
 
+/* Older requesters only send offset and flags; chunk_len and window are
+ * only present when the request is 8 bytes long.
+ */
 struct filereq_data {
 	uint32_t offset;
 	uint16_t flags;
+	uint8_t chunk_len;
+	uint8_t window;
 } __attribute__((packed));
+#define UAVTALK_FILEREQ_LEGACY_LENGTH   6
 
 struct fileresp_data {
 	uint32_t offset;
 	uint8_t flags;
 } __attribute__((packed));
 
+//! Header of each object carried in a batch frame, followed by its data
+struct batch_record {
+	uint32_t objId;
+	uint16_t instId;
+	uint8_t length;
+} __attribute__((packed));
+
+//! Checksum of all instances of one object, carried in a checksum frame
+struct checksum_record {
+	uint32_t objId;
+	uint32_t crc;
+} __attribute__((packed));
+
 typedef uint8_t uavtalk_checksum;
 #define UAVTALK_CHECKSUM_LENGTH         sizeof(uavtalk_checksum)
 #define UAVTALK_MAX_PAYLOAD_LENGTH      (UAVOBJECTS_LARGEST + 1)
 #define UAVTALK_MIN_PACKET_LENGTH       UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH       UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
+/* Batches must fit our own receive buffer (so relays pass them on) and
+ * the GCS framing, which is limited to 255 bytes plus checksum.
+ */
+#define UAVTALK_MAX_BATCH_LENGTH        \
+	((UAVTALK_MIN_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH - 1) < 255 ? \
+	 (UAVTALK_MIN_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH - 1) : 255)
 
 //! State information for the UAVTalk parser
 typedef struct {
@@ -84,6 +109,7 @@ typedef struct {
 	int32_t rxCount;
 	UAVTalkRxState state;
 	uint16_t rxPacketLength;
+	bool inPlace; /**< The packet was parsed in the caller's buffer, not copied to rxBuffer */
 } UAVTalkInputProcessor;
 
 //! Information for the physical link
@@ -95,9 +121,16 @@ typedef struct {
 	uint8_t *rxBuffer;
 	uint32_t txSize;
 	uint8_t *txBuffer;
+	uint8_t *batchBuffer;
+	uint8_t batchType;	/**< Object batch or checksum frame */
+	uint16_t batchLength;
+	uint8_t batchCount;
+	UAVObjHandle batchFirstObj;
+	uint16_t batchFirstInstId;
 
 	UAVTalkOutputCb outCb;
 	UAVTalkAckCb ackCb;
+	UAVTalkAckCb nackCb;
 	UAVTalkReqCb reqCb;
 	UAVTalkFileCb fileCb;
 	void *cbCtx;
@@ -115,6 +148,9 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK   (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK       (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK      (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_BATCH (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_OBJ_DUMP  (UAVTALK_TYPE_VER | 0x06)
+#define UAVTALK_TYPE_OBJ_CRC   (UAVTALK_TYPE_VER | 0x07)
 #define UAVTALK_TYPE_FILEREQ   (UAVTALK_TYPE_VER | 0x08)
 #define UAVTALK_TYPE_FILEDATA  (UAVTALK_TYPE_VER | 0x09)
 #define UAVTALK_TYPE_OBJ_TS    (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
@@ -122,6 +158,10 @@ typedef struct {
 #define UAVTALK_FILEDATA_EOF   0x01
 #define UAVTALK_FILEDATA_LAST  0x02
 
+#define UAVTALK_FILE_DEFAULT_CHUNK   100
+#define UAVTALK_FILE_DEFAULT_WINDOW  6
+#define UAVTALK_FILE_MAX_WINDOW      16
+
 //macros
 #define CHECKCONHANDLE(handle,variable,failcommand) \
 	variable = (UAVTalkConnectionData*) handle; \
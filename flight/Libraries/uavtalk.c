@@ -44,20 +44,37 @@
 static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle objectId, uint16_t instId, uint8_t type);
 static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
-static int32_t receiveObject(UAVTalkConnectionData *connection);
+static int32_t receiveObject(UAVTalkConnectionData *connection, const uint8_t *data);
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId);
+static int32_t sendBareFrame(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
+static int32_t addToBatch(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t addChecksum(UAVTalkConnectionData *connection, UAVObjHandle obj);
+static int32_t flushBatch(UAVTalkConnectionData *connection);
+static int32_t receiveBatch(UAVTalkConnectionData *connection, const uint8_t *data);
+static UAVTalkRxState parseHeader(UAVTalkInputProcessor *iproc);
+static int32_t receivePacketInPlace(UAVTalkConnectionData *connection, const uint8_t *buf, int32_t len);
+
+//! Start of the payload of the frame held in the rx buffer
+static inline const uint8_t *rxPayload(UAVTalkConnectionData *connection)
+{
+	return connection->rxBuffer + UAVTALK_MIN_HEADER_LENGTH +
+		connection->iproc.instanceLength;
+}
 
 /**
  * Initialize the UAVTalk library
  * \param[in] connection UAVTalkConnection to be used
  * \param[in] outputStream Function pointer that is called to send a data buffer
  * \param[in] ackCallback A function to invoke when receiving an ack
+ * \param[in] nackCallback A function to invoke when receiving a nack; if
+ * NULL, nacks are passed to ackCallback
  * \parampin] fileCallback A function which provides file data upon demand
  * \return 0 Success
  * \return -1 Failure
  */
 UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream,
-		UAVTalkAckCb ackCallback, UAVTalkReqCb reqCallback,
+		UAVTalkAckCb ackCallback, UAVTalkAckCb nackCallback,
+		UAVTalkReqCb reqCallback,
 		UAVTalkFileCb fileCallback)
 {
 	// allocate object
@@ -70,6 +87,7 @@ UAVTalkConnection UAVTalkInitialize(void *ctx, UAVTalkOutputCb outputStream,
 		.cbCtx = ctx,
 		.outCb = outputStream,
 		.ackCb = ackCallback,
+		.nackCb = nackCallback,
 		.reqCb = reqCallback,
 		.fileCb = fileCallback,
 	};
@@ -147,6 +165,79 @@ int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjH
 	return objectTransaction(connection, obj, instId, UAVTALK_TYPE_OBJ_TS);
 }
 
+/**
+ * Queue the specified object for transmission in a batch frame.  Batched
+ * objects are never acked; the batch goes out when it fills, when
+ * UAVTalkFlushBatch() is called, or before any other frame is sent on the
+ * connection.  Only use this once the remote end has advertised
+ * UAVTALK_CAP_OBJ_BATCH.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectBatched(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	int32_t ret = 0;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (instId == UAVOBJ_ALL_INSTANCES) {
+		if (UAVObjIsSingleInstance(obj)) {
+			ret = addToBatch(connection, obj, 0);
+		} else {
+			uint32_t numInst = UAVObjGetNumInstances(obj);
+
+			for (uint32_t n = 0; n < numInst; ++n) {
+				if (addToBatch(connection, obj, n)) {
+					ret = -1;
+				}
+			}
+		}
+	} else {
+		ret = addToBatch(connection, obj, instId);
+	}
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Transmit any objects queued by UAVTalkSendObjectBatched().
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushBatch(UAVTalkConnection connectionHandle)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+	int32_t ret = flushBatch(connection);
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Check whether objects are waiting in the batch buffer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return true if UAVTalkFlushBatch() would send something
+ */
+bool UAVTalkBatchPending(UAVTalkConnection connectionHandle)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return false);
+
+	return connection->batchCount > 0;
+}
+
 /**
  * Execute the requested transaction on an object.
  * \param[in] connection UAVTalkConnection to be used
@@ -171,6 +262,116 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle
 	}
 }
 
+/**
+ * Work out the instance and payload layout of a packet once its type, size
+ * and object ID are known.
+ * \param[in] iproc Parser state, with rxPacketLength covering the header
+ * up to and including the object ID
+ * \return The state to continue in, or UAVTALK_STATE_ERROR
+ */
+static UAVTalkRxState parseHeader(UAVTalkInputProcessor *iproc)
+{
+	if (iproc->type == UAVTALK_TYPE_FILEREQ) {
+		/* Slightly overloaded from "normal" case.  Consume
+		 * 4 bytes of offset and 2 bytes of flags, optionally
+		 * followed by chunk length and window size.
+		 */
+
+		iproc->instanceLength = 0;
+		iproc->length = iproc->packet_size - iproc->rxPacketLength;
+
+		if ((iproc->length != UAVTALK_FILEREQ_LEGACY_LENGTH) &&
+				(iproc->length != sizeof(struct filereq_data))) {
+			return UAVTALK_STATE_ERROR;
+		}
+
+		return UAVTALK_STATE_DATA;
+	}
+
+	if (iproc->type == UAVTALK_TYPE_OBJ_BATCH) {
+		/* The object ID field holds the record count, and
+		 * the records are the payload.
+		 */
+		iproc->obj = NULL;
+		iproc->instId = 0;
+		iproc->instanceLength = 0;
+		iproc->length = iproc->packet_size - iproc->rxPacketLength;
+
+		if ((iproc->length == 0) ||
+				(iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH)) {
+			return UAVTALK_STATE_ERROR;
+		}
+
+		return UAVTALK_STATE_DATA;
+	}
+
+	// Search for object.
+	iproc->obj = UAVObjGetByID(iproc->objId);
+
+	// Determine data length
+	if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK ||
+			iproc->type == UAVTALK_TYPE_NACK || iproc->type == UAVTALK_TYPE_OBJ_DUMP) {
+		iproc->length = 0;
+		iproc->instanceLength = 0;
+
+		/* Length is always pretty much expected to be 0
+		 * here, but it can be 2 if it's a multiple inst
+		 * obj requested.  Don't peer into metadata to
+		 * figure this out-- use the packet length
+		 * [so we can properly NAK objects we don't know]
+		 */
+		if ((iproc->packet_size - iproc->rxPacketLength) == 2) {
+			iproc->instanceLength = 2;
+		} else if (iproc->length > 0) {
+			return UAVTALK_STATE_ERROR;
+		}
+	} else {
+		if (iproc->obj) {
+			iproc->length = UAVObjGetNumBytes(iproc->obj);
+			iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
+		} else {
+			// We don't know if it's a multi-instance object, so just assume it's 0.
+			iproc->instanceLength = 0;
+			iproc->length = iproc->packet_size - iproc->rxPacketLength;
+		}
+	}
+
+	// Check length and determine next state
+	if (iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH) {
+		return UAVTALK_STATE_ERROR;
+	}
+
+	// Check the lengths match
+	if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
+		if (iproc->instanceLength == 0) {
+			// Try again with a 2 inst len
+			// to accept LP's fork of
+			// protocol.
+			iproc->instanceLength = 2;
+		}
+	}
+
+	if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
+		return UAVTALK_STATE_ERROR;
+	}
+
+	iproc->instId = 0;
+	if (iproc->type == UAVTALK_TYPE_NACK) {
+		// If this is a NACK, we skip to Checksum
+		return UAVTALK_STATE_CS;
+	}
+	// Check if this is a single instance object (i.e. if the instance ID field is coming next)
+	else if (iproc->instanceLength) {
+		return UAVTALK_STATE_INSTID;
+	}
+
+	// If there is a payload get it, otherwise receive checksum
+	if (iproc->length > 0)
+		return UAVTALK_STATE_DATA;
+	else
+		return UAVTALK_STATE_CS;
+}
+
 /**
  * Process an byte from the telemetry stream.
  * \param[in] connection UAVTalkConnection to be used
@@ -195,6 +396,10 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 	if (iproc->rxPacketLength < 0xffff)
 		iproc->rxPacketLength++;   // update packet byte count
 
+	// Keep the whole frame, so it can be relayed without re-packing
+	if (iproc->rxPacketLength <= UAVTALK_MAX_PACKET_LENGTH)
+		connection->rxBuffer[iproc->rxPacketLength - 1] = rxbyte;
+
 	// Receive state machine
 	switch (iproc->state)
 	{
@@ -206,6 +411,8 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 		iproc->cs = PIOS_CRC_updateByte(0, rxbyte);
 
 		iproc->rxPacketLength = 1;
+		iproc->inPlace = false;
+		connection->rxBuffer[0] = rxbyte;
 
 		iproc->state = UAVTALK_STATE_TYPE;
 		break;
@@ -262,93 +469,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 		if (iproc->rxCount < 4)
 			break;
 
-		if (iproc->type == UAVTALK_TYPE_FILEREQ) {
-			/* Slightly overloaded from "normal" case.  Consume
-			 * 4 bytes of offset and 2 bytes of flags.
-			 */
-
-			iproc->instanceLength = 0;
-			iproc->rxCount = 0;
-			iproc->length = 6;
-
-			if ((iproc->packet_size - iproc->rxPacketLength) !=
-					iproc->length) {
-				iproc->state = UAVTALK_STATE_ERROR;
-				break;
-			}
-
-			iproc->state = UAVTALK_STATE_DATA;
-
-			break;
-		}
-
-		// Search for object.
-		iproc->obj = UAVObjGetByID(iproc->objId);
-
-		// Determine data length
-		if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
-			iproc->length = 0;
-			iproc->instanceLength = 0;
-
-			/* Length is always pretty much expected to be 0
-			 * here, but it can be 2 if it's a multiple inst
-			 * obj requested.  Don't peer into metadata to
-			 * figure this out-- use the packet length
-			 * [so we can properly NAK objects we don't know]
-			 */
-			if ((iproc->packet_size - iproc->rxPacketLength) == 2) {
-				iproc->instanceLength = 2;
-			} else if (iproc->length > 0) {
-				iproc->state = UAVTALK_STATE_ERROR;
-				break; 
-			}
-		} else {
-			if (iproc->obj) {
-				iproc->length = UAVObjGetNumBytes(iproc->obj);
-				iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
-			} else {
-				// We don't know if it's a multi-instance object, so just assume it's 0.
-				iproc->instanceLength = 0;
-				iproc->length = iproc->packet_size - iproc->rxPacketLength;
-			}
-		}
-
-		// Check length and determine next state
-		if (iproc->length >= UAVTALK_MAX_PAYLOAD_LENGTH) {
-			iproc->state = UAVTALK_STATE_ERROR;
-			break;
-		}
-
-		// Check the lengths match
-		if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
-			if (iproc->instanceLength == 0) {
-				// Try again with a 2 inst len
-				// to accept LP's fork of
-				// protocol.
-				iproc->instanceLength = 2;
-			}
-		}
-
-		if ((iproc->rxPacketLength + iproc->instanceLength + iproc->length) != iproc->packet_size) { // packet error - mismatched packet size
-			iproc->state = UAVTALK_STATE_ERROR;
-			break;
-		}
-
-		iproc->instId = 0;
-		if (iproc->type == UAVTALK_TYPE_NACK) {
-			// If this is a NACK, we skip to Checksum
-			iproc->state = UAVTALK_STATE_CS;
-		}
-		// Check if this is a single instance object (i.e. if the instance ID field is coming next)
-		else if (iproc->instanceLength) {
-			iproc->state = UAVTALK_STATE_INSTID;
-		} else {
-			// If there is a payload get it, otherwise receive checksum
-			if (iproc->length > 0)
-				iproc->state = UAVTALK_STATE_DATA;
-			else
-				iproc->state = UAVTALK_STATE_CS;
-		}
+		iproc->state = parseHeader(iproc);
 		iproc->rxCount = 0;
 
 		break;
@@ -378,8 +499,7 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 		// update the CRC
 		iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
 
-		connection->rxBuffer[iproc->rxCount++] = rxbyte;
-		if (iproc->rxCount < iproc->length)
+		if (++iproc->rxCount < iproc->length)
 			break;
 
 		iproc->state = UAVTALK_STATE_CS;
@@ -415,10 +535,86 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 }
 
 /**
- * Process an byte from the telemetry stream.
+ * Validate and handle a packet directly from a receive buffer, without
+ * running it through the byte-at-a-time state machine.
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] rxbyte Received byte
- * \return UAVTalkRxState
+ * \param[in] buf Received bytes, starting with a sync byte
+ * \param[in] len Number of bytes available at buf
+ * \return Number of bytes consumed by a valid packet
+ * \return 0 if the packet is not complete in the buffer
+ * \return -1 if this is not a valid packet
+ */
+static int32_t receivePacketInPlace(UAVTalkConnectionData *connection,
+		const uint8_t *buf, int32_t len)
+{
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+
+	if (len < (int32_t) UAVTALK_MIN_HEADER_LENGTH) {
+		return 0;
+	}
+
+	if ((buf[1] & UAVTALK_TYPE_MASK) != UAVTALK_TYPE_VER) {
+		return -1;
+	}
+
+	uint16_t packet_size = buf[2] | (buf[3] << 8);
+
+	if (packet_size < UAVTALK_MIN_HEADER_LENGTH ||
+			packet_size > UAVTALK_MAX_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH) {
+		return -1;
+	}
+
+	if (len < packet_size + UAVTALK_CHECKSUM_LENGTH) {
+		return 0;
+	}
+
+	iproc->type = buf[1];
+	iproc->packet_size = packet_size;
+	iproc->objId = buf[4] | (buf[5] << 8) | (buf[6] << 16) |
+		((uint32_t) buf[7] << 24);
+	iproc->rxPacketLength = UAVTALK_MIN_HEADER_LENGTH;
+
+	UAVTalkRxState next = parseHeader(iproc);
+
+	if (next == UAVTALK_STATE_ERROR) {
+		return -1;
+	}
+
+	const uint8_t *data = buf + UAVTALK_MIN_HEADER_LENGTH;
+
+	if (next == UAVTALK_STATE_INSTID) {
+		iproc->instId = data[0] | (data[1] << 8);
+	}
+
+	data += iproc->instanceLength;
+
+	iproc->cs = PIOS_CRC_updateCRC(0, buf, packet_size);
+
+	if (iproc->cs != buf[packet_size]) { // packet error - faulty CRC
+		connection->stats.rxCRC++;
+		return -1;
+	}
+
+	iproc->rxPacketLength = packet_size + UAVTALK_CHECKSUM_LENGTH;
+	iproc->state = UAVTALK_STATE_COMPLETE;
+	iproc->inPlace = true;
+
+	connection->stats.rxBytes += iproc->rxPacketLength;
+	connection->stats.rxObjectBytes += iproc->length;
+	connection->stats.rxObjects++;
+
+	receiveObject(connection, data);
+
+	return iproc->rxPacketLength;
+}
+
+/**
+ * Process a buffer of bytes from the telemetry stream.  Packets that lie
+ * entirely within the buffer are checked and handled in place; packets
+ * split across calls go through UAVTalkProcessInputStreamQuiet().
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] rxbytes Received bytes
+ * \param[in] numbytes Number of received bytes
  */
 void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbytes,
 		int numbytes)
@@ -427,13 +623,55 @@ void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxby
 
 	CHECKCONHANDLE(connectionHandle,connection,return);
 
-	for (int i = 0; i < numbytes; i++) {
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+	int i = 0;
+
+	while (i < numbytes) {
+		if (iproc->state == UAVTALK_STATE_SYNC ||
+				iproc->state == UAVTALK_STATE_COMPLETE ||
+				iproc->state == UAVTALK_STATE_ERROR) {
+			if (iproc->state == UAVTALK_STATE_ERROR) {
+				connection->stats.rxErrors++;
+			}
+
+			iproc->state = UAVTALK_STATE_SYNC;
+
+			const uint8_t *sync = memchr(rxbytes + i, UAVTALK_SYNC_VAL,
+					numbytes - i);
+
+			if (!sync) {
+				connection->stats.rxBytes += numbytes - i;
+				return;
+			}
+
+			int skipped = sync - (rxbytes + i);
+
+			connection->stats.rxBytes += skipped;
+			i += skipped;
+
+			int32_t used = receivePacketInPlace(connection,
+					rxbytes + i, numbytes - i);
+
+			if (used > 0) {
+				i += used;
+				continue;
+			} else if (used < 0) {
+				// Not a packet; resync from the next byte
+				connection->stats.rxErrors++;
+				connection->stats.rxBytes++;
+				i++;
+				continue;
+			}
+
+			// Incomplete; the state machine carries it to the next call
+		}
+
 		UAVTalkRxState state =
 			UAVTalkProcessInputStreamQuiet(connectionHandle,
-					rxbytes[i]);
+					rxbytes[i++]);
 
 		if (state == UAVTALK_STATE_COMPLETE) {
-			receiveObject(connection);
+			receiveObject(connection, rxPayload(connection));
 		}
 	}
 }
@@ -441,10 +679,14 @@ void UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxby
 /**
  * Send a parsed packet received on one connection handle out on a different connection handle.
  * The packet must be in a complete state, meaning it is completed parsing.
- * The packet is re-assembled from the component parts into a complete message and sent.
+ * The frame is forwarded exactly as it was received and validated, straight
+ * from the input connection's receive buffer; it is not re-packed.
  * This can be used to relay packets from one UAVTalk connection to another.
- * \param[in] connection UAVTalkConnection to be used
- * \param[in] rxbyte Received byte
+ * Only packets received with UAVTalkProcessInputStreamQuiet() can be relayed:
+ * UAVTalkProcessInputStream() parses whole packets in the caller's buffer
+ * without copying them to the receive buffer, and those are refused.
+ * \param[in] inConnectionHandle UAVTalkConnection the packet was received on
+ * \param[in] outConnectionHandle UAVTalkConnection to send the packet on
  * \return 0 Success
  * \return -1 Failure
  */
@@ -455,8 +697,8 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
 	CHECKCONHANDLE(inConnectionHandle, inConnection, return -1);
 	UAVTalkInputProcessor *inIproc = &inConnection->iproc;
 
-	// The input packet must be completely parsed.
-	if (inIproc->state != UAVTALK_STATE_COMPLETE) {
+	// The input packet must be completely parsed, into the rx buffer.
+	if (inIproc->state != UAVTALK_STATE_COMPLETE || inIproc->inPlace) {
 		return -1;
 	}
 
@@ -469,50 +711,29 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
 		return -1;
 	}
 
+	// The frame, including its checksum, is intact in the rx buffer
+	int32_t frameLength = inIproc->packet_size + UAVTALK_CHECKSUM_LENGTH;
+
 	// Lock
 	PIOS_Recursive_Mutex_Lock(outConnection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
-	outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
-	// Setup type
-	outConnection->txBuffer[1] = inIproc->type;
-	// next 2 bytes are reserved for data length (inserted here later)
-	// Setup object ID
-	outConnection->txBuffer[4] = (uint8_t)(inIproc->objId & 0xFF);
-	outConnection->txBuffer[5] = (uint8_t)((inIproc->objId >> 8) & 0xFF);
-	outConnection->txBuffer[6] = (uint8_t)((inIproc->objId >> 16) & 0xFF);
-	outConnection->txBuffer[7] = (uint8_t)((inIproc->objId >> 24) & 0xFF);
-	int32_t headerLength = 8;
-
-	if (inIproc->instanceLength) {
-		// Setup instance ID
-		outConnection->txBuffer[8] = (uint8_t)(inIproc->instId & 0xFF);
-		outConnection->txBuffer[9] = (uint8_t)((inIproc->instId >> 8) & 0xFF);
-		headerLength = 10;
-	}
-
-	// Copy data (if any)
-	if (inIproc->length > 0) {
-		memcpy(&outConnection->txBuffer[headerLength], inConnection->rxBuffer, inIproc->length);
-	}
-
-	// Store the packet length
-	outConnection->txBuffer[2] = (uint8_t)((headerLength + inIproc->length) & 0xFF);
-	outConnection->txBuffer[3] = (uint8_t)(((headerLength + inIproc->length) >> 8) & 0xFF);
-
-	// Copy the checksum
-	outConnection->txBuffer[headerLength + inIproc->length] = inIproc->cs;
+	// Anything batched must go out ahead of the relayed frame
+	flushBatch(outConnection);
 
 	// Send the buffer.
-	int32_t rc = (*outConnection->outCb)(outConnection->cbCtx, outConnection->txBuffer, headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH);
+	int32_t rc = (*outConnection->outCb)(outConnection->cbCtx, inConnection->rxBuffer, frameLength);
 
 	// Update stats
 	outConnection->stats.txBytes += (rc > 0) ? rc : 0;
 
 	// evaluate return value before releasing the lock
 	int32_t ret = 0;
-	if (rc != (int32_t)(headerLength + inIproc->length + UAVTALK_CHECKSUM_LENGTH)) {
+	if (rc != frameLength) {
 		outConnection->stats.txErrors++;
 		ret = -1;
+	} else {
+		outConnection->stats.relayedObjects++;
+		outConnection->stats.relayedBytes += frameLength;
 	}
 
 	// Release lock
@@ -539,7 +760,7 @@ int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle)
 		return -1;
 	}
 
-	return receiveObject(connection);
+	return receiveObject(connection, rxPayload(connection));
 }
 
 /**
@@ -573,13 +794,14 @@ uint32_t UAVTalkGetPacketInstId(UAVTalkConnection connectionHandle)
 /**
  * Handles a request for file data.
  * \param[in] connection The connection on which a request was just received.
+ * \param[in] data The request payload.
  */
-static void handleFileReq(UAVTalkConnectionData *connection)
+static void handleFileReq(UAVTalkConnectionData *connection, const uint8_t *data)
 {
 	UAVTalkInputProcessor *iproc = &connection->iproc;
 	uint32_t file_id = iproc->objId;
 
-	struct filereq_data *req = (struct filereq_data *) connection->rxBuffer;
+	const struct filereq_data *req = (const struct filereq_data *) data;
 
 	/* printf("Got filereq for file_id=%08x offs=%d\n", file_id, req->offset); */
 
@@ -588,6 +810,8 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 	 */
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
+	flushBatch(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = UAVTALK_TYPE_FILEDATA;
 	// data length inserted here below
@@ -605,7 +829,39 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 
 	uint32_t file_offset = req->offset;
 
-	for (int i = 0; ; i++) {
+	/* Requesters that know about windowing pick the chunk size and how
+	 * many chunks to stream before waiting for the next request.  Clamp
+	 * to what fits the tx buffer and the 8 bit frame length.
+	 */
+	uint32_t chunk_len = UAVTALK_FILE_DEFAULT_CHUNK;
+	uint32_t window = UAVTALK_FILE_DEFAULT_WINDOW;
+
+	if (iproc->length == sizeof(*req)) {
+		uint32_t max_chunk = UAVTALK_MAX_PACKET_LENGTH -
+			UAVTALK_CHECKSUM_LENGTH - data_offs;
+
+		if (max_chunk > 255 - data_offs) {
+			max_chunk = 255 - data_offs;
+		}
+
+		if (req->chunk_len) {
+			chunk_len = req->chunk_len;
+		}
+
+		if (chunk_len > max_chunk) {
+			chunk_len = max_chunk;
+		}
+
+		window = req->window;
+
+		if (window > UAVTALK_FILE_MAX_WINDOW) {
+			window = UAVTALK_FILE_MAX_WINDOW;
+		} else if (window == 0) {
+			window = 1;
+		}
+	}
+
+	for (uint32_t i = 0; ; i++) {
 		resp->offset = file_offset;
 		resp->flags = 0;
 
@@ -614,7 +870,7 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 		if (connection->fileCb) {
 			cb_numbytes = connection->fileCb(connection->cbCtx,
 				connection->txBuffer + data_offs,
-				file_id, file_offset, 100);
+				file_id, file_offset, chunk_len);
 		}
 
 		uint8_t total_len = data_offs;
@@ -624,7 +880,7 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 
 			file_offset += cb_numbytes;
 
-			if (i == 5) {	/* 6 messages per chunk */
+			if (i == window - 1) {
 				resp->flags = UAVTALK_FILEDATA_LAST;
 			} else {
 				resp->flags = 0;
@@ -661,16 +917,13 @@ static void handleFileReq(UAVTalkConnectionData *connection)
 
 /**
  * Receive an object. This function process objects received through the telemetry stream.
+ * The packet type, object and instance are taken from the parser state.
  * \param[in] connection UAVTalkConnection to be used
- * \param[in] type Type of received message (UAVTALK_TYPE_OBJ, UAVTALK_TYPE_OBJ_REQ, UAVTALK_TYPE_OBJ_ACK, UAVTALK_TYPE_ACK, UAVTALK_TYPE_NACK)
- * \param[in] objId ID of the object to work on
- * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
- * \param[in] data Data buffer
- * \param[in] length Buffer length
+ * \param[in] data The packet payload
  * \return 0 Success
  * \return -1 Failure
  */
-static int32_t receiveObject(UAVTalkConnectionData *connection)
+static int32_t receiveObject(UAVTalkConnectionData *connection, const uint8_t *data)
 {
 	int32_t ret = 0;
 
@@ -685,14 +938,19 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 	/* Handle ACK/NACK --- don't bother to look up IDs etc for these
 	 * because we don't need it.
 	 *
-	 * Treat NACKs and ACKs identically -- ground has done all it wants
-	 * with them.  This incurs a small penalty from calling the callback
-	 * when GCS is a mismatched version and likes NACKing us, but ensures
-	 * that we don't start blocking the telemetry session for an ACK that
-	 * will never come.
+	 * Unless the owner wants to hear about NACKs separately, treat NACKs
+	 * and ACKs identically -- ground has done all it wants with them.
+	 * This incurs a small penalty from calling the callback when GCS is
+	 * a mismatched version and likes NACKing us, but ensures that we
+	 * don't start blocking the telemetry session for an ACK that will
+	 * never come.
 	 */
 
-	if ((type == UAVTALK_TYPE_NACK) || (type == UAVTALK_TYPE_ACK)) {
+	if ((type == UAVTALK_TYPE_NACK) && connection->nackCb) {
+		connection->nackCb(connection->cbCtx, objId, instId);
+
+		return 0;
+	} else if ((type == UAVTALK_TYPE_NACK) || (type == UAVTALK_TYPE_ACK)) {
 		if (connection->ackCb) {
 			connection->ackCb(connection->cbCtx, objId, instId);
 		}
@@ -704,16 +962,33 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 			return 0;
 		}
 
+		return -1;
+	} else if (type == UAVTALK_TYPE_OBJ_DUMP) {
+		/* The object ID field holds the dump flags; the owner
+		 * streams everything and answers with
+		 * UAVTalkSendDumpComplete when done.
+		 */
+		if (connection->reqCb) {
+			connection->reqCb(connection->cbCtx,
+					UAVTALK_OBJID_DUMP_ALL,
+					(uint16_t) objId);
+			return 0;
+		}
+
 		return -1;
 	}
 
 	/* File request data is a special case. */
 	if (type == UAVTALK_TYPE_FILEREQ) {
-		handleFileReq(connection);
+		handleFileReq(connection, data);
 
 		return 0;
 	}
 
+	if (type == UAVTALK_TYPE_OBJ_BATCH) {
+		return receiveBatch(connection, data);
+	}
+
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
 	// Process message type
@@ -722,7 +997,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		// All instances, not allowed for OBJ messages
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
-			UAVObjUnpack(obj, instId, connection->rxBuffer);
+			UAVObjUnpack(obj, instId, data);
 		} else {
 			ret = -1;
 		}
@@ -731,7 +1006,7 @@ static int32_t receiveObject(UAVTalkConnectionData *connection)
 		// All instances, not allowed for OBJ_ACK messages
 		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
 			// Unpack object, if the instance does not exist it will be created!
-			if (UAVObjUnpack(obj, instId, connection->rxBuffer) == 0) {
+			if (UAVObjUnpack(obj, instId, data) == 0) {
 				// Transmit ACK
 				sendObject(connection, obj, instId, UAVTALK_TYPE_ACK);
 			} else {
@@ -836,6 +1111,9 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
 
+	// Keep frames in the order they were requested
+	flushBatch(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = type;
 	// data length inserted here below
@@ -909,16 +1187,71 @@ int32_t UAVTalkSendNack(UAVTalkConnection connectionHandle, uint32_t objId,
 	return sendNack(connection, objId, instId);
 }
 
+/**
+ * Mark the end of an object dump.  The object ID field carries the number
+ * of data objects the dump covered, so the receiver can tell whether it
+ * missed any.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] count Number of data objects sent
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendDumpComplete(UAVTalkConnection connectionHandle,
+		uint32_t count)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	return sendBareFrame(connection, UAVTALK_TYPE_OBJ_DUMP, count, 0);
+}
+
+/**
+ * Queue the checksum of an object for a checksum frame.  Checksum frames go
+ * out like batches: when full, or when UAVTalkFlushBatch is called or
+ * another frame is sent.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to checksum, all instances
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendChecksum(UAVTalkConnection connectionHandle,
+		UAVObjHandle obj)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t ret = addChecksum(connection, obj);
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId,
 		uint16_t instId)
+{
+	return sendBareFrame(connection, UAVTALK_TYPE_NACK, objId, instId);
+}
+
+/**
+ * Send a frame that has only a header: an object ID and an optional
+ * instance ID.  Any pending batch goes out first to keep ordering.
+ */
+static int32_t sendBareFrame(UAVTalkConnectionData *connection, uint8_t type,
+		uint32_t objId, uint16_t instId)
 {
 	int32_t dataOffset;
 
 	if (!connection->outCb) return -1;
 
 	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	flushBatch(connection);
+
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
-	connection->txBuffer[1] = UAVTALK_TYPE_NACK;
+	connection->txBuffer[1] = type;
 	// data length inserted here below
 	connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
 	connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
@@ -956,6 +1289,247 @@ static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId,
 	return 0;
 }
 
+/**
+ * Append one object instance to the batch buffer, flushing first if it
+ * does not fit.  Objects too large for a batch are sent on their own.
+ * Must be called with the connection lock held.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t addToBatch(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+	const uint16_t header_len = UAVTALK_MIN_HEADER_LENGTH;
+	uint16_t length = UAVObjGetNumBytes(obj);
+	uint16_t rec_len = sizeof(struct batch_record) + length;
+
+	if (header_len + rec_len > UAVTALK_MAX_BATCH_LENGTH) {
+		return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	if (!connection->batchBuffer) {
+		connection->batchBuffer = PIOS_malloc(UAVTALK_MAX_BATCH_LENGTH +
+				UAVTALK_CHECKSUM_LENGTH);
+
+		if (!connection->batchBuffer) {
+			return sendSingleObject(connection, obj, instId,
+					UAVTALK_TYPE_OBJ);
+		}
+	}
+
+	if (connection->batchCount &&
+			((connection->batchType != UAVTALK_TYPE_OBJ_BATCH) ||
+			 (connection->batchLength + rec_len > UAVTALK_MAX_BATCH_LENGTH))) {
+		flushBatch(connection);
+	}
+
+	if (!connection->batchCount) {
+		connection->batchType = UAVTALK_TYPE_OBJ_BATCH;
+		connection->batchLength = header_len;
+		connection->batchFirstObj = obj;
+		connection->batchFirstInstId = instId;
+	}
+
+	uint8_t *pos = connection->batchBuffer + connection->batchLength;
+
+	struct batch_record rec = {
+		.objId = UAVObjGetID(obj),
+		.instId = instId,
+		.length = length,
+	};
+
+	if (UAVObjPack(obj, instId, pos + sizeof(rec)) < 0) {
+		return -1;
+	}
+
+	memcpy(pos, &rec, sizeof(rec));
+
+	connection->batchLength += rec_len;
+	connection->batchCount++;
+
+	return 0;
+}
+
+/**
+ * Send the batch buffer as one frame.  A batch holding a single object is
+ * sent as a plain object frame instead, as that is smaller on the wire.
+ * Must be called with the connection lock held.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushBatch(UAVTalkConnectionData *connection)
+{
+	uint8_t count = connection->batchCount;
+	uint16_t length = connection->batchLength;
+
+	if (!count) {
+		return 0;
+	}
+
+	connection->batchCount = 0;
+
+	if ((count == 1) && (connection->batchType == UAVTALK_TYPE_OBJ_BATCH)) {
+		return sendSingleObject(connection, connection->batchFirstObj,
+				connection->batchFirstInstId, UAVTALK_TYPE_OBJ);
+	}
+
+	if (!connection->outCb) return -1;
+
+	uint8_t *buf = connection->batchBuffer;
+
+	buf[0] = UAVTALK_SYNC_VAL;  // sync byte
+	buf[1] = connection->batchType;
+	buf[2] = (uint8_t)(length & 0xFF);
+	buf[3] = (uint8_t)((length >> 8) & 0xFF);
+	// Record count goes where the object ID normally would
+	buf[4] = count;
+	buf[5] = 0;
+	buf[6] = 0;
+	buf[7] = 0;
+
+	buf[length] = PIOS_CRC_updateCRC(0, buf, length);
+
+	uint16_t tx_msg_len = length + UAVTALK_CHECKSUM_LENGTH;
+	int32_t rc = (*connection->outCb)(connection->cbCtx, buf, tx_msg_len);
+
+	if (rc != tx_msg_len) {
+		connection->stats.txErrors++;
+		return -1;
+	}
+
+	connection->stats.txBytes += tx_msg_len;
+
+	if (connection->batchType == UAVTALK_TYPE_OBJ_BATCH) {
+		connection->stats.txObjects += count;
+		connection->stats.txObjectBytes += length -
+			UAVTALK_MIN_HEADER_LENGTH -
+			count * sizeof(struct batch_record);
+	}
+
+	return 0;
+}
+
+/**
+ * Append the checksum of an object to the pending checksum frame, flushing
+ * first if the batch buffer holds objects or is full.  The checksum is a
+ * CRC32 over the packed data of every instance, in instance order.
+ * Must be called with the connection lock held.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to checksum
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t addChecksum(UAVTalkConnectionData *connection, UAVObjHandle obj)
+{
+	const uint16_t header_len = UAVTALK_MIN_HEADER_LENGTH;
+	const uint16_t rec_len = sizeof(struct checksum_record);
+	uint32_t length = UAVObjGetNumBytes(obj);
+	uint16_t numInst = UAVObjGetNumInstances(obj);
+	uint32_t crc = 0;
+
+	/* The tx buffer fits any object and is ours while locked */
+	for (uint16_t n = 0; n < numInst; n++) {
+		if (UAVObjPack(obj, n, connection->txBuffer) < 0) {
+			return -1;
+		}
+
+		crc = PIOS_CRC32_updateCRC(crc, connection->txBuffer, length);
+	}
+
+	if (!connection->batchBuffer) {
+		connection->batchBuffer = PIOS_malloc(UAVTALK_MAX_BATCH_LENGTH +
+				UAVTALK_CHECKSUM_LENGTH);
+
+		if (!connection->batchBuffer) {
+			return -1;
+		}
+	}
+
+	if (connection->batchCount &&
+			((connection->batchType != UAVTALK_TYPE_OBJ_CRC) ||
+			 (connection->batchLength + rec_len > UAVTALK_MAX_BATCH_LENGTH))) {
+		flushBatch(connection);
+	}
+
+	if (!connection->batchCount) {
+		connection->batchType = UAVTALK_TYPE_OBJ_CRC;
+		connection->batchLength = header_len;
+	}
+
+	struct checksum_record rec = {
+		.objId = UAVObjGetID(obj),
+		.crc = crc,
+	};
+
+	memcpy(connection->batchBuffer + connection->batchLength, &rec,
+			sizeof(rec));
+
+	connection->batchLength += rec_len;
+	connection->batchCount++;
+
+	return 0;
+}
+
+/**
+ * Unpack all objects carried by a received batch frame.  Records for
+ * unknown objects are skipped.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] data The batch payload
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveBatch(UAVTalkConnectionData *connection, const uint8_t *data)
+{
+	UAVTalkInputProcessor *iproc = &connection->iproc;
+	const uint8_t *pos = data;
+	const uint8_t *end = pos + iproc->length;
+	uint32_t count = 0;
+	int32_t ret = 0;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	while ((end - pos) >= (int32_t) sizeof(struct batch_record)) {
+		struct batch_record rec;
+
+		memcpy(&rec, pos, sizeof(rec));
+		pos += sizeof(rec);
+
+		if (rec.length > (end - pos)) {
+			break;
+		}
+
+		UAVObjHandle obj = UAVObjGetByID(rec.objId);
+
+		if (obj && (rec.instId != UAVOBJ_ALL_INSTANCES) &&
+				(rec.length == UAVObjGetNumBytes(obj))) {
+			UAVObjUnpack(obj, rec.instId, pos);
+		} else {
+			connection->stats.rxErrors++;
+			ret = -1;
+		}
+
+		pos += rec.length;
+		count++;
+	}
+
+	if ((pos != end) || (count != iproc->objId)) {
+		connection->stats.rxErrors++;
+		ret = -1;
+	}
+
+	/* The frame itself was already counted once */
+	if (count > 1) {
+		connection->stats.rxObjects += count - 1;
+	}
+
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
 /**
  * @}
  * @}
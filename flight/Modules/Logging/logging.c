@@ -184,7 +184,7 @@ int32_t LoggingInitialize(void)
 
 	// Initialise UAVTalk
 	uavTalkCon = UAVTalkInitialize(NULL, &send_data_nonblock,
-			NULL, NULL, NULL);
+			NULL, NULL, NULL, NULL);
 
 	if (!uavTalkCon) {
 		module_enabled = false;
@@ -480,6 +480,9 @@ static int32_t send_data_nonblock(void *ctx, uint8_t *data, int32_t length)
 
 /**
  * @brief Callback for adding an object to the logging queue
+ *
+ * May run from the UAVO event dispatcher, so the object data is not passed
+ * in; UAVTalk reads the current data when it serializes the object.
  * @param ev the event
  */
 static void obj_updated_callback(const UAVObjEvent *ev, void *cb_ctx,
@@ -578,10 +581,10 @@ static void register_object(UAVObjHandle obj)
 
 	if (period == 1) {
 		// log every update
-		UAVObjConnectCallback(obj, obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED);
+		UAVObjConnectCallbackAsync(obj, obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 0, UAVOBJ_EV_OVERFLOW_COALESCE);
 	} else {
 		// log updates throttled
-		UAVObjConnectCallbackThrottled(obj, obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, period);
+		UAVObjConnectCallbackAsync(obj, obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 }
 
@@ -594,67 +597,67 @@ static void register_default_profile()
 	uint16_t min_period = MAX(get_minimum_logging_period(), 10);
 
 	// Objects for which we log all changes (use 100Hz to limit max data rate)
-	UAVObjConnectCallbackThrottled(FlightStatusHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10);
-	UAVObjConnectCallbackThrottled(SystemAlarmsHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10);
+	UAVObjConnectCallbackAsync(FlightStatusHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10, UAVOBJ_EV_OVERFLOW_COALESCE);
+	UAVObjConnectCallbackAsync(SystemAlarmsHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10, UAVOBJ_EV_OVERFLOW_COALESCE);
 	if (WaypointActiveHandle()) {
-		UAVObjConnectCallbackThrottled(WaypointActiveHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10);
+		UAVObjConnectCallbackAsync(WaypointActiveHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
 	if (SystemIdentHandle()){
-		UAVObjConnectCallbackThrottled(SystemIdentHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10);
+		UAVObjConnectCallbackAsync(SystemIdentHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
 	// Log fast
-	UAVObjConnectCallbackThrottled(AccelsHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, min_period);
-	UAVObjConnectCallbackThrottled(GyrosHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, min_period);
+	UAVObjConnectCallbackAsync(AccelsHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
+	UAVObjConnectCallbackAsync(GyrosHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 
 	// Log a bit slower
-	UAVObjConnectCallbackThrottled(AttitudeActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period);
+	UAVObjConnectCallbackAsync(AttitudeActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 
 	if (MagnetometerHandle()) {
-		UAVObjConnectCallbackThrottled(MagnetometerHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period);
+		UAVObjConnectCallbackAsync(MagnetometerHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
-	UAVObjConnectCallbackThrottled(ManualControlCommandHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period);
-	UAVObjConnectCallbackThrottled(ActuatorDesiredHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period);
-	UAVObjConnectCallbackThrottled(StabilizationDesiredHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period);
+	UAVObjConnectCallbackAsync(ManualControlCommandHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
+	UAVObjConnectCallbackAsync(ActuatorDesiredHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
+	UAVObjConnectCallbackAsync(StabilizationDesiredHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 5 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 
 	// Log slow
 	if (FlightBatteryStateHandle()) {
-		UAVObjConnectCallbackThrottled(FlightBatteryStateHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(FlightBatteryStateHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (BaroAltitudeHandle()) {
-		UAVObjConnectCallbackThrottled(BaroAltitudeHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(BaroAltitudeHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (AirspeedActualHandle()) {
-		UAVObjConnectCallbackThrottled(AirspeedActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(AirspeedActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (GPSPositionHandle()) {
-		UAVObjConnectCallbackThrottled(GPSPositionHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(GPSPositionHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (PositionActualHandle()) {
-		UAVObjConnectCallbackThrottled(PositionActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(PositionActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (VelocityActualHandle()) {
-		UAVObjConnectCallbackThrottled(VelocityActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period);
+		UAVObjConnectCallbackAsync(VelocityActualHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 10 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
 	// Log very slow
 	if (GPSTimeHandle()) {
-		UAVObjConnectCallbackThrottled(GPSTimeHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 50 * min_period);
+		UAVObjConnectCallbackAsync(GPSTimeHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 50 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
 	// Log very very slow
 	if (GPSSatellitesHandle()) {
-		UAVObjConnectCallbackThrottled(GPSSatellitesHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 500 * min_period);
+		UAVObjConnectCallbackAsync(GPSSatellitesHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 500 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 
 	// Log LQG data
 	if (RTKFEstimateHandle()) {
-		UAVObjConnectCallbackThrottled(RTKFEstimateHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 2 * min_period);
+		UAVObjConnectCallbackAsync(RTKFEstimateHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 2 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 	if (LQGSolutionHandle()) {
-		UAVObjConnectCallbackThrottled(LQGSolutionHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 100 * min_period);
+		UAVObjConnectCallbackAsync(LQGSolutionHandle(), obj_updated_callback, NULL, EV_UPDATED | EV_UNPACKED, 100 * min_period, UAVOBJ_EV_OVERFLOW_COALESCE);
 	}
 }
 
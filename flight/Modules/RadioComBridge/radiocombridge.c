@@ -243,9 +243,9 @@ static int32_t RadioComBridgeInitialize(void)
 
 	// Initialise UAVTalk
 	data->telemUAVTalkCon = UAVTalkInitialize(data, &UAVTalkSendHandler,
-			NULL, NULL, NULL);
+			NULL, NULL, NULL, NULL);
 	data->radioUAVTalkCon = UAVTalkInitialize(NULL, &RadioSendHandler,
-			NULL, NULL, NULL);
+			NULL, NULL, NULL, NULL);
 	if (data->telemUAVTalkCon == 0 || data->radioUAVTalkCon == 0) {
 		return -1;
 	}
@@ -285,6 +285,10 @@ static void updateRadioComBridgeStats()
 		telemetryUAVTalkStats.rxErrors;
 	radioComBridgeStats.TelemetryRxCrcErrors +=
 		telemetryUAVTalkStats.rxCRC;
+	radioComBridgeStats.TelemetryRelayedFrames +=
+		telemetryUAVTalkStats.relayedObjects;
+	radioComBridgeStats.TelemetryRelayedBytes +=
+		telemetryUAVTalkStats.relayedBytes;
 
 	radioComBridgeStats.RadioTxBytes += radioUAVTalkStats.txBytes;
 	radioComBridgeStats.RadioTxFailures += radioUAVTalkStats.txErrors;
@@ -292,6 +296,8 @@ static void updateRadioComBridgeStats()
 	radioComBridgeStats.RadioRxBytes += radioUAVTalkStats.rxBytes;
 	radioComBridgeStats.RadioRxFailures += radioUAVTalkStats.rxErrors;
 	radioComBridgeStats.RadioRxCrcErrors += radioUAVTalkStats.rxCRC;
+	radioComBridgeStats.RadioRelayedFrames += radioUAVTalkStats.relayedObjects;
+	radioComBridgeStats.RadioRelayedBytes += radioUAVTalkStats.relayedBytes;
 
 	// Update stats object data
 	RadioComBridgeStatsSet(&radioComBridgeStats);
@@ -47,6 +47,7 @@
 #include "flightstatus.h"
 #include "manualcontrolcommand.h"
 #include "manualcontrolsettings.h"
+#include "objectmanagerstats.h"
 #include "objectpersistence.h"
 #include "stabilizationsettings.h"
 #include "stateestimation.h"
@@ -164,6 +165,9 @@ static inline void updateSystemAlarms();
 #if defined(WDG_STATS_DIAGNOSTICS)
 static inline void updateWDGstats();
 #endif
+#if defined(UAVOBJ_PROFILE)
+static void updateObjectManagerStats();
+#endif
 
 /**
  * Create the module task.
@@ -211,6 +215,10 @@ int32_t SystemModInitialize(void)
 	if (WatchdogStatusInitialize() == -1)
 		return -1;
 #endif
+#if defined(UAVOBJ_PROFILE)
+	if (ObjectManagerStatsInitialize() == -1)
+		return -1;
+#endif
 
 	objectPersistenceQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 	if (objectPersistenceQueue == NULL)
@@ -454,6 +462,10 @@ static void systemPeriodicCb(const UAVObjEvent *ev,
 		updateWDGstats();
 #endif
 
+#if defined(UAVOBJ_PROFILE)
+		updateObjectManagerStats();
+#endif
+
 #if defined(DIAG_TASKS)
 		// Update the task status object
 		TaskMonitorUpdateAll();
@@ -729,6 +741,47 @@ static void updateWDGstats()
 }
 #endif
 
+/**
+ * Called periodically to publish the object manager profiling counters
+ */
+#if defined(UAVOBJ_PROFILE)
+static void updateObjectManagerStats()
+{
+	static uint32_t lastSysTime;
+	ObjectManagerStatsData omStats;
+	UAVObjProfile profile;
+
+	UAVObjGetProfile(&profile);
+
+	uint32_t now = PIOS_Thread_Systime();
+	float dT = (now - lastSysTime) / 1000.0f;
+	lastSysTime = now;
+
+	if (dT <= 0) {
+		return;
+	}
+
+	memcpy(omStats.LockWait, profile.lockWait, sizeof(omStats.LockWait));
+	memcpy(omStats.LockHold, profile.lockHold, sizeof(omStats.LockHold));
+	memcpy(omStats.EventLatency, profile.eventLatency,
+		sizeof(omStats.EventLatency));
+
+	omStats.LockWaitMax = profile.lockWaitMax;
+	omStats.LockHoldMax = profile.lockHoldMax;
+	omStats.EventLatencyMax = profile.eventLatencyMax;
+	omStats.CallbackTimeMax = profile.callbackTimeMax;
+	omStats.CallbackTimeMaxID = profile.callbackTimeMaxID;
+	omStats.UpdateRate = profile.totalUpdates / dT;
+
+	for (int i = 0; i < OBJECTMANAGERSTATS_BUSIESTOBJECTID_NUMELEM; i++) {
+		omStats.BusiestObjectID[i] = profile.busiestID[i];
+		omStats.BusiestObjectRate[i] = profile.busiestUpdates[i] / dT;
+	}
+
+	ObjectManagerStatsSet(&omStats);
+}
+#endif
+
 /**
  * Called periodically to update the system stats
  */
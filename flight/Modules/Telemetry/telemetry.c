@@ -53,6 +53,30 @@
 #define TELEM_QUEUE_SIZE 60
 #endif
 
+#ifndef TELEM_BATCH_LATENCY_MS
+/* How long an unacked update may wait to be coalesced with others into
+ * a single batch frame, once the GCS has said it can decode them.
+ */
+#define TELEM_BATCH_LATENCY_MS 5
+#endif
+
+#ifndef TELEM_SCHED_SIZE
+/* Updates waiting for link bandwidth.  An object instance holds at most one
+ * slot, so this only has to cover the objects that can fall due together.
+ */
+#define TELEM_SCHED_SIZE 32
+#endif
+
+#ifndef TELEM_BUCKET_MS
+/* Line time a baud-limited port may send in one burst */
+#define TELEM_BUCKET_MS 50
+#endif
+
+#ifndef TELEM_ACK_WINDOW_MAX
+/* Most acked updates that may be outstanding at once */
+#define TELEM_ACK_WINDOW_MAX 16
+#endif
+
 #ifndef TELEM_STACK_SIZE
 #define TELEM_STACK_SIZE 624
 #endif
@@ -68,20 +92,43 @@
 #define CONNECTION_TIMEOUT_MS 8000
 #define USB_ACTIVITY_TIMEOUT_MS 6000
 
-#define MAX_ACKS_PENDING 3
 #define MAX_REQS_PENDING 5
-#define ACK_TIMEOUT_MS 250
+
+/* The ack window follows the link's bandwidth-delay product, in units of
+ * a typical acked update, within these bounds.
+ */
+#define ACK_WINDOW_MIN 3
+#define ACK_OBJ_BYTES 64
+
+#define ACK_TIMEOUT_MS 250	/* Retransmit timeout until the RTT is known */
+#define ACK_RTO_MIN_MS 40
+#define ACK_RTO_MAX_MS 2000
+
+/* Objects sent at least this often are treated as realtime */
+#define FAST_PERIOD_MS 200
+
+#define SCHED_SLOT_NONE 0xff
 
 // Private types
 
+//! Send priority classes, from most to least urgent
+enum sched_prio {
+	SCHED_PRIO_HIGH = 0,	/**< Fast periodic/throttled state */
+	SCHED_PRIO_NORMAL,	/**< Other data objects */
+	SCHED_PRIO_LOW,		/**< Settings and metadata */
+	SCHED_PRIO_NUM
+};
+
 // Private variables
 
 struct pending_ack {
 	UAVObjHandle obj;
-	uint32_t timeout;
+	uint32_t sent;		/**< When it was last transmitted */
+	uint32_t timeout;	/**< When to retransmit it */
 
 	uint16_t inst_id;
 	uint8_t retry_count;
+	bool nacked;
 };
 
 struct pending_req {
@@ -90,21 +137,71 @@ struct pending_req {
 	char valid;
 };
 
+struct sched_slot {
+	UAVObjEvent ev;
+	uint8_t next;
+};
+
+struct sched_class {
+	uint8_t head;
+	uint8_t tail;
+	uint8_t depth;
+	uint8_t max_depth;
+	uint32_t drops;
+};
+
+DONT_BUILD_IF(TELEM_SCHED_SIZE >= SCHED_SLOT_NONE, TelemSchedSlotIndexFits);
+
+//! Object updates waiting to be sent, one FIFO per priority class
+struct telem_sched {
+	struct sched_slot slots[TELEM_SCHED_SIZE];
+	struct sched_class classes[SCHED_PRIO_NUM];
+	uint8_t free;
+};
+
+//! Progress through an object dump requested by the GCS
+struct obj_dump {
+	bool active;
+	uint8_t index;		/**< Next object to send */
+	uint8_t total;		/**< Objects registered when the dump began */
+	uint16_t flags;		/**< UAVTALK_DUMP_* from the request */
+};
+
+//! Token bucket pacing sends to what a port can carry
+struct rate_bucket {
+	uint32_t rate;		/**< Bytes per second, 0 when not limited */
+	int32_t tokens;		/**< Credit in bytes * 1000; may go negative */
+	uint32_t last_refill;
+};
+
 struct telemetry_state {
 	struct pios_queue *queue;
 
+	struct telem_sched sched;
+	struct rate_bucket ser_bucket;	/**< Guarded by reqack_mutex */
+
 	uint32_t tx_errors;
 	uint32_t tx_retries;
 	uint32_t time_of_last_update;
 
-	struct pending_ack acks[MAX_ACKS_PENDING];
+	struct pending_ack acks[TELEM_ACK_WINDOW_MAX];
 	struct pending_req reqs[MAX_REQS_PENDING];
+	struct obj_dump dump;	/**< Only touched by the tx task */
+
+	/* Round trip estimate, guarded by reqack_mutex */
+	uint8_t ack_window;
+	uint16_t srtt;		/**< Smoothed RTT in ms, 0 until measured */
+	uint16_t rttvar;
+	uint16_t rto;
 
 	struct pios_mutex *reqack_mutex;
 
 	struct pios_semaphore *access_sem;
 	volatile bool request_inhibit, tx_inhibited, rx_inhibited;
 
+	bool batching;
+	uint32_t batch_started;
+
 	UAVTalkConnection uavTalkCon;
 };
 
@@ -119,6 +216,7 @@ static void telemetryRxTask(void *parameters);
 static int32_t transmitData(void *ctx, uint8_t *data, int32_t length);
 static void addAckPending(telem_t telem, UAVObjHandle obj, uint16_t inst_id);
 static void ackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id);
+static void nackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id);
 static void reqCallback(void *ctx, uint32_t obj_id, uint16_t inst_id);
 
 static void registerObject(telem_t telem, UAVObjHandle obj);
@@ -127,10 +225,16 @@ static int32_t setUpdatePeriod(telem_t telem, UAVObjHandle obj, int32_t updatePe
 static void processObjEvent(telem_t telem, UAVObjEvent * ev);
 static void updateTelemetryStats(telem_t telem);
 static void gcsTelemetryStatsUpdated();
-static void updateSettings();
+static void updateSettings(telem_t telem);
 static uintptr_t getComPort();
 static void update_object_instances(uint32_t obj_id, uint32_t inst_id);
 static bool processUsbActivity(bool seen_active);
+static void schedInit(struct telem_sched *sched);
+static void schedEvent(telem_t telem, UAVObjEvent *ev);
+static bool schedSendOne(telem_t telem);
+static uint32_t bucketWait(telem_t telem);
+static bool dumpSendOne(telem_t telem);
+static void sendRequestedObj(telem_t telem, const struct pending_req *preq);
 
 static int32_t fileReqCallback(void *ctx, uint8_t *buf,
                 uint32_t file_id, uint32_t offset, uint32_t len);
@@ -193,13 +297,17 @@ int32_t TelemetryInitialize(void)
 
 	// Initialize vars
 	telem_state.time_of_last_update = 0;
+	telem_state.ack_window = ACK_WINDOW_MIN;
+	telem_state.rto = ACK_TIMEOUT_MS;
 
 	// Create object queues
 	telem_state.queue = PIOS_Queue_Create(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
 
+	schedInit(&telem_state.sched);
+
 	// Initialise UAVTalk
 	telem_state.uavTalkCon = UAVTalkInitialize(&telem_state, transmitData,
-			ackCallback, reqCallback, fileReqCallback);
+			ackCallback, nackCallback, reqCallback, fileReqCallback);
 
 	//register the new uavo instance callback function in the uavobjectmanager
 	UAVObjRegisterNewInstanceCB(update_object_instances);
@@ -326,8 +434,15 @@ static void ackResendOrTimeout(telem_t telem, int idx)
 
 		int32_t success;
 
-		telem->acks[idx].timeout = PIOS_Thread_Systime() +
-			ACK_TIMEOUT_MS;
+		/* Back off for each retry, so a slow link isn't flooded */
+		uint32_t rto = telem->rto << telem->acks[idx].retry_count;
+
+		if (rto > ACK_RTO_MAX_MS) {
+			rto = ACK_RTO_MAX_MS;
+		}
+
+		telem->acks[idx].sent = PIOS_Thread_Systime();
+		telem->acks[idx].timeout = telem->acks[idx].sent + rto;
 
 		/* Must not hold lock while sending an object, because
 		 * of lock ordering issues (though the lock should be
@@ -359,9 +474,9 @@ static bool ackHousekeeping(telem_t telem)
 
 	uint32_t tm = PIOS_Thread_Systime();
 
-	for (int i = 0; i < MAX_ACKS_PENDING; i++) {
+	for (int i = 0; i < TELEM_ACK_WINDOW_MAX; i++) {
 		if (telem->acks[i].obj) {
-			if (tm > telem->acks[i].timeout) {
+			if ((int32_t) (tm - telem->acks[i].timeout) >= 0) {
 				ackResendOrTimeout(telem, i);
 
 				did_something = true;
@@ -396,21 +511,31 @@ static void addAckPending(telem_t telem, UAVObjHandle obj, uint16_t inst_id)
 		 * It seems like a lesser evil than most of the alternatives
 		 * that keep good pipelining, though
 		 */
-		for (int i = 0; i < MAX_ACKS_PENDING; i++) {
-			if (!telem->acks[i].obj) {
-				telem->acks[i].obj = obj;
-				telem->acks[i].inst_id = inst_id;
-				telem->acks[i].timeout =
-					PIOS_Thread_Systime() +
-					ACK_TIMEOUT_MS;
-
-				telem->acks[i].retry_count = 0;
-
-				PIOS_Mutex_Unlock(telem->reqack_mutex);
-				return;
+		int in_flight = 0;
+		int free_idx = -1;
+
+		for (int i = 0; i < TELEM_ACK_WINDOW_MAX; i++) {
+			if (telem->acks[i].obj) {
+				in_flight++;
+			} else if (free_idx < 0) {
+				free_idx = i;
 			}
 		}
 
+		if ((free_idx >= 0) && (in_flight < telem->ack_window)) {
+			struct pending_ack *ack = &telem->acks[free_idx];
+
+			ack->obj = obj;
+			ack->inst_id = inst_id;
+			ack->sent = PIOS_Thread_Systime();
+			ack->timeout = ack->sent + telem->rto;
+			ack->retry_count = 0;
+			ack->nacked = false;
+
+			PIOS_Mutex_Unlock(telem->reqack_mutex);
+			return;
+		}
+
 		DEBUG_PRINTF(3, "telem: blocking because acks are full\n");
 
 		/* Oh no.  This is the bad case--- maximum number of things
@@ -511,19 +636,67 @@ static void reqCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
 }
 
 /**
- * Callback for when we receive an ack.
+ * Fold a round trip measurement into the RTT estimate, and resize the ack
+ * window to cover the link's bandwidth-delay product.  Caller holds
+ * reqack_mutex.
  *
- * \param[in] ctx Callback context (telemetry subsystem handle)
- * \param[in] obj_id The object ID that we got an ack for.
- * \param[in] inst_id The instance ID that we got an ack for.
+ * \param[in] telem Telemetry subsystem handle
+ * \param[in] rtt The measured round trip, in ms
  */
-static void ackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
+static void ackRttSample(telem_t telem, uint32_t rtt)
 {
-	telem_t telem = ctx;
+	if (rtt > ACK_RTO_MAX_MS) {
+		rtt = ACK_RTO_MAX_MS;
+	}
 
-	PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	if (!telem->srtt) {
+		telem->srtt = rtt ? rtt : 1;
+		telem->rttvar = rtt / 2;
+	} else {
+		int32_t delta = (int32_t) rtt - telem->srtt;
+
+		telem->rttvar += ((delta < 0 ? -delta : delta) -
+				(int32_t) telem->rttvar) / 4;
+		telem->srtt += delta / 8;
+	}
+
+	uint32_t rto = telem->srtt + 4 * telem->rttvar;
+
+	if (rto < ACK_RTO_MIN_MS) {
+		rto = ACK_RTO_MIN_MS;
+	} else if (rto > ACK_RTO_MAX_MS) {
+		rto = ACK_RTO_MAX_MS;
+	}
+
+	telem->rto = rto;
+
+	/* Links we don't pace are fast; let them have the whole window */
+	uint32_t window = TELEM_ACK_WINDOW_MAX;
+
+	if (telem->ser_bucket.rate && getComPort() == PIOS_COM_TELEM_SER) {
+		window = 1 + telem->ser_bucket.rate * telem->srtt /
+			(1000 * ACK_OBJ_BYTES);
+	}
+
+	if (window < ACK_WINDOW_MIN) {
+		window = ACK_WINDOW_MIN;
+	} else if (window > TELEM_ACK_WINDOW_MAX) {
+		window = TELEM_ACK_WINDOW_MAX;
+	}
+
+	telem->ack_window = window;
+}
 
-	for (int i = 0; i < MAX_ACKS_PENDING; i++) {
+/**
+ * Find the outstanding entry for an acked object.  Caller holds
+ * reqack_mutex.
+ *
+ * \return the entry, or NULL if nothing is waiting for it
+ */
+static struct pending_ack *ackFind(telem_t telem, uint32_t obj_id,
+		uint16_t inst_id)
+{
+	for (int i = 0; i < TELEM_ACK_WINDOW_MAX; i++) {
 		if (!telem->acks[i].obj) {
 			continue;
 		}
@@ -532,22 +705,79 @@ static void ackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
 			continue;
 		}
 
-		uint32_t other_obj_id = UAVObjGetID(telem->acks[i].obj);
-
-		if (obj_id != other_obj_id) {
+		if (obj_id != UAVObjGetID(telem->acks[i].obj)) {
 			continue;
 		}
 
-		telem->acks[i].obj = NULL;
+		return &telem->acks[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Callback for when we receive an ack.
+ *
+ * \param[in] ctx Callback context (telemetry subsystem handle)
+ * \param[in] obj_id The object ID that we got an ack for.
+ * \param[in] inst_id The instance ID that we got an ack for.
+ */
+static void ackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
+{
+	telem_t telem = ctx;
+
+	PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	struct pending_ack *ack = ackFind(telem, obj_id, inst_id);
+
+	if (ack) {
+		/* An ack for a retransmitted update could answer any of
+		 * the copies, so only time the ones sent once.
+		 */
+		if (!ack->retry_count) {
+			ackRttSample(telem, PIOS_Thread_Systime() - ack->sent);
+		}
+
+		ack->obj = NULL;
 
 		DEBUG_PRINTF(3, "telem: Got ack for %d/%d\n", obj_id, inst_id);
-		PIOS_Mutex_Unlock(telem->reqack_mutex);
-		return;
+	} else {
+		DEBUG_PRINTF(3, "telem: Got UNEXPECTED ack for %d/%d\n",
+				obj_id, inst_id);
 	}
 
 	PIOS_Mutex_Unlock(telem->reqack_mutex);
+}
+
+/**
+ * Callback for when we receive a nack.  The first nack for an update
+ * retransmits it at the next housekeeping pass instead of waiting for
+ * the timer; a second one means the GCS won't take it, so stop waiting.
+ *
+ * \param[in] ctx Callback context (telemetry subsystem handle)
+ * \param[in] obj_id The object ID that we got a nack for.
+ * \param[in] inst_id The instance ID that we got a nack for.
+ */
+static void nackCallback(void *ctx, uint32_t obj_id, uint16_t inst_id)
+{
+	telem_t telem = ctx;
 
-	DEBUG_PRINTF(3, "telem: Got UNEXPECTED ack for %d/%d\n", obj_id, inst_id);
+	PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	struct pending_ack *ack = ackFind(telem, obj_id, inst_id);
+
+	if (ack) {
+		if (ack->nacked || ack->retry_count > MAX_RETRIES) {
+			ack->obj = NULL;
+		} else {
+			ack->nacked = true;
+			ack->timeout = PIOS_Thread_Systime();
+		}
+
+		DEBUG_PRINTF(3, "telem: Got nack for %d/%d\n", obj_id, inst_id);
+	}
+
+	PIOS_Mutex_Unlock(telem->reqack_mutex);
 }
 
 /**
@@ -578,9 +808,20 @@ static void processObjEvent(telem_t telem, UAVObjEvent * ev)
 				addAckPending(telem, ev->obj, ev->instId);
 			}
 
-			success = UAVTalkSendObject(telem->uavTalkCon,
-					ev->obj, ev->instId,
-					acked);
+			if (telem->batching && !acked) {
+				if (!UAVTalkBatchPending(telem->uavTalkCon)) {
+					telem->batch_started =
+						PIOS_Thread_Systime();
+				}
+
+				success = UAVTalkSendObjectBatched(
+						telem->uavTalkCon,
+						ev->obj, ev->instId);
+			} else {
+				success = UAVTalkSendObject(telem->uavTalkCon,
+						ev->obj, ev->instId,
+						acked);
+			}
 
 			if (success == -1) {
 				telem->tx_errors++;
@@ -600,6 +841,224 @@ static void processObjEvent(telem_t telem, UAVObjEvent * ev)
 	UAVObjUnblockThrottle(ev->throttle);
 }
 
+/**
+ * Empty the send scheduler, putting every slot on the free list.
+ */
+static void schedInit(struct telem_sched *sched)
+{
+	for (int i = 0; i < TELEM_SCHED_SIZE; i++) {
+		sched->slots[i].next = (i + 1 < TELEM_SCHED_SIZE) ?
+			(i + 1) : SCHED_SLOT_NONE;
+	}
+
+	sched->free = 0;
+
+	for (int c = 0; c < SCHED_PRIO_NUM; c++) {
+		sched->classes[c].head = SCHED_SLOT_NONE;
+		sched->classes[c].tail = SCHED_SLOT_NONE;
+	}
+}
+
+/**
+ * Choose the priority class for an object from its metadata.
+ */
+static enum sched_prio schedClass(UAVObjHandle obj)
+{
+	if (UAVObjIsMetaobject(obj) || UAVObjIsSettings(obj)) {
+		return SCHED_PRIO_LOW;
+	}
+
+	UAVObjMetadata metadata;
+	UAVObjGetMetadata(obj, &metadata);
+
+	switch (UAVObjGetTelemetryUpdateMode(&metadata)) {
+	case UPDATEMODE_PERIODIC:
+	case UPDATEMODE_THROTTLED:
+		if (metadata.telemetryUpdatePeriod &&
+				metadata.telemetryUpdatePeriod <= FAST_PERIOD_MS) {
+			return SCHED_PRIO_HIGH;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return SCHED_PRIO_NORMAL;
+}
+
+/**
+ * Remove the oldest entry of a class, returning its slot.
+ */
+static uint8_t schedPop(struct telem_sched *sched, enum sched_prio prio)
+{
+	struct sched_class *cls = &sched->classes[prio];
+	uint8_t idx = cls->head;
+
+	cls->head = sched->slots[idx].next;
+
+	if (cls->head == SCHED_SLOT_NONE) {
+		cls->tail = SCHED_SLOT_NONE;
+	}
+
+	cls->depth--;
+
+	return idx;
+}
+
+/**
+ * Queue an object event to be sent when bandwidth allows.  Events that
+ * drive the connection itself are handled immediately.  An object instance
+ * already waiting is not queued twice: the data is read when it is sent,
+ * so the pending send will carry the newest values anyway.
+ */
+static void schedEvent(telem_t telem, UAVObjEvent *ev)
+{
+	struct telem_sched *sched = &telem->sched;
+
+	if (ev->obj == 0 || ev->obj == GCSTelemetryStatsHandle()) {
+		processObjEvent(telem, ev);
+		return;
+	}
+
+	enum sched_prio prio = schedClass(ev->obj);
+	struct sched_class *cls = &sched->classes[prio];
+
+	for (uint8_t i = cls->head; i != SCHED_SLOT_NONE;
+			i = sched->slots[i].next) {
+		UAVObjEvent *pending = &sched->slots[i].ev;
+
+		if (pending->obj == ev->obj && pending->instId == ev->instId) {
+			if (ev->event != EV_NONE) {
+				pending->event = ev->event;
+			}
+
+			UAVObjUnblockThrottle(ev->throttle);
+			return;
+		}
+	}
+
+	if (sched->free == SCHED_SLOT_NONE) {
+		/* Full: make room by shedding the oldest update of the
+		 * least urgent class below this one, else shed this one.
+		 */
+		int victim;
+
+		for (victim = SCHED_PRIO_NUM - 1; victim > (int) prio; victim--) {
+			if (sched->classes[victim].head != SCHED_SLOT_NONE) {
+				break;
+			}
+		}
+
+		if (victim == (int) prio) {
+			cls->drops++;
+			UAVObjUnblockThrottle(ev->throttle);
+			return;
+		}
+
+		uint8_t idx = schedPop(sched, victim);
+
+		UAVObjUnblockThrottle(sched->slots[idx].ev.throttle);
+		sched->classes[victim].drops++;
+
+		sched->slots[idx].next = sched->free;
+		sched->free = idx;
+	}
+
+	uint8_t idx = sched->free;
+
+	sched->free = sched->slots[idx].next;
+	sched->slots[idx].ev = *ev;
+	sched->slots[idx].next = SCHED_SLOT_NONE;
+
+	if (cls->tail == SCHED_SLOT_NONE) {
+		cls->head = idx;
+	} else {
+		sched->slots[cls->tail].next = idx;
+	}
+
+	cls->tail = idx;
+
+	if (++cls->depth > cls->max_depth) {
+		cls->max_depth = cls->depth;
+	}
+}
+
+/**
+ * Send the oldest update of the most urgent non-empty class.
+ * \return true if something was sent
+ */
+static bool schedSendOne(telem_t telem)
+{
+	struct telem_sched *sched = &telem->sched;
+
+	for (int prio = 0; prio < SCHED_PRIO_NUM; prio++) {
+		if (sched->classes[prio].head == SCHED_SLOT_NONE) {
+			continue;
+		}
+
+		uint8_t idx = schedPop(sched, prio);
+		UAVObjEvent ev = sched->slots[idx].ev;
+
+		sched->slots[idx].next = sched->free;
+		sched->free = idx;
+
+		processObjEvent(telem, &ev);
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Add the credit earned since the last refill.  Caller holds reqack_mutex.
+ */
+static void bucketRefill(struct rate_bucket *bucket)
+{
+	uint32_t now = PIOS_Thread_Systime();
+	uint32_t elapsed = now - bucket->last_refill;
+	int32_t depth = (int32_t) (bucket->rate * TELEM_BUCKET_MS);
+
+	bucket->last_refill = now;
+
+	if (elapsed >= TELEM_BUCKET_MS) {
+		bucket->tokens = depth;
+	} else {
+		bucket->tokens += (int32_t) (bucket->rate * elapsed);
+
+		if (bucket->tokens > depth) {
+			bucket->tokens = depth;
+		}
+	}
+}
+
+/**
+ * Work out how long sends to the current port must wait for credit.
+ * \return milliseconds to wait, 0 if a send may go now
+ */
+static uint32_t bucketWait(telem_t telem)
+{
+	struct rate_bucket *bucket = &telem->ser_bucket;
+	uint32_t wait_ms = 0;
+
+	if (!bucket->rate || getComPort() != PIOS_COM_TELEM_SER) {
+		return 0;
+	}
+
+	PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	bucketRefill(bucket);
+
+	if (bucket->tokens < 0) {
+		wait_ms = ((uint32_t) -bucket->tokens + bucket->rate - 1) /
+			bucket->rate;
+	}
+
+	PIOS_Mutex_Unlock(telem->reqack_mutex);
+
+	return wait_ms;
+}
+
 static bool sendRequestedObjs(telem_t telem)
 {
 	// Must be called with the reqack mutex.
@@ -626,29 +1085,109 @@ static bool sendRequestedObjs(telem_t telem)
 	// Unlock, to ensure new requests can come in OK.
 	PIOS_Mutex_Unlock(telem->reqack_mutex);
 
-	// handle request
-	UAVObjHandle obj = UAVObjGetByID(preq.obj_id);
+	if (preq.obj_id == UAVTALK_OBJID_DUMP_ALL) {
+		/* Restart from the top if a dump was already running;
+		 * the GCS only asks again when it gave up on the last.
+		 */
+		telem->dump.active = true;
+		telem->dump.index = 0;
+		telem->dump.total = UAVObjCount();
+		telem->dump.flags = preq.inst_id;
+	} else {
+		sendRequestedObj(telem, &preq);
+	}
+
+	PIOS_Mutex_Lock(telem->reqack_mutex,
+			PIOS_MUTEX_TIMEOUT_MAX);
+
+	return true;
+}
+
+/**
+ * Answer one object request, or NACK it if we don't have the object.
+ */
+static void sendRequestedObj(telem_t telem, const struct pending_req *preq)
+{
+	UAVObjHandle obj = UAVObjGetByID(preq->obj_id);
 
 	// Send requested object if message is of type OBJ_REQ
 	if (!obj) {
-		UAVTalkSendNack(telem->uavTalkCon, preq.obj_id,
-				preq.inst_id);
+		UAVTalkSendNack(telem->uavTalkCon, preq->obj_id,
+				preq->inst_id);
 	} else {
-		if ((preq.inst_id == UAVOBJ_ALL_INSTANCES) ||
-		    (preq.inst_id < UAVObjGetNumInstances(obj))) {
+		if ((preq->inst_id == UAVOBJ_ALL_INSTANCES) ||
+		    (preq->inst_id < UAVObjGetNumInstances(obj))) {
 			UAVTalkSendObject(telem->uavTalkCon,
-					obj, preq.inst_id,
+					obj, preq->inst_id,
 					false);
 		} else {
 			UAVTalkSendNack(telem->uavTalkCon,
-					preq.obj_id,
-					preq.inst_id);
+					preq->obj_id,
+					preq->inst_id);
+		}
+	}
+}
+
+/**
+ * Send the next object of a running dump: every instance of one data
+ * object followed by its metadata.  Settings and their metadata go as
+ * checksums instead if the GCS asked for that, so it can use its cached
+ * copy.  Once all objects have gone out, send the completion marker
+ * carrying the object count.
+ * \return true if something was sent
+ */
+static bool dumpSendOne(telem_t telem)
+{
+	struct obj_dump *dump = &telem->dump;
+
+	if (!dump->active) {
+		return false;
+	}
+
+	if (dump->index >= dump->total) {
+		dump->active = false;
+
+		if (UAVTalkSendDumpComplete(telem->uavTalkCon, dump->total)) {
+			telem->tx_errors++;
 		}
+
+		return true;
 	}
 
+	UAVObjHandle obj = UAVObjGetByID(UAVObjIDByIndex(dump->index++));
 
-	PIOS_Mutex_Lock(telem->reqack_mutex,
-			PIOS_MUTEX_TIMEOUT_MAX);
+	if (!obj) {
+		return true;
+	}
+
+	UAVObjHandle meta = UAVObjGetLinkedObj(obj);
+	bool as_crc = (dump->flags & UAVTALK_DUMP_SETTINGS_CRC) &&
+		UAVObjIsSettings(obj);
+	int32_t success;
+
+	if (as_crc || telem->batching) {
+		if (!UAVTalkBatchPending(telem->uavTalkCon)) {
+			telem->batch_started = PIOS_Thread_Systime();
+		}
+	}
+
+	if (as_crc) {
+		success = UAVTalkSendChecksum(telem->uavTalkCon, obj);
+		success |= UAVTalkSendChecksum(telem->uavTalkCon, meta);
+	} else if (telem->batching) {
+		success = UAVTalkSendObjectBatched(telem->uavTalkCon, obj,
+				UAVOBJ_ALL_INSTANCES);
+		success |= UAVTalkSendObjectBatched(telem->uavTalkCon, meta, 0);
+	} else {
+		success = UAVTalkSendObject(telem->uavTalkCon, obj,
+				UAVOBJ_ALL_INSTANCES, false);
+		success |= UAVTalkSendObject(telem->uavTalkCon, meta, 0,
+				false);
+	}
+
+	if (success == -1) {
+		telem->tx_errors++;
+	}
 
 	return true;
 }
@@ -661,7 +1200,7 @@ static void telemetryTxTask(void *parameters)
 	telem_t telem = parameters;
 
 	// Update telemetry settings
-	updateSettings();
+	updateSettings(telem);
 
 	// Loop forever
 	while (1) {
@@ -670,6 +1209,7 @@ static void telemetryTxTask(void *parameters)
 		bool retval;
 
 		if (telem->request_inhibit) {
+			UAVTalkFlushBatch(telem->uavTalkCon);
 			telem->tx_inhibited = true;
 			PIOS_Thread_Sleep(3);
 			continue;
@@ -677,8 +1217,38 @@ static void telemetryTxTask(void *parameters)
 
 		telem->tx_inhibited = false;
 
+		/* Wait for new events only until queued updates may be
+		 * sent, and don't hold a partial batch longer than the
+		 * latency budget waiting for more updates.
+		 */
+		uint32_t wait_ms = 10;
+		bool pending = telem->dump.active;
+
+		for (int prio = 0; prio < SCHED_PRIO_NUM; prio++) {
+			if (telem->sched.classes[prio].head != SCHED_SLOT_NONE) {
+				pending = true;
+			}
+		}
+
+		uint32_t credit_wait = pending ? bucketWait(telem) : 0;
+
+		if (pending && credit_wait < wait_ms) {
+			wait_ms = credit_wait;
+		}
+
+		if (UAVTalkBatchPending(telem->uavTalkCon)) {
+			uint32_t age = PIOS_Thread_Systime() -
+				telem->batch_started;
+
+			if (age >= TELEM_BATCH_LATENCY_MS) {
+				wait_ms = 0;
+			} else if (TELEM_BATCH_LATENCY_MS - age < wait_ms) {
+				wait_ms = TELEM_BATCH_LATENCY_MS - age;
+			}
+		}
+
 		// Wait for queue message or short timeout
-		retval = PIOS_Queue_Receive(telem->queue, &ev, 10);
+		retval = PIOS_Queue_Receive(telem->queue, &ev, wait_ms);
 
 		PIOS_Mutex_Lock(telem->reqack_mutex,
 				PIOS_MUTEX_TIMEOUT_MAX);
@@ -688,11 +1258,34 @@ static void telemetryTxTask(void *parameters)
 
 		PIOS_Mutex_Unlock(telem->reqack_mutex);
 
-		if (retval == true) {
-			// Process event
-			processObjEvent(telem, &ev);
+		/* Take everything that is waiting, so the most urgent
+		 * update goes first rather than the oldest.
+		 */
+		while (retval == true) {
+			schedEvent(telem, &ev);
+
+			retval = PIOS_Queue_Receive(telem->queue, &ev, 0);
+		}
+
+		bool sent = false;
+
+		/* Dumps go out between queued updates, so the link stays
+		 * live while the GCS fetches everything.
+		 */
+		if (bucketWait(telem) == 0) {
+			sent = schedSendOne(telem);
 		}
 
+		if (bucketWait(telem) == 0) {
+			sent |= dumpSendOne(telem);
+		}
+
+		if (UAVTalkBatchPending(telem->uavTalkCon) &&
+				((sent == false) ||
+				 PIOS_Thread_Period_Elapsed(telem->batch_started,
+					 TELEM_BATCH_LATENCY_MS))) {
+			UAVTalkFlushBatch(telem->uavTalkCon);
+		}
 	}
 }
 
@@ -743,14 +1336,23 @@ static void telemetryRxTask(void *parameters)
  */
 static int32_t transmitData(void *ctx, uint8_t * data, int32_t length)
 {
-	(void) ctx;
+	telem_t telem = ctx;
 
 	uintptr_t outputPort = getComPort();
 
-	if (outputPort)
-		return PIOS_COM_SendBuffer(outputPort, data, length);
+	if (!outputPort)
+		return -1;
 
-	return -1;
+	if ((outputPort == PIOS_COM_TELEM_SER) && telem->ser_bucket.rate) {
+		PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+		bucketRefill(&telem->ser_bucket);
+		telem->ser_bucket.tokens -= length * 1000;
+
+		PIOS_Mutex_Unlock(telem->reqack_mutex);
+	}
+
+	return PIOS_COM_SendBuffer(outputPort, data, length);
 }
 
 /**
@@ -822,6 +1424,10 @@ static void updateTelemetryStats(telem_t telem)
 		flightStats.TxRetries += telem->tx_retries;
 		telem->tx_errors = 0;
 		telem->tx_retries = 0;
+
+		for (int c = 0; c < SCHED_PRIO_NUM; c++) {
+			flightStats.QueueDrops[c] += telem->sched.classes[c].drops;
+		}
 	} else {
 		flightStats.RxDataRate = 0;
 		flightStats.TxDataRate = 0;
@@ -830,6 +1436,24 @@ static void updateTelemetryStats(telem_t telem)
 		flightStats.TxRetries = 0;
 		telem->tx_errors = 0;
 		telem->tx_retries = 0;
+
+		for (int c = 0; c < SCHED_PRIO_NUM; c++) {
+			flightStats.QueueDrops[c] = 0;
+		}
+	}
+
+	PIOS_Mutex_Lock(telem->reqack_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	flightStats.AckWindow = telem->ack_window;
+	flightStats.AckRtt = telem->srtt;
+	PIOS_Mutex_Unlock(telem->reqack_mutex);
+
+	/* Report the deepest each class got since the last update */
+	for (int c = 0; c < SCHED_PRIO_NUM; c++) {
+		struct sched_class *cls = &telem->sched.classes[c];
+
+		flightStats.QueueDepth[c] = cls->max_depth;
+		cls->max_depth = cls->depth;
+		cls->drops = 0;
 	}
 
 	// Check for connection timeout
@@ -867,6 +1491,15 @@ static void updateTelemetryStats(telem_t telem)
 		flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
 	}
 
+	/* Advertise what we can decode, and only use batch frames once the
+	 * GCS has advertised that it understands them.
+	 */
+	flightStats.Capabilities = UAVTALK_CAPABILITIES;
+
+	telem->batching =
+		(flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) &&
+		(gcsStats.Capabilities & UAVTALK_CAP_OBJ_BATCH);
+
 #ifndef PIPXTREME
 	// Update the telemetry alarm
 	if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
@@ -885,10 +1518,38 @@ static void updateTelemetryStats(telem_t telem)
 	}
 }
 
+/**
+ * Line rate of a telemetry speed setting, in bits per second.
+ */
+static uint32_t speedToBaud(HwSharedSpeedBpsOptions speed)
+{
+	switch (speed) {
+	case HWSHARED_SPEEDBPS_1200:
+		return 1200;
+	case HWSHARED_SPEEDBPS_2400:
+		return 2400;
+	case HWSHARED_SPEEDBPS_4800:
+		return 4800;
+	case HWSHARED_SPEEDBPS_9600:
+		return 9600;
+	case HWSHARED_SPEEDBPS_19200:
+		return 19200;
+	case HWSHARED_SPEEDBPS_38400:
+		return 38400;
+	case HWSHARED_SPEEDBPS_57600:
+		return 57600;
+	case HWSHARED_SPEEDBPS_230400:
+		return 230400;
+	default:
+		/* 115200, and the bluetooth modules we set up at 115200 */
+		return 115200;
+	}
+}
+
 /**
  * Update the telemetry settings, called on startup.
  */
-static void updateSettings()
+static void updateSettings(telem_t telem)
 {
 	if (PIOS_COM_TELEM_SER) {
 		// Retrieve settings
@@ -896,6 +1557,10 @@ static void updateSettings()
 		ModuleSettingsTelemetrySpeedGet(&speed);
 
 		PIOS_HAL_ConfigureSerialSpeed(PIOS_COM_TELEM_SER, speed);
+
+		/* 8N1: ten bits on the wire per byte */
+		telem->ser_bucket.rate = speedToBaud(speed) / 10;
+		telem->ser_bucket.last_refill = PIOS_Thread_Systime();
 	}
 }
 
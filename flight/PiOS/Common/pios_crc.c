@@ -31,6 +31,68 @@ static const uint8_t crc_table[256] = {
 	0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
 };
 
+/* crc_table applied two, three and four times: the CRC contribution of a
+ * byte followed by one, two and three more bytes.  Lets
+ * PIOS_CRC_updateCRC() fold four bytes at a time.
+ */
+static const uint8_t crc_table_s1[256] = {
+	0x00, 0x15, 0x2a, 0x3f, 0x54, 0x41, 0x7e, 0x6b, 0xa8, 0xbd, 0x82, 0x97, 0xfc, 0xe9, 0xd6, 0xc3,
+	0x57, 0x42, 0x7d, 0x68, 0x03, 0x16, 0x29, 0x3c, 0xff, 0xea, 0xd5, 0xc0, 0xab, 0xbe, 0x81, 0x94,
+	0xae, 0xbb, 0x84, 0x91, 0xfa, 0xef, 0xd0, 0xc5, 0x06, 0x13, 0x2c, 0x39, 0x52, 0x47, 0x78, 0x6d,
+	0xf9, 0xec, 0xd3, 0xc6, 0xad, 0xb8, 0x87, 0x92, 0x51, 0x44, 0x7b, 0x6e, 0x05, 0x10, 0x2f, 0x3a,
+	0x5b, 0x4e, 0x71, 0x64, 0x0f, 0x1a, 0x25, 0x30, 0xf3, 0xe6, 0xd9, 0xcc, 0xa7, 0xb2, 0x8d, 0x98,
+	0x0c, 0x19, 0x26, 0x33, 0x58, 0x4d, 0x72, 0x67, 0xa4, 0xb1, 0x8e, 0x9b, 0xf0, 0xe5, 0xda, 0xcf,
+	0xf5, 0xe0, 0xdf, 0xca, 0xa1, 0xb4, 0x8b, 0x9e, 0x5d, 0x48, 0x77, 0x62, 0x09, 0x1c, 0x23, 0x36,
+	0xa2, 0xb7, 0x88, 0x9d, 0xf6, 0xe3, 0xdc, 0xc9, 0x0a, 0x1f, 0x20, 0x35, 0x5e, 0x4b, 0x74, 0x61,
+	0xb6, 0xa3, 0x9c, 0x89, 0xe2, 0xf7, 0xc8, 0xdd, 0x1e, 0x0b, 0x34, 0x21, 0x4a, 0x5f, 0x60, 0x75,
+	0xe1, 0xf4, 0xcb, 0xde, 0xb5, 0xa0, 0x9f, 0x8a, 0x49, 0x5c, 0x63, 0x76, 0x1d, 0x08, 0x37, 0x22,
+	0x18, 0x0d, 0x32, 0x27, 0x4c, 0x59, 0x66, 0x73, 0xb0, 0xa5, 0x9a, 0x8f, 0xe4, 0xf1, 0xce, 0xdb,
+	0x4f, 0x5a, 0x65, 0x70, 0x1b, 0x0e, 0x31, 0x24, 0xe7, 0xf2, 0xcd, 0xd8, 0xb3, 0xa6, 0x99, 0x8c,
+	0xed, 0xf8, 0xc7, 0xd2, 0xb9, 0xac, 0x93, 0x86, 0x45, 0x50, 0x6f, 0x7a, 0x11, 0x04, 0x3b, 0x2e,
+	0xba, 0xaf, 0x90, 0x85, 0xee, 0xfb, 0xc4, 0xd1, 0x12, 0x07, 0x38, 0x2d, 0x46, 0x53, 0x6c, 0x79,
+	0x43, 0x56, 0x69, 0x7c, 0x17, 0x02, 0x3d, 0x28, 0xeb, 0xfe, 0xc1, 0xd4, 0xbf, 0xaa, 0x95, 0x80,
+	0x14, 0x01, 0x3e, 0x2b, 0x40, 0x55, 0x6a, 0x7f, 0xbc, 0xa9, 0x96, 0x83, 0xe8, 0xfd, 0xc2, 0xd7
+};
+
+static const uint8_t crc_table_s2[256] = {
+	0x00, 0x6b, 0xd6, 0xbd, 0xab, 0xc0, 0x7d, 0x16, 0x51, 0x3a, 0x87, 0xec, 0xfa, 0x91, 0x2c, 0x47,
+	0xa2, 0xc9, 0x74, 0x1f, 0x09, 0x62, 0xdf, 0xb4, 0xf3, 0x98, 0x25, 0x4e, 0x58, 0x33, 0x8e, 0xe5,
+	0x43, 0x28, 0x95, 0xfe, 0xe8, 0x83, 0x3e, 0x55, 0x12, 0x79, 0xc4, 0xaf, 0xb9, 0xd2, 0x6f, 0x04,
+	0xe1, 0x8a, 0x37, 0x5c, 0x4a, 0x21, 0x9c, 0xf7, 0xb0, 0xdb, 0x66, 0x0d, 0x1b, 0x70, 0xcd, 0xa6,
+	0x86, 0xed, 0x50, 0x3b, 0x2d, 0x46, 0xfb, 0x90, 0xd7, 0xbc, 0x01, 0x6a, 0x7c, 0x17, 0xaa, 0xc1,
+	0x24, 0x4f, 0xf2, 0x99, 0x8f, 0xe4, 0x59, 0x32, 0x75, 0x1e, 0xa3, 0xc8, 0xde, 0xb5, 0x08, 0x63,
+	0xc5, 0xae, 0x13, 0x78, 0x6e, 0x05, 0xb8, 0xd3, 0x94, 0xff, 0x42, 0x29, 0x3f, 0x54, 0xe9, 0x82,
+	0x67, 0x0c, 0xb1, 0xda, 0xcc, 0xa7, 0x1a, 0x71, 0x36, 0x5d, 0xe0, 0x8b, 0x9d, 0xf6, 0x4b, 0x20,
+	0x0b, 0x60, 0xdd, 0xb6, 0xa0, 0xcb, 0x76, 0x1d, 0x5a, 0x31, 0x8c, 0xe7, 0xf1, 0x9a, 0x27, 0x4c,
+	0xa9, 0xc2, 0x7f, 0x14, 0x02, 0x69, 0xd4, 0xbf, 0xf8, 0x93, 0x2e, 0x45, 0x53, 0x38, 0x85, 0xee,
+	0x48, 0x23, 0x9e, 0xf5, 0xe3, 0x88, 0x35, 0x5e, 0x19, 0x72, 0xcf, 0xa4, 0xb2, 0xd9, 0x64, 0x0f,
+	0xea, 0x81, 0x3c, 0x57, 0x41, 0x2a, 0x97, 0xfc, 0xbb, 0xd0, 0x6d, 0x06, 0x10, 0x7b, 0xc6, 0xad,
+	0x8d, 0xe6, 0x5b, 0x30, 0x26, 0x4d, 0xf0, 0x9b, 0xdc, 0xb7, 0x0a, 0x61, 0x77, 0x1c, 0xa1, 0xca,
+	0x2f, 0x44, 0xf9, 0x92, 0x84, 0xef, 0x52, 0x39, 0x7e, 0x15, 0xa8, 0xc3, 0xd5, 0xbe, 0x03, 0x68,
+	0xce, 0xa5, 0x18, 0x73, 0x65, 0x0e, 0xb3, 0xd8, 0x9f, 0xf4, 0x49, 0x22, 0x34, 0x5f, 0xe2, 0x89,
+	0x6c, 0x07, 0xba, 0xd1, 0xc7, 0xac, 0x11, 0x7a, 0x3d, 0x56, 0xeb, 0x80, 0x96, 0xfd, 0x40, 0x2b
+};
+
+static const uint8_t crc_table_s3[256] = {
+	0x00, 0x16, 0x2c, 0x3a, 0x58, 0x4e, 0x74, 0x62, 0xb0, 0xa6, 0x9c, 0x8a, 0xe8, 0xfe, 0xc4, 0xd2,
+	0x67, 0x71, 0x4b, 0x5d, 0x3f, 0x29, 0x13, 0x05, 0xd7, 0xc1, 0xfb, 0xed, 0x8f, 0x99, 0xa3, 0xb5,
+	0xce, 0xd8, 0xe2, 0xf4, 0x96, 0x80, 0xba, 0xac, 0x7e, 0x68, 0x52, 0x44, 0x26, 0x30, 0x0a, 0x1c,
+	0xa9, 0xbf, 0x85, 0x93, 0xf1, 0xe7, 0xdd, 0xcb, 0x19, 0x0f, 0x35, 0x23, 0x41, 0x57, 0x6d, 0x7b,
+	0x9b, 0x8d, 0xb7, 0xa1, 0xc3, 0xd5, 0xef, 0xf9, 0x2b, 0x3d, 0x07, 0x11, 0x73, 0x65, 0x5f, 0x49,
+	0xfc, 0xea, 0xd0, 0xc6, 0xa4, 0xb2, 0x88, 0x9e, 0x4c, 0x5a, 0x60, 0x76, 0x14, 0x02, 0x38, 0x2e,
+	0x55, 0x43, 0x79, 0x6f, 0x0d, 0x1b, 0x21, 0x37, 0xe5, 0xf3, 0xc9, 0xdf, 0xbd, 0xab, 0x91, 0x87,
+	0x32, 0x24, 0x1e, 0x08, 0x6a, 0x7c, 0x46, 0x50, 0x82, 0x94, 0xae, 0xb8, 0xda, 0xcc, 0xf6, 0xe0,
+	0x31, 0x27, 0x1d, 0x0b, 0x69, 0x7f, 0x45, 0x53, 0x81, 0x97, 0xad, 0xbb, 0xd9, 0xcf, 0xf5, 0xe3,
+	0x56, 0x40, 0x7a, 0x6c, 0x0e, 0x18, 0x22, 0x34, 0xe6, 0xf0, 0xca, 0xdc, 0xbe, 0xa8, 0x92, 0x84,
+	0xff, 0xe9, 0xd3, 0xc5, 0xa7, 0xb1, 0x8b, 0x9d, 0x4f, 0x59, 0x63, 0x75, 0x17, 0x01, 0x3b, 0x2d,
+	0x98, 0x8e, 0xb4, 0xa2, 0xc0, 0xd6, 0xec, 0xfa, 0x28, 0x3e, 0x04, 0x12, 0x70, 0x66, 0x5c, 0x4a,
+	0xaa, 0xbc, 0x86, 0x90, 0xf2, 0xe4, 0xde, 0xc8, 0x1a, 0x0c, 0x36, 0x20, 0x42, 0x54, 0x6e, 0x78,
+	0xcd, 0xdb, 0xe1, 0xf7, 0x95, 0x83, 0xb9, 0xaf, 0x7d, 0x6b, 0x51, 0x47, 0x25, 0x33, 0x09, 0x1f,
+	0x64, 0x72, 0x48, 0x5e, 0x3c, 0x2a, 0x10, 0x06, 0xd4, 0xc2, 0xf8, 0xee, 0x8c, 0x9a, 0xa0, 0xb6,
+	0x03, 0x15, 0x2f, 0x39, 0x5b, 0x4d, 0x77, 0x61, 0xb3, 0xa5, 0x9f, 0x89, 0xeb, 0xfd, 0xc7, 0xd1
+};
+
+
 static const uint8_t crc_d5_tab[256] = {
 	0x00, 0xd5, 0x7f, 0xaa, 0xfe, 0x2b, 0x81, 0x54, 0x29, 0xfc, 0x56, 0x83, 0xd7, 0x02, 0xa8, 0x7d,
 	0x52, 0x87, 0x2d, 0xf8, 0xac, 0x79, 0xd3, 0x06, 0x7b, 0xae, 0x04, 0xd1, 0x85, 0x50, 0xfa, 0x2f,
@@ -156,10 +218,20 @@ uint8_t PIOS_CRC_updateCRC(uint8_t crc, const uint8_t* data, int32_t length)
 	register int32_t len = length;
 	register uint8_t crc8 = crc;
 	register const uint8_t *p = data;
-	
+
+	/* Four bytes per step: only the first lookup depends on the running
+	 * CRC, so the other three can proceed in parallel.
+	 */
+	while (len >= 4) {
+		crc8 = crc_table_s3[crc8 ^ p[0]] ^ crc_table_s2[p[1]] ^
+			crc_table_s1[p[2]] ^ crc_table[p[3]];
+		p += 4;
+		len -= 4;
+	}
+
 	while (len--)
 		crc8 = crc_table[crc8 ^ *p++];
-	
+
 	return crc8;
 }
 
@@ -130,6 +130,22 @@ typedef struct {
 typedef void (*UAVObjEventCallback)(const UAVObjEvent *ev, void* cb_ctx,
 	void *uavo_data, int uavo_len);
 
+/**
+ * What to do when the event ring of an asynchronous callback is full.
+ */
+typedef enum {
+	UAVOBJ_EV_OVERFLOW_DROP_OLDEST = 0, /**< Overwrite the oldest pending event */
+	UAVOBJ_EV_OVERFLOW_COALESCE = 1, /**< Keep at most one pending event per object instance, then drop oldest */
+} UAVObjEventOverflowPolicy;
+
+/**
+ * A contiguous range of bytes within the data of an object instance
+ */
+typedef struct {
+	uint16_t offset;
+	uint16_t size;
+} UAVObjDirtyRange;
+
 /**
  * Callback used to initialize the object fields to their default values.
  */
@@ -143,16 +159,44 @@ typedef struct {
 	uint32_t eventCallbackErrors;
 	uint32_t lastCallbackErrorID;
 	uint32_t lastQueueErrorID;
+	uint32_t instanceSlabBytes; /* Heap used by slabs of multi-instance data */
+	uint32_t instanceSlabBytesSaved; /* Heap saved vs. one block per instance */
 } UAVObjStats;
 
+/**
+ * Object manager profiling counters, see UAVObjGetProfile().  Histogram
+ * buckets are powers of four microseconds: <1, <4, <16 ... <4096, >=4096.
+ */
+#define UAVOBJ_PROFILE_HIST_LEN 8
+#define UAVOBJ_PROFILE_TOP_OBJECTS 4
+
+typedef struct {
+	uint32_t lockWait[UAVOBJ_PROFILE_HIST_LEN];
+	uint32_t lockHold[UAVOBJ_PROFILE_HIST_LEN];
+	uint32_t eventLatency[UAVOBJ_PROFILE_HIST_LEN];
+	uint32_t lockWaitMax;
+	uint32_t lockHoldMax;
+	uint32_t eventLatencyMax;
+	uint32_t callbackTimeMax;
+	uint32_t callbackTimeMaxID;
+	uint32_t totalUpdates;
+	/* Objects with the most updates, busiest first */
+	uint32_t busiestID[UAVOBJ_PROFILE_TOP_OBJECTS];
+	uint32_t busiestUpdates[UAVOBJ_PROFILE_TOP_OBJECTS];
+} UAVObjProfile;
+
 typedef void (*new_uavo_instance_cb_t)(uint32_t,uint32_t);
 void UAVObjRegisterNewInstanceCB(new_uavo_instance_cb_t callback);
 
 int32_t UAVObjInitialize();
 void UAVObjGetStats(UAVObjStats* statsOut);
 void UAVObjClearStats();
+#if defined(UAVOBJ_PROFILE)
+void UAVObjGetProfile(UAVObjProfile *profileOut);
+#endif
 UAVObjHandle UAVObjRegister(uint32_t id,
 		int32_t isSingleInstance, int32_t isSettings, uint32_t numBytes, UAVObjInitializeCallback initCb);
+int32_t UAVObjSetFieldLayout(UAVObjHandle obj_handle, const uint16_t *offsets, uint8_t numFields);
 UAVObjHandle UAVObjGetByID(uint32_t id);
 uint32_t UAVObjGetID(UAVObjHandle obj);
 uint32_t UAVObjGetNumBytes(UAVObjHandle obj);
@@ -185,6 +229,7 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId, const vo
 int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn, uint32_t offset, uint32_t size);
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId, void* dataOut);
 int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, void* dataOut, uint32_t offset, uint32_t size);
+int32_t UAVObjGetDirtyRanges(UAVObjHandle obj_handle, uint16_t instId, UAVObjDirtyRange *ranges, uint8_t maxRanges);
 int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata* dataIn);
 int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata* dataOut);
 uint8_t UAVObjGetMetadataAccess(const UAVObjMetadata* dataOut);
@@ -206,6 +251,7 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue)
 int32_t UAVObjConnectQueueThrottled(UAVObjHandle obj_handle, struct pios_queue *queue, uint8_t eventMask, uint16_t interval);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask);
 int32_t UAVObjConnectCallbackThrottled(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask, uint16_t interval);
+int32_t UAVObjConnectCallbackAsync(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask, uint16_t interval, UAVObjEventOverflowPolicy policy);
 void UAVObjUnblockThrottle(struct ObjectEventEntryThrottled *throttled);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, void *cbCtx);
 void UAVObjUpdated(UAVObjHandle obj);
@@ -41,12 +41,93 @@
 #include "pios_mutex.h"
 #include "pios_queue.h"
 #include "pios_thread.h"
+#include "pios_semaphore.h"
+#if defined(UAVOBJ_PROFILE)
+#include "pios_delay.h"
+#endif
 #include "misc_math.h"
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
 // Constants
 
+/*
+ * Number of buckets in the object ID hash index.  Must be a power of two.
+ * Object IDs are already hashes of the object definition, so the low bits
+ * spread well; with ~120 objects this keeps chains to a handful of entries.
+ */
+#ifndef UAVOBJ_ID_HASH_BUCKETS
+#define UAVOBJ_ID_HASH_BUCKETS 32
+#endif
+
+/* Initial size of the instance pointer table of multi-instance objects */
+#define UAVOBJ_INST_TABLE_MIN 4
+
+/*
+ * With UAVOBJ_SEQLOCK defined, reads of data objects do not take the object
+ * lock.  Each data object carries a sequence counter that writers (which
+ * are still serialized by the lock) make odd while they modify any
+ * instance.  Readers copy optimistically and retry if the counter was odd
+ * or changed underneath them.  After UAVOBJ_SEQLOCK_RETRIES failed attempts
+ * the reader falls back to the lock, so a high priority reader that
+ * preempted a writer lets the writer finish instead of spinning forever.
+ */
+#ifndef UAVOBJ_SEQLOCK_RETRIES
+#define UAVOBJ_SEQLOCK_RETRIES 3
+#endif
+
+/*
+ * Instances after the first of a multi-instance object are carved out of
+ * slabs, each holding as many instances as the object already has, up to
+ * this many.
+ */
+#ifndef UAVOBJ_SLAB_MAX_INSTANCES
+#define UAVOBJ_SLAB_MAX_INSTANCES 32
+#endif
+
+/* What a separate heap block per instance would cost; the PiOS heap only
+ * pads blocks to pointer size */
+#ifndef UAVOBJ_HEAP_BLOCK_OVERHEAD
+#define UAVOBJ_HEAP_BLOCK_OVERHEAD 0
+#endif
+
+#define UAVOBJ_HEAP_BLOCK_SIZE(size) \
+	((((size) + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1)) + \
+	 UAVOBJ_HEAP_BLOCK_OVERHEAD)
+
+/*
+ * With UAVOBJ_EVENT_DISPATCHER defined, callbacks connected with
+ * UAVObjConnectCallbackAsync() do not run in the context of the writer.
+ * Their events go into a bounded ring per subscriber (callback and
+ * context pair) and are delivered later by a dispatcher thread, outside
+ * the object lock.  A ring holds UAVOBJ_EVENT_RING_LEN events, or one per
+ * object connected through it if that is more, so a coalescing subscriber
+ * never loses an object to a burst of others.
+ */
+#ifndef UAVOBJ_EVENT_RING_LEN
+#define UAVOBJ_EVENT_RING_LEN 16
+#endif
+
+#ifndef UAVOBJ_EVENT_DISPATCHER_STACK_SIZE
+#define UAVOBJ_EVENT_DISPATCHER_STACK_SIZE 1024
+#endif
+
+#define UAVOBJ_EVENT_DISPATCHER_PRIORITY PIOS_THREAD_PRIO_NORMAL
+
+/*
+ * With UAVOBJ_DIRTY_TRACKING defined, every write compares the new data
+ * against the old and records which fields changed in a bitmap per
+ * instance, so consumers can send or log only those fields.  The field
+ * boundaries come from the generated code via UAVObjSetFieldLayout().
+ */
+
+/*
+ * With UAVOBJ_PROFILE defined, the manager measures how long its lock is
+ * waited for and held, how long callbacks run, how long events wait in
+ * the dispatcher rings and how often each object is updated.  See
+ * UAVObjGetProfile().
+ */
+
 // Private types
 
 // Macros
@@ -59,6 +140,8 @@ extern uintptr_t pios_uavo_settings_fs_id;
 /** opaque type for instances **/
 typedef void* InstanceHandle;
 
+struct UAVOEventRing;
+
 struct ObjectEventEntry {
 	union {
 		struct pios_queue         *queue;
@@ -68,9 +151,35 @@ struct ObjectEventEntry {
 	UAVObjEventCallback       cb;
 	uint8_t                   hasThrottle : 1;
 	uint8_t                   eventMask : 7;
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	/* Non-NULL if the callback is delivered by the dispatcher thread */
+	struct UAVOEventRing    * ring;
+#endif
 	struct ObjectEventEntry * next;
 };
 
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+/* Pending events of one asynchronous subscriber */
+struct UAVOEventRing {
+	UAVObjEventCallback       cb;
+	void                    * cbCtx;
+	UAVObjEventOverflowPolicy policy;
+
+	/* Protected by the object lock */
+	uint16_t                  len;
+	uint16_t                  objects;	/* connected through this ring */
+	uint16_t                  head;
+	uint16_t                  count;
+	UAVObjEvent             * events;
+#if defined(UAVOBJ_PROFILE)
+	/* PIOS_DELAY_GetRaw() when each event was queued */
+	uint32_t                * queued;
+#endif
+
+	struct UAVOEventRing    * next;
+};
+#endif
+
 struct ObjectEventEntryThrottled {
 	struct ObjectEventEntry   entry; // MUST be first! So throttled entry can be interpreted as ObjectEventEntry
 
@@ -82,11 +191,11 @@ struct ObjectEventEntryThrottled {
 /*
   MetaInstance   == [UAVOBase [UAVObjMetadata]]
   SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-                                                  \-->[InstanceData1 [next]]
-                                                  _________...________/
-                                                  \-->[InstanceDataN [next]]
+  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstTable [InstanceData0]]]]]
+                                                     |
+                                                     \-->[&InstanceData0, &InstanceData1, ... &InstanceDataN]
+                                                                         |
+                                     Slabs of packed instances:  [InstanceData1 [InstanceData2]] [InstanceData3 ...]
  */
 
 /*
@@ -123,7 +232,30 @@ struct UAVOData {
 	 */
 	struct UAVOMeta   metaObj;
 	struct UAVOData * next;
+	/* Next object in the same bucket of the ID hash index */
+	struct UAVOData * next_hash;
 	uint16_t          instance_size;
+#if defined(UAVOBJ_SEQLOCK)
+	/* Odd while a writer is modifying any instance of this object */
+	volatile uint32_t seq;
+#endif
+#if defined(UAVOBJ_PROFILE)
+	/* Update events since the last UAVObjGetProfile() */
+	uint32_t          update_count;
+#endif
+#if defined(UAVOBJ_DIRTY_TRACKING)
+	/*
+	 * num_fields + 1 field start offsets, the last one being the
+	 * instance size.  NULL until the layout is set, in which case
+	 * the whole instance is tracked as a single field.
+	 */
+	const uint16_t  * field_offsets;
+	uint8_t           num_fields;
+	/* Number of instances the dirty bitmaps are allocated for */
+	uint16_t          dirty_capacity;
+	/* DirtyWords() bitmap words per instance, indexed by instance ID */
+	uint32_t        * dirty;
+#endif
 } __attribute__((packed));
 
 /* Augmented type for Single Instance Data UAVO */
@@ -137,22 +269,22 @@ struct UAVOSingle {
 	 */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-	struct UAVOMultiInst * next;
-	uint8_t                instance[];
-	/*
-	 * Additional space will be malloc'd here to hold the
-	 * the data for this instance.
-	 */
-} __attribute__((packed));
-
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
-	struct UAVOMultiInst   instance0;
+	uint16_t               inst_table_size;
+	/*
+	 * Table of pointers to the data of each instance, indexed by
+	 * instance ID.  Grown by doubling; superseded tables are never
+	 * freed so that lock-free readers may still walk them.
+	 */
+	void **                inst_table;
+	/* Unused space at the end of the newest instance slab */
+	uint8_t *              slab_next;
+	uint16_t               slab_free;
+	uint8_t                instance0[];
 	/*
 	 * Additional space will be malloc'd here to hold the
 	 * the data for instance 0.
@@ -172,22 +304,24 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void*)(&(( (struct UAVOSingle*)obj )->instance0)))
-#define InstanceDataOffset(inst) ((void*)&(( (struct UAVOMultiInst*)inst )->instance))
 #define InstanceData(instance) (void*)instance
 
 // Private functions
 static int32_t sendEvent(struct UAVOBase *obj, uint16_t instId,
 			UAVObjEventType event, void *obj_data, int len);
+static inline void lockObjects(void);
+static inline void unlockObjects(void);
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId);
 static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId);
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask,
-			uint16_t interval);
+			uint16_t interval, struct UAVOEventRing *ring);
 static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx);
 
 // Private variables
 static struct UAVOData * uavo_list;
+static struct UAVOData * volatile uavo_id_hash[UAVOBJ_ID_HASH_BUCKETS];
 static struct ObjectEventEntry * events_unused;
 static struct ObjectEventEntry * events_unused_throttled;
 static struct pios_recursive_mutex *mutex;
@@ -204,12 +338,27 @@ static const UAVObjMetadata defMetadata = {
 };
 
 static UAVObjStats stats;
+#if defined(UAVOBJ_PROFILE)
+static UAVObjProfile profile;
+/* Protected by the object lock itself */
+static uint16_t lock_depth;
+static uint32_t lock_taken;
+#endif
+/* Heap accounting for instance slabs, not reset by UAVObjClearStats() */
+static uint32_t slab_bytes;
+static uint32_t slab_block_bytes;
 static new_uavo_instance_cb_t newUavObjInstanceCB;
 
 #define UAVO_CB_STACK_SIZE 512
 
 static void *cb_stack;
 
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+static struct UAVOEventRing *event_rings;
+static struct pios_semaphore *dispatcher_sema;
+static struct pios_thread *dispatcher_thread;
+#endif
+
 /**
  * Initialize the object manager
  * \return 0 Success
@@ -219,8 +368,19 @@ int32_t UAVObjInitialize()
 {
 	// Initialize variables
 	uavo_list = NULL;
+	memset((void *) uavo_id_hash, 0, sizeof(uavo_id_hash));
 	events_unused = NULL;
 	events_unused_throttled = NULL;
+	slab_bytes = 0;
+	slab_block_bytes = 0;
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	event_rings = NULL;
+	dispatcher_thread = NULL;
+
+	dispatcher_sema = PIOS_Semaphore_Create();
+	if (dispatcher_sema == NULL)
+		return -1;
+#endif
 
 	// Allocate the stack used for callbacks.
 	cb_stack = PIOS_malloc_no_dma(UAVO_CB_STACK_SIZE);
@@ -250,9 +410,12 @@ int32_t UAVObjInitialize()
  */
 void UAVObjGetStats(UAVObjStats * statsOut)
 {
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 	memcpy(statsOut, &stats, sizeof(UAVObjStats));
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	statsOut->instanceSlabBytes = slab_bytes;
+	statsOut->instanceSlabBytesSaved = (slab_block_bytes > slab_bytes) ?
+		slab_block_bytes - slab_bytes : 0;
+	unlockObjects();
 }
 
 /**
@@ -260,10 +423,53 @@ void UAVObjGetStats(UAVObjStats * statsOut)
  */
 void UAVObjClearStats()
 {
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 	memset(&stats, 0, sizeof(UAVObjStats));
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
+}
+
+#if defined(UAVOBJ_PROFILE)
+/**
+ * Get the profiling counters accumulated since the last call, and reset
+ * them.
+ * \param[out] profileOut The profiling counters
+ */
+void UAVObjGetProfile(UAVObjProfile * profileOut)
+{
+	lockObjects();
+
+	memcpy(profileOut, &profile, sizeof(*profileOut));
+	memset(&profile, 0, sizeof(profile));
+
+	memset(profileOut->busiestID, 0, sizeof(profileOut->busiestID));
+	memset(profileOut->busiestUpdates, 0,
+		sizeof(profileOut->busiestUpdates));
+
+	struct UAVOData *obj;
+	LL_FOREACH(uavo_list, obj) {
+		uint32_t count = obj->update_count;
+		uint32_t id = obj->id;
+
+		obj->update_count = 0;
+
+		/* Insertion into the short list of busiest objects */
+		for (int i = 0; i < UAVOBJ_PROFILE_TOP_OBJECTS && count; i++) {
+			if (count > profileOut->busiestUpdates[i]) {
+				uint32_t tmp_count = profileOut->busiestUpdates[i];
+				uint32_t tmp_id = profileOut->busiestID[i];
+
+				profileOut->busiestUpdates[i] = count;
+				profileOut->busiestID[i] = id;
+
+				count = tmp_count;
+				id = tmp_id;
+			}
+		}
+	}
+
+	unlockObjects();
 }
+#endif /* UAVOBJ_PROFILE */
 
 /************************
  * Object Initialization
@@ -315,6 +521,12 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 	if (!uavo_multi)
 		return (NULL);
 
+	void **inst_table = PIOS_malloc_no_dma(UAVOBJ_INST_TABLE_MIN * sizeof(void *));
+	if (!inst_table) {
+		PIOS_free(uavo_multi);
+		return (NULL);
+	}
+
 	/* Fill in the common part of the UAVO */
 	struct UAVOBase * uavo_base = &(uavo_multi->uavo.base);
 	memset(uavo_base, 0, sizeof(*uavo_base));
@@ -325,13 +537,278 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 	uavo_multi->num_instances = 1;
 
 	/* Clear the instance data carried in the UAVO */
-	uavo_multi->instance0.next = NULL;
-	memset (&(uavo_multi->instance0.instance), 0, num_bytes);
+	memset (&(uavo_multi->instance0), 0, num_bytes);
+
+	/* Instance 0 lives inside the object itself */
+	inst_table[0] = &(uavo_multi->instance0);
+	uavo_multi->inst_table      = inst_table;
+	uavo_multi->inst_table_size = UAVOBJ_INST_TABLE_MIN;
+	uavo_multi->slab_next       = NULL;
+	uavo_multi->slab_free       = 0;
 
 	/* Give back the generic UAVO part */
 	return (&(uavo_multi->uavo));
 }
 
+/**************************
+ * Object Lock
+ *************************/
+
+#if defined(UAVOBJ_PROFILE)
+static void profileRecord(uint32_t *hist, uint32_t *max, uint32_t us)
+{
+	uint8_t bucket = 0;
+	uint32_t limit = 1;
+
+	while (bucket < UAVOBJ_PROFILE_HIST_LEN - 1 && us >= limit) {
+		limit <<= 2;
+		bucket++;
+	}
+
+	hist[bucket]++;
+
+	if (us > *max) {
+		*max = us;
+	}
+}
+#endif /* UAVOBJ_PROFILE */
+
+static inline void lockObjects(void)
+{
+#if defined(UAVOBJ_PROFILE)
+	uint32_t start = PIOS_DELAY_GetRaw();
+#endif
+
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+#if defined(UAVOBJ_PROFILE)
+	/* Only the outermost acquisition can have waited */
+	if (lock_depth++ == 0) {
+		lock_taken = PIOS_DELAY_GetRaw();
+
+		profileRecord(profile.lockWait, &profile.lockWaitMax,
+			PIOS_DELAY_DiffuS2(start, lock_taken));
+	}
+#endif
+}
+
+static inline void unlockObjects(void)
+{
+#if defined(UAVOBJ_PROFILE)
+	if (--lock_depth == 0) {
+		profileRecord(profile.lockHold, &profile.lockHoldMax,
+			PIOS_DELAY_DiffuS(lock_taken));
+	}
+#endif
+
+	PIOS_Recursive_Mutex_Unlock(mutex);
+}
+
+/**************************
+ * Sequence Lock
+ *************************/
+
+/**
+ * Mark the start of a modification of an object's instance data.
+ * Must be called with the object lock held.
+ */
+static inline void UAVObjWriteBegin(struct UAVOBase * obj)
+{
+#if defined(UAVOBJ_SEQLOCK)
+	if (!obj->flags.isMeta) {
+		((struct UAVOData *) obj)->seq++;
+		__sync_synchronize();
+	}
+#endif
+}
+
+/**
+ * Mark the end of a modification started with UAVObjWriteBegin()
+ */
+static inline void UAVObjWriteEnd(struct UAVOBase * obj)
+{
+#if defined(UAVOBJ_SEQLOCK)
+	if (!obj->flags.isMeta) {
+		__sync_synchronize();
+		((struct UAVOData *) obj)->seq++;
+	}
+#endif
+}
+
+/**************************
+ * Dirty Field Tracking
+ *************************/
+
+#if defined(UAVOBJ_DIRTY_TRACKING)
+#define DirtyWords(obj) (((obj)->num_fields + 31) / 32)
+
+static inline uint16_t UAVObjFieldStart(struct UAVOData * obj, uint8_t field)
+{
+	if (!obj->field_offsets) {
+		return field ? obj->instance_size : 0;
+	}
+
+	return obj->field_offsets[field];
+}
+
+/**
+ * Get the dirty bitmap of an instance, growing the bitmap table if
+ * needed.  Must be called with the object lock held.
+ * \return The bitmap or NULL if it could not be allocated
+ */
+static uint32_t * UAVObjDirtyBitmap(struct UAVOData * obj, uint16_t instId)
+{
+	uint8_t words = DirtyWords(obj);
+
+	if (instId >= obj->dirty_capacity) {
+		uint16_t capacity = obj->dirty_capacity ? obj->dirty_capacity : 1;
+
+		while (capacity <= instId) {
+			capacity *= 2;
+		}
+
+		if (capacity > UAVOBJ_MAX_INSTANCES) {
+			capacity = UAVOBJ_MAX_INSTANCES;
+		}
+
+		uint32_t *dirty = PIOS_malloc_no_dma(capacity * words *
+				sizeof(uint32_t));
+		if (!dirty) {
+			return NULL;
+		}
+
+		memset(dirty, 0, capacity * words * sizeof(uint32_t));
+
+		if (obj->dirty) {
+			memcpy(dirty, obj->dirty,
+				obj->dirty_capacity * words * sizeof(uint32_t));
+			PIOS_free(obj->dirty);
+		}
+
+		obj->dirty = dirty;
+		obj->dirty_capacity = capacity;
+	}
+
+	return &obj->dirty[instId * words];
+}
+#endif /* UAVOBJ_DIRTY_TRACKING */
+
+/**
+ * Record which fields a write to an instance is about to change.  Must be
+ * called with the object lock held, before the data is copied.
+ * \param[in] obj The object being written
+ * \param[in] instId The instance being written
+ * \param[in] target The current instance data
+ * \param[in] dataIn The data about to be written at offset, or NULL if it
+ * is not known in advance, in which case all fields in range are marked
+ * \param[in] offset Offset of the write within the instance
+ * \param[in] size Size of the write
+ */
+static void UAVObjMarkDirty(struct UAVOBase * obj_base, uint16_t instId,
+		const uint8_t * target, const uint8_t * dataIn,
+		uint32_t offset, uint32_t size)
+{
+#if defined(UAVOBJ_DIRTY_TRACKING)
+	if (obj_base->flags.isMeta || size == 0) {
+		return;
+	}
+
+	struct UAVOData * obj = (struct UAVOData *) obj_base;
+
+	uint32_t *bitmap = UAVObjDirtyBitmap(obj, instId);
+	if (!bitmap) {
+		return;
+	}
+
+	uint32_t end = offset + size;
+
+	/* Fields are in offset order; skip ahead to the first one written */
+	uint8_t lo = 0, hi = obj->num_fields - 1;
+
+	while (lo < hi) {
+		uint8_t mid = (lo + hi + 1) / 2;
+
+		if (UAVObjFieldStart(obj, mid) <= offset) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	for (uint8_t field = lo; field < obj->num_fields; field++) {
+		uint32_t start = UAVObjFieldStart(obj, field);
+
+		if (start >= end) {
+			break;
+		}
+
+		uint32_t field_end = UAVObjFieldStart(obj, field + 1);
+
+		if (start < offset) {
+			start = offset;
+		}
+
+		if (field_end > end) {
+			field_end = end;
+		}
+
+		if (!dataIn || memcmp(target + start, dataIn + (start - offset),
+					field_end - start)) {
+			bitmap[field / 32] |= 1u << (field % 32);
+		}
+	}
+#else
+	(void) obj_base; (void) instId; (void) target; (void) dataIn;
+	(void) offset; (void) size;
+#endif /* UAVOBJ_DIRTY_TRACKING */
+}
+
+/**************************
+ * UAVObject ID Index
+ *************************/
+
+static inline uint32_t UAVObjHashBucket(uint32_t id)
+{
+	return (id ^ (id >> 16)) & (UAVOBJ_ID_HASH_BUCKETS - 1);
+}
+
+/**
+ * Add a data object to the ID hash index.  Must be called with the
+ * object lock held.  The entry is fully linked before it is published,
+ * and entries are never removed, so lookups need no lock.
+ */
+static void UAVObjHashInsert(struct UAVOData * uavo_data)
+{
+	uint32_t bucket = UAVObjHashBucket(uavo_data->id);
+
+	uavo_data->next_hash = uavo_id_hash[bucket];
+
+	/* Make sure the object is complete before it becomes visible */
+	__sync_synchronize();
+
+	uavo_id_hash[bucket] = uavo_data;
+}
+
+/**
+ * Find a data object by ID in the hash index
+ * \param[in] id The data object ID
+ * \return The object or NULL if not found.
+ */
+static struct UAVOData * UAVObjHashFind(uint32_t id)
+{
+	struct UAVOData * tmp_obj = uavo_id_hash[UAVObjHashBucket(id)];
+
+	while (tmp_obj) {
+		if (tmp_obj->id == id) {
+			return tmp_obj;
+		}
+
+		tmp_obj = tmp_obj->next_hash;
+	}
+
+	return NULL;
+}
+
 /**************************
  * UAVObject Database APIs
  *************************/
@@ -353,7 +830,7 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 {
 	struct UAVOData * uavo_data = NULL;
 
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	/* Don't allow duplicate registrations */
 	if (UAVObjGetByID(id))
@@ -372,6 +849,18 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	/* Fill in the details about this UAVO */
 	uavo_data->id            = id;
 	uavo_data->instance_size = num_bytes;
+#if defined(UAVOBJ_SEQLOCK)
+	uavo_data->seq           = 0;
+#endif
+#if defined(UAVOBJ_PROFILE)
+	uavo_data->update_count  = 0;
+#endif
+#if defined(UAVOBJ_DIRTY_TRACKING)
+	uavo_data->field_offsets  = NULL;
+	uavo_data->num_fields     = 1;
+	uavo_data->dirty_capacity = 0;
+	uavo_data->dirty          = NULL;
+#endif
 	if (isSettings) {
 		uavo_data->base.flags.isSettings = true;
 	}
@@ -393,43 +882,95 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	if (uavo_data->base.flags.isSettings)
 		UAVObjLoad((UAVObjHandle) uavo_data, 0);
 
+	/* Only now can lockless lookups by ID find the object */
+	UAVObjHashInsert(uavo_data);
+
 	// fire events for outer object and its embedded meta object
 	UAVObjInstanceUpdated((UAVObjHandle) uavo_data, 0);
 	UAVObjInstanceUpdated((UAVObjHandle) &(uavo_data->metaObj), 0);
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return (UAVObjHandle) uavo_data;
 }
 
 /**
- * Retrieve an object from the list given its id
+ * Describe the fields of an object, so that changes can be tracked per
+ * field.  Called by the generated initialization code after registration.
+ * \param[in] obj The object handle
+ * \param[in] offsets Start offset of each field, followed by the instance
+ * size; must be in increasing order and stay valid for the life of the
+ * object
+ * \param[in] numFields Number of fields
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjSetFieldLayout(UAVObjHandle obj_handle, const uint16_t *offsets,
+		uint8_t numFields)
+{
+	PIOS_Assert(obj_handle);
+
+	if (UAVObjIsMetaobject(obj_handle) || !offsets || !numFields) {
+		return -1;
+	}
+
+	struct UAVOData * obj = (struct UAVOData *) obj_handle;
+
+	if (offsets[0] != 0 || offsets[numFields] != obj->instance_size) {
+		return -1;
+	}
+
+	for (int i = 0; i < numFields; i++) {
+		if (offsets[i] >= offsets[i + 1]) {
+			return -1;
+		}
+	}
+
+#if defined(UAVOBJ_DIRTY_TRACKING)
+	lockObjects();
+
+	/* The bitmap size changes; changes so far are lost.  Blocks given
+	 * back with PIOS_free() are not reused on every heap, so keep the
+	 * table already allocated and just fit fewer or more instances in. */
+	uint32_t words = obj->dirty_capacity * DirtyWords(obj);
+
+	obj->field_offsets  = offsets;
+	obj->num_fields     = numFields;
+	obj->dirty_capacity = MIN(words / DirtyWords(obj),
+			(uint32_t) UAVOBJ_MAX_INSTANCES);
+
+	if (obj->dirty) {
+		memset(obj->dirty, 0, words * sizeof(uint32_t));
+	}
+
+	unlockObjects();
+#endif
+
+	return 0;
+}
+
+/**
+ * Retrieve an object from the list given its id.  Uses the ID hash index,
+ * so it does not take the object lock.
  * \param[in] The object ID
  * \return The object or NULL if not found.
  */
 UAVObjHandle UAVObjGetByID(uint32_t id)
 {
-	UAVObjHandle found_obj = NULL;
+	struct UAVOData * tmp_obj;
 
-	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	// Look for a data object
+	tmp_obj = UAVObjHashFind(id);
+	if (tmp_obj) {
+		return &tmp_obj->base;
+	}
 
-	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		if (tmp_obj->id == id) {
-			found_obj = &tmp_obj->base;
-			goto unlock_exit;
-		}
-		if (MetaObjectId(tmp_obj->id) == id) {
-			found_obj = &(tmp_obj->metaObj.base);
-			goto unlock_exit;
-		}
+	// Look for a meta object, whose ID is its parent's ID plus one
+	tmp_obj = UAVObjHashFind(id - 1);
+	if (tmp_obj && (MetaObjectId(tmp_obj->id) == id)) {
+		return &(tmp_obj->metaObj.base);
 	}
 
-unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return found_obj;
+	return NULL;
 }
 
 /**
@@ -543,7 +1084,7 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, UAVObjInitializeCallback
 	}
 
 	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	InstanceHandle instEntry;
 	uint16_t instId = 0;
@@ -561,7 +1102,7 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, UAVObjInitializeCallback
 	}
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 
 	return instId;
 }
@@ -621,7 +1162,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 	PIOS_Assert(obj_handle);
 
 	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -659,7 +1200,12 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 		len = obj->instance_size;
 	}
 
+	UAVObjMarkDirty((struct UAVOBase *) obj_handle, instId, target, dataIn,
+		0, len);
+
+	UAVObjWriteBegin((struct UAVOBase *) obj_handle);
 	memcpy(target, dataIn, len);
+	UAVObjWriteEnd((struct UAVOBase *) obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED,
@@ -668,7 +1214,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -684,7 +1230,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t * dataOut)
 	PIOS_Assert(obj_handle);
 
 	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -712,7 +1258,7 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t * dataOut)
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -826,10 +1372,14 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 
 	void *target;
 	int len;
+	int32_t rc = -1;
+
+	// Lock; the load writes straight into the instance data
+	lockObjects();
 
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0)
-			return -1;
+			goto unlock_exit;
 
 		target = MetaDataPtr((struct UAVOMeta *)obj_handle);
 		len = UAVObjGetNumBytes(obj_handle);
@@ -838,37 +1388,52 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 		InstanceHandle instEntry = getInstance( (struct UAVOData *)obj_handle, instId);
 
 		if (instEntry == NULL)
-			return -1;
+			goto unlock_exit;
 
 		target = InstanceData(instEntry);
 		len = UAVObjGetNumBytes(obj_handle);
 	}
 
 	// Load the object from the filesystem
-	int32_t rc;
 #if defined(PIOS_INCLUDE_FASTHEAP)
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			uavobj_load_trampoline,
 			len);
+
+	if (rc == 0) {
+		UAVObjMarkDirty((struct UAVOBase *) obj_handle, instId, target,
+			uavobj_load_trampoline, 0, len);
+
+		UAVObjWriteBegin((struct UAVOBase *) obj_handle);
+		memcpy(target, uavobj_load_trampoline, len);
+		UAVObjWriteEnd((struct UAVOBase *) obj_handle);
+	}
 #else  /* PIOS_INCLUDE_FASTHEAP */
+	/* Loaded in place, so there is nothing to compare against */
+	UAVObjMarkDirty((struct UAVOBase *) obj_handle, instId, target, NULL,
+		0, len);
+
+	UAVObjWriteBegin((struct UAVOBase *) obj_handle);
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			target,
 			len);
+	UAVObjWriteEnd((struct UAVOBase *) obj_handle);
 #endif  /* PIOS_INCLUDE_FASTHEAP */
 
-	if (rc != 0)
-		return -1;
-
-#if defined(PIOS_INCLUDE_FASTHEAP)
-	memcpy(target, uavobj_load_trampoline, len);
-#endif  /* PIOS_INCLUDE_FASTHEAP */
+	if (rc != 0) {
+		rc = -1;
+		goto unlock_exit;
+	}
 
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED, target, len);
-	return 0;
+
+unlock_exit:
+	unlockObjects();
+	return rc;
 }
 
 /**
@@ -893,7 +1458,7 @@ int32_t UAVObjSaveSettings()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -912,7 +1477,7 @@ int32_t UAVObjSaveSettings()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -925,7 +1490,7 @@ int32_t UAVObjLoadSettings()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -944,7 +1509,7 @@ int32_t UAVObjLoadSettings()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -957,7 +1522,7 @@ int32_t UAVObjDeleteSettings()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -976,7 +1541,7 @@ int32_t UAVObjDeleteSettings()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -989,7 +1554,7 @@ int32_t UAVObjSaveMetaobjects()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -1005,7 +1570,7 @@ int32_t UAVObjSaveMetaobjects()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -1018,7 +1583,7 @@ int32_t UAVObjLoadMetaobjects()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -1034,7 +1599,7 @@ int32_t UAVObjLoadMetaobjects()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -1047,7 +1612,7 @@ int32_t UAVObjDeleteMetaobjects()
 	struct UAVOData *obj;
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -1063,7 +1628,7 @@ int32_t UAVObjDeleteMetaobjects()
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -1139,7 +1704,7 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 	PIOS_Assert(obj_handle);
 
 	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	int32_t rc = -1;
 
@@ -1188,8 +1753,13 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 		goto unlock_exit;
 	}
 
+	UAVObjMarkDirty((struct UAVOBase *) obj_handle, instId, target, dataIn,
+		offset, size);
+
 	// Set data
+	UAVObjWriteBegin((struct UAVOBase *) obj_handle);
 	memcpy(target + offset, dataIn, size);
+	UAVObjWriteEnd((struct UAVOBase *) obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED,
@@ -1197,7 +1767,7 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return rc;
 }
 
@@ -1211,42 +1781,60 @@ unlock_exit:
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 			void *dataOut)
 {
-	PIOS_Assert(obj_handle);
+	return UAVObjGetInstanceDataField(obj_handle, instId, dataOut,
+		0, INSTANCE_COPY_ALL);
+}
 
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+#if defined(UAVOBJ_SEQLOCK)
+/**
+ * Optimistically copy instance data without taking the object lock
+ * \param[in] obj The data object
+ * \param[in] instId The object instance ID
+ * \param[out] dataOut Destination buffer
+ * \param[in] offset Offset into the instance data
+ * \param[in] size Number of bytes, or INSTANCE_COPY_ALL
+ * \return 0 if success, -1 if failure, 1 if the caller must retry locked
+ */
+static int32_t readInstanceSeqlock(struct UAVOData * obj, uint16_t instId,
+			void *dataOut, uint32_t offset, uint32_t size)
+{
+	if (size == INSTANCE_COPY_ALL) {
+		size = obj->instance_size;
+	}
 
-	int32_t rc = -1;
+	// Check for overrun
+	if ((size + offset) > obj->instance_size) {
+		return -1;
+	}
 
-	if (UAVObjIsMetaobject(obj_handle)) {
-		// Get instance information
-		if (instId != 0) {
-			goto unlock_exit;
+	for (int i = 0; i < UAVOBJ_SEQLOCK_RETRIES; i++) {
+		uint32_t seq = obj->seq;
+
+		if (seq & 1) {
+			// Writer in progress
+			continue;
 		}
-		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-	} else {
-		struct UAVOData *obj;
-		InstanceHandle instEntry;
 
-		// Cast to object info
-		obj = (struct UAVOData *) obj_handle;
+		__sync_synchronize();
 
-		// Get instance information
-		instEntry = getInstance(obj, instId);
+		// Instances are never removed, so this is safe unlocked
+		InstanceHandle instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
-		// Set data
-		memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
-	}
 
-	rc = 0;
+		memcpy(dataOut, InstanceData(instEntry) + offset, size);
 
-unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
-	return rc;
+		__sync_synchronize();
+
+		if (obj->seq == seq) {
+			return 0;
+		}
+	}
+
+	return 1;
 }
+#endif /* UAVOBJ_SEQLOCK */
 
 /**
  * Get the data of a specific object instance
@@ -1259,24 +1847,42 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-
 	int32_t rc = -1;
 
+#if defined(UAVOBJ_SEQLOCK)
+	if (!UAVObjIsMetaobject(obj_handle)) {
+		rc = readInstanceSeqlock((struct UAVOData *) obj_handle, instId,
+			dataOut, offset, size);
+
+		if (rc <= 0) {
+			return rc;
+		}
+
+		// Too much write contention, take the lock instead
+		rc = -1;
+	}
+#endif
+
+	// Lock
+	lockObjects();
+
 	if (UAVObjIsMetaobject(obj_handle)) {
 		// Get instance information
 		if (instId != 0) {
 			goto unlock_exit;
 		}
 
+		if (size == INSTANCE_COPY_ALL) {
+			size = MetaNumBytes;
+		}
+
 		// Check for overrun
 		if ((size + offset) > MetaNumBytes) {
 			goto unlock_exit;
 		}
 
 		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+		memcpy(dataOut, (uint8_t *) MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
 	} else {
 		struct UAVOData * obj;
 		InstanceHandle instEntry;
@@ -1290,6 +1896,10 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 			goto unlock_exit;
 		}
 
+		if (size == INSTANCE_COPY_ALL) {
+			size = obj->instance_size;
+		}
+
 		// Check for overrun
 		if ((size + offset) > obj->instance_size) {
 			goto unlock_exit;
@@ -1302,7 +1912,80 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 	rc = 0;
 
 unlock_exit:
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
+	return rc;
+}
+
+/**
+ * Get the byte ranges of an instance that changed since the last call,
+ * and clear them.  Changes are tracked per field, adjacent changed fields
+ * are merged into one range.  Clearing on read means there should be only
+ * one consumer of the dirty state of an object.
+ *
+ * Without UAVOBJ_DIRTY_TRACKING the whole instance is always reported.
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ * \param[out] ranges The changed ranges, in offset order
+ * \param[in] maxRanges Size of ranges; if there are more, the last one
+ * is extended to cover the rest
+ * \return Number of ranges or -1 if failure
+ */
+int32_t UAVObjGetDirtyRanges(UAVObjHandle obj_handle, uint16_t instId,
+			UAVObjDirtyRange *ranges, uint8_t maxRanges)
+{
+	PIOS_Assert(obj_handle);
+
+	if (UAVObjIsMetaobject(obj_handle) || maxRanges == 0) {
+		return -1;
+	}
+
+	struct UAVOData * obj = (struct UAVOData *) obj_handle;
+	int32_t rc = -1;
+
+	lockObjects();
+
+	if (getInstance(obj, instId) == NULL) {
+		goto unlock_exit;
+	}
+
+#if defined(UAVOBJ_DIRTY_TRACKING)
+	rc = 0;
+
+	if (instId >= obj->dirty_capacity) {
+		// Never written
+		goto unlock_exit;
+	}
+
+	uint32_t *bitmap = &obj->dirty[instId * DirtyWords(obj)];
+
+	for (uint8_t field = 0; field < obj->num_fields; field++) {
+		if (!(bitmap[field / 32] & (1u << (field % 32)))) {
+			continue;
+		}
+
+		uint16_t start = UAVObjFieldStart(obj, field);
+		uint16_t end = UAVObjFieldStart(obj, field + 1);
+
+		if (rc > 0 && ranges[rc - 1].offset + ranges[rc - 1].size == start) {
+			ranges[rc - 1].size = end - ranges[rc - 1].offset;
+		} else if (rc < maxRanges) {
+			ranges[rc].offset = start;
+			ranges[rc].size = end - start;
+			rc++;
+		} else {
+			ranges[rc - 1].size = end - ranges[rc - 1].offset;
+		}
+	}
+
+	memset(bitmap, 0, DirtyWords(obj) * sizeof(uint32_t));
+#else
+	ranges[0].offset = 0;
+	ranges[0].size = obj->instance_size;
+	rc = 1;
+#endif /* UAVOBJ_DIRTY_TRACKING */
+
+unlock_exit:
+	unlockObjects();
 	return rc;
 }
 
@@ -1321,11 +2004,11 @@ int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata * dataIn
 		return -1;
 	}
 
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	UAVObjSetData((UAVObjHandle) MetaObjectPtr((struct UAVOData *)obj_handle), dataIn);
 
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return 0;
 }
 
@@ -1340,7 +2023,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 	PIOS_Assert(obj_handle);
 
 	// Lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	// Get metadata
 	if (UAVObjIsMetaobject(obj_handle)) {
@@ -1351,7 +2034,7 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 	}
 
 	// Unlock
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return 0;
 }
 
@@ -1515,9 +2198,9 @@ int32_t UAVObjConnectQueueThrottled(UAVObjHandle obj_handle,
 	PIOS_Assert(obj_handle);
 	PIOS_Assert(queue);
 	int32_t res;
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, queue, NULL, NULL, eventMask, interval);
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	lockObjects();
+	res = connectObj(obj_handle, queue, NULL, NULL, eventMask, interval, NULL);
+	unlockObjects();
 	return res;
 }
 
@@ -1538,9 +2221,9 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue)
 	PIOS_Assert(obj_handle);
 	PIOS_Assert(queue);
 	int32_t res;
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 	res = disconnectObj(obj_handle, queue, NULL, NULL);
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return res;
 }
 
@@ -1595,9 +2278,9 @@ int32_t UAVObjConnectCallbackThrottled(UAVObjHandle obj_handle, UAVObjEventCallb
 {
 	PIOS_Assert(obj_handle);
 	int32_t res;
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, interval);
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	lockObjects();
+	res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, interval, NULL);
+	unlockObjects();
 	return res;
 }
 
@@ -1607,8 +2290,215 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
 	return UAVObjConnectCallbackThrottled(obj_handle, cb, cbCtx, eventMask, 0);
 }
 
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+static void eventDispatcherTask(void *parameters);
+
+/**
+ * Give a ring room for len events, keeping the ones pending.
+ * Must be called with the object lock held.
+ * \return 0 if success or -1 if failure
+ */
+static int32_t growEventRing(struct UAVOEventRing *ring, uint16_t len)
+{
+	UAVObjEvent *events = PIOS_malloc_no_dma(len * sizeof(*events));
+	if (events == NULL) {
+		return -1;
+	}
+
+#if defined(UAVOBJ_PROFILE)
+	uint32_t *queued = PIOS_malloc_no_dma(len * sizeof(*queued));
+	if (queued == NULL) {
+		PIOS_free(events);
+		return -1;
+	}
+#endif
+
+	for (int i = 0; i < ring->count; i++) {
+		events[i] = ring->events[(ring->head + i) % ring->len];
+#if defined(UAVOBJ_PROFILE)
+		queued[i] = ring->queued[(ring->head + i) % ring->len];
+#endif
+	}
+
+	if (ring->events) {
+		PIOS_free(ring->events);
+	}
+	ring->events = events;
+
+#if defined(UAVOBJ_PROFILE)
+	if (ring->queued) {
+		PIOS_free(ring->queued);
+	}
+	ring->queued = queued;
+#endif
+
+	ring->head = 0;
+	ring->len = len;
+
+	return 0;
+}
+
+/**
+ * Find or create the event ring of an asynchronous subscriber.
+ * Must be called with the object lock held.
+ */
+static struct UAVOEventRing *getEventRing(UAVObjEventCallback cb, void *cbCtx,
+		UAVObjEventOverflowPolicy policy)
+{
+	struct UAVOEventRing *ring;
+
+	LL_FOREACH(event_rings, ring) {
+		if (ring->cb == cb && ring->cbCtx == cbCtx) {
+			ring->policy = policy;
+			return ring;
+		}
+	}
+
+	ring = PIOS_malloc_no_dma(sizeof(*ring));
+	if (ring == NULL) {
+		return NULL;
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	ring->cb = cb;
+	ring->cbCtx = cbCtx;
+	ring->policy = policy;
+
+	if (growEventRing(ring, UAVOBJ_EVENT_RING_LEN)) {
+		PIOS_free(ring);
+		return NULL;
+	}
+
+	LL_APPEND(event_rings, ring);
+
+	return ring;
+}
+
+/**
+ * Get the event ring an object delivers a callback through, if any.
+ * Must be called with the object lock held.
+ */
+static struct UAVOEventRing *connectedRing(struct UAVOBase *obj,
+		UAVObjEventCallback cb, void *cbCtx)
+{
+	struct ObjectEventEntry *event;
+
+	LL_FOREACH(obj->next_event, event) {
+		if (event->cb == cb && event->cbInfo.cbCtx == cbCtx) {
+			return event->ring;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Drop the pending events of an object from a ring, keeping the order of
+ * the rest.  Must be called with the object lock held.
+ */
+static void purgeRingEvents(struct UAVOEventRing *ring, UAVObjHandle obj)
+{
+	uint16_t kept = 0;
+
+	for (int i = 0; i < ring->count; i++) {
+		uint16_t from = (ring->head + i) % ring->len;
+		uint16_t to = (ring->head + kept) % ring->len;
+
+		if (ring->events[from].obj == obj) {
+			continue;
+		}
+
+		ring->events[to] = ring->events[from];
+#if defined(UAVOBJ_PROFILE)
+		ring->queued[to] = ring->queued[from];
+#endif
+		kept++;
+	}
+
+	ring->count = kept;
+}
+#endif /* UAVOBJ_EVENT_DISPATCHER */
+
+/**
+ * Connect an event callback to the object that is invoked from the event
+ * dispatcher thread instead of the context that updated the object.  The
+ * writer only pays for queueing the event, so slow callbacks do not add
+ * latency to it.  Because the data may have changed again by the time the
+ * callback runs, it is called without the object data (NULL, 0) and should
+ * read the object itself if needed.
+ *
+ * A callback the dispatcher has already started on may still run after
+ * UAVObjDisconnectCallback() returns, at most once per subscriber, so the
+ * callback and its context must stay valid for that.
+ *
+ * Without UAVOBJ_EVENT_DISPATCHER this is the same as
+ * UAVObjConnectCallbackThrottled().
+ * \param[in] obj The object handle
+ * \param[in] cb The event callback
+ * \param[in] cbCtx The event callback context
+ * \param[in] eventMask The event mask, if EV_MASK_ALL_UPDATES then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] interval The interval at which to throttle updates; 0 is unthrottled
+ * \param[in] policy What to do when events arrive faster than they are dispatched
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectCallbackAsync(UAVObjHandle obj_handle, UAVObjEventCallback cb,
+			void *cbCtx, uint8_t eventMask, uint16_t interval,
+			UAVObjEventOverflowPolicy policy)
+{
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	PIOS_Assert(obj_handle);
+	PIOS_Assert(cb);
+	int32_t res = -1;
+	lockObjects();
+
+	if (dispatcher_thread == NULL) {
+		dispatcher_thread = PIOS_Thread_Create(eventDispatcherTask,
+				"UAVOEvents",
+				UAVOBJ_EVENT_DISPATCHER_STACK_SIZE, NULL,
+				UAVOBJ_EVENT_DISPATCHER_PRIORITY);
+
+		if (dispatcher_thread == NULL) {
+			goto unlock_exit;
+		}
+	}
+
+	struct UAVOEventRing *ring = getEventRing(cb, cbCtx, policy);
+	if (ring == NULL) {
+		goto unlock_exit;
+	}
+
+	bool connected = connectedRing((struct UAVOBase *) obj_handle, cb,
+			cbCtx) == ring;
+
+	/* Double the ring rather than grow it a slot at a time: blocks given
+	 * back with PIOS_free() are not reused on every heap, so this bounds
+	 * what is lost to the size of the final ring. */
+	if (!connected && ring->objects >= ring->len &&
+			growEventRing(ring, MIN(2 * ring->len, UINT16_MAX))) {
+		goto unlock_exit;
+	}
+
+	res = connectObj(obj_handle, 0, cb, cbCtx, eventMask, interval, ring);
+
+	if (res == 0 && !connected) {
+		ring->objects++;
+	}
+
+unlock_exit:
+	unlockObjects();
+	return res;
+#else
+	(void) policy;
+
+	return UAVObjConnectCallbackThrottled(obj_handle, cb, cbCtx, eventMask,
+			interval);
+#endif /* UAVOBJ_EVENT_DISPATCHER */
+}
+
 /**
- * Disconnect an event callback from the object.
+ * Disconnect an event callback from the object.  Events still queued for
+ * an asynchronous callback are dropped, but one already being delivered
+ * may complete after this returns; see UAVObjConnectCallbackAsync().
  * \param[in] obj The object handle
  * \param[in] cb The event callback
  * \return 0 if success or -1 if failure
@@ -1618,9 +2508,20 @@ int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb
 {
 	PIOS_Assert(obj_handle);
 	int32_t res;
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	struct UAVOEventRing *ring =
+		connectedRing((struct UAVOBase *) obj_handle, cb, cbCtx);
+#endif
 	res = disconnectObj(obj_handle, 0, cb, cbCtx);
-	PIOS_Recursive_Mutex_Unlock(mutex);
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	if (res == 0 && ring) {
+		// Drop what is still queued for it
+		purgeRingEvents(ring, obj_handle);
+		ring->objects--;
+	}
+#endif
+	unlockObjects();
 	return res;
 }
 
@@ -1641,10 +2542,10 @@ void UAVObjUpdated(UAVObjHandle obj_handle)
 void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
 	PIOS_Assert(obj_handle);
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 	sendEvent((struct UAVOBase *) obj_handle, instId, EV_UPDATED_MANUAL,
 		NULL, 0);
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 }
 
 /**
@@ -1657,7 +2558,7 @@ void UAVObjIterate(void (*iterator) (UAVObjHandle obj))
 	PIOS_Assert(iterator);
 
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	// Iterate through the list and invoke iterator for each object
 	struct UAVOData *obj;
@@ -1667,7 +2568,7 @@ void UAVObjIterate(void (*iterator) (UAVObjHandle obj))
 	}
 
 	// Release lock
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 }
 
 /* type signature must match invokeCallback below, with 4 or fewer args */
@@ -1722,6 +2623,129 @@ static void invokeCallback(const struct ObjectEventEntry *event,
 #define invokeCallback realInvokeCallback
 #endif
 
+#if defined(UAVOBJ_PROFILE)
+/**
+ * Record the execution time of a callback.  The object lock is recursive,
+ * so this may be called with or without it held.
+ */
+static void profileCallback(const UAVObjEvent *msg, uint32_t us)
+{
+	lockObjects();
+
+	if (us > profile.callbackTimeMax) {
+		profile.callbackTimeMax = us;
+		profile.callbackTimeMaxID = UAVObjGetID(msg->obj);
+	}
+
+	unlockObjects();
+}
+#endif /* UAVOBJ_PROFILE */
+
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+/**
+ * Queue an event for an asynchronous subscriber.  Called with the object
+ * lock held.
+ * \return true if an older event had to be dropped
+ */
+static bool pushRingEvent(struct UAVOEventRing *ring, const UAVObjEvent *msg)
+{
+	bool dropped = false;
+
+	if (ring->policy == UAVOBJ_EV_OVERFLOW_COALESCE) {
+		for (int i = 0; i < ring->count; i++) {
+			UAVObjEvent *pend =
+				&ring->events[(ring->head + i) % ring->len];
+
+			if (pend->obj == msg->obj && pend->instId == msg->instId) {
+				/* Already pending; the callback will see the
+				 * latest data anyways. */
+				pend->event = msg->event;
+				return false;
+			}
+		}
+	}
+
+	if (ring->count >= ring->len) {
+		ring->head = (ring->head + 1) % ring->len;
+		ring->count--;
+		dropped = true;
+	}
+
+	ring->events[(ring->head + ring->count) % ring->len] = *msg;
+#if defined(UAVOBJ_PROFILE)
+	ring->queued[(ring->head + ring->count) % ring->len] =
+		PIOS_DELAY_GetRaw();
+#endif
+	ring->count++;
+
+	return dropped;
+}
+
+/**
+ * Take the oldest pending event of a subscriber.
+ * \return true if an event was returned
+ */
+static bool popRingEvent(struct UAVOEventRing *ring, UAVObjEvent *msg)
+{
+	bool found = false;
+
+	lockObjects();
+
+	if (ring->count) {
+		*msg = ring->events[ring->head];
+#if defined(UAVOBJ_PROFILE)
+		profileRecord(profile.eventLatency, &profile.eventLatencyMax,
+			PIOS_DELAY_DiffuS(ring->queued[ring->head]));
+#endif
+		ring->head = (ring->head + 1) % ring->len;
+		ring->count--;
+		found = true;
+	}
+
+	unlockObjects();
+
+	return found;
+}
+
+/**
+ * Event dispatcher task.  Delivers queued events to asynchronous
+ * subscribers, round-robin so one busy subscriber cannot starve the rest.
+ */
+static void eventDispatcherTask(void *parameters)
+{
+	(void) parameters;
+
+	while (1) {
+		PIOS_Semaphore_Take(dispatcher_sema, PIOS_SEMAPHORE_TIMEOUT_MAX);
+
+		bool pending;
+
+		do {
+			pending = false;
+
+			struct UAVOEventRing *ring;
+			LL_FOREACH(event_rings, ring) {
+				UAVObjEvent msg;
+
+				if (popRingEvent(ring, &msg)) {
+#if defined(UAVOBJ_PROFILE)
+					uint32_t start = PIOS_DELAY_GetRaw();
+#endif
+
+					ring->cb(&msg, ring->cbCtx, NULL, 0);
+
+#if defined(UAVOBJ_PROFILE)
+					profileCallback(&msg,
+						PIOS_DELAY_DiffuS(start));
+#endif
+					pending = true;
+				}
+			}
+		} while (pending);
+	}
+}
+#endif /* UAVOBJ_EVENT_DISPATCHER */
+
 static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
 	// Go through each object and push the event message in the queue (if event is activated for the queue)
 	struct ObjectEventEntry *event;
@@ -1757,9 +2781,29 @@ static int32_t pumpOneEvent(UAVObjEvent *msg, void *obj_data, int len) {
 			}
 
 			// Invoke callback (from event task) if a valid one is registered
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+			if (event->ring) {
+				// defer to the dispatcher thread
+				if (pushRingEvent(event->ring, msg)) {
+					stats.lastQueueErrorID =
+						UAVObjGetID(msg->obj);
+					++stats.eventQueueErrors;
+				}
+
+				PIOS_Semaphore_Give(dispatcher_sema);
+			} else
+#endif
 			if (event->cb) {
+#if defined(UAVOBJ_PROFILE)
+				uint32_t start = PIOS_DELAY_GetRaw();
+#endif
+
 				// invoke callback directly; callbacks must be well behaved
 				invokeCallback(event, msg, obj_data, len);
+
+#if defined(UAVOBJ_PROFILE)
+				profileCallback(msg, PIOS_DELAY_DiffuS(start));
+#endif
 			} else if (event->cbInfo.queue) {
 				if (event->hasThrottle) {
 					throtInfo->inhibited = 1;
@@ -1818,6 +2862,13 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	 * trigger callback B which triggers callback A.  Don't do that.
 	 */
 
+#if defined(UAVOBJ_PROFILE)
+	if (!obj->flags.isMeta && (triggered_event & EV_MASK_ALL_UPDATES)) {
+		((struct UAVOData *) obj)->update_count++;
+		profile.totalUpdates++;
+	}
+#endif
+
 	if (num_pending >= 3) {
 		/* Unable to pump event; backlog too long */
 		stats.eventCallbackErrors++;
@@ -1870,12 +2921,54 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	return 0;
 }
 
+/**
+ * Take the data for a new instance from the object's current slab,
+ * allocating a new slab if it is used up.  Instances are packed back to
+ * back; the manager only ever accesses them with memcpy.
+ * \return The zeroed instance data, or NULL if out of memory
+ */
+static InstanceHandle allocInstance(struct UAVOMulti * uavo_multi)
+{
+	uint16_t size = uavo_multi->uavo.instance_size;
+
+	if (!uavo_multi->slab_free) {
+		uint16_t count = uavo_multi->num_instances;
+
+		if (count > UAVOBJ_SLAB_MAX_INSTANCES) {
+			count = UAVOBJ_SLAB_MAX_INSTANCES;
+		}
+
+		if (count > UAVOBJ_MAX_INSTANCES - uavo_multi->num_instances) {
+			count = UAVOBJ_MAX_INSTANCES - uavo_multi->num_instances;
+		}
+
+		uint8_t *slab = PIOS_malloc_no_dma(count * size);
+		if (!slab)
+			return NULL;
+		memset(slab, 0, count * size);
+
+		uavo_multi->slab_next = slab;
+		uavo_multi->slab_free = count;
+
+		slab_bytes += UAVOBJ_HEAP_BLOCK_SIZE(count * size);
+	}
+
+	InstanceHandle instEntry = uavo_multi->slab_next;
+
+	uavo_multi->slab_next += size;
+	uavo_multi->slab_free--;
+
+	slab_block_bytes += UAVOBJ_HEAP_BLOCK_SIZE(size);
+
+	return instEntry;
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
  */
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 {
-	struct UAVOMultiInst *instEntry;
+	InstanceHandle instEntry;
 
 	/* Don't allow more than one instance for single instance objects */
 	if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1900,14 +2993,36 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 		}
 	}
 
+	struct UAVOMulti *uavo_multi = (struct UAVOMulti *) obj;
+
+	/* Grow the instance table if it is full */
+	if (instId >= uavo_multi->inst_table_size) {
+		uint16_t new_size = uavo_multi->inst_table_size * 2;
+
+		void **new_table = PIOS_malloc_no_dma(new_size * sizeof(void *));
+		if (!new_table)
+			return NULL;
+
+		memcpy(new_table, uavo_multi->inst_table,
+			uavo_multi->inst_table_size * sizeof(void *));
+
+		/* Publish the copy before anyone can index past the old size.
+		 * The old table is left in place for concurrent readers. */
+		__sync_synchronize();
+		uavo_multi->inst_table      = new_table;
+		uavo_multi->inst_table_size = new_size;
+	}
+
 	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
+	instEntry = allocInstance(uavo_multi);
 	if (!instEntry)
 		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
-	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
 
-	( (struct UAVOMulti*)obj )->num_instances++;
+	uavo_multi->inst_table[instId] = instEntry;
+
+	/* The table entry must be visible before the instance count covers it */
+	__sync_synchronize();
+	uavo_multi->num_instances++;
 
 	// Fire event
 	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
@@ -1916,7 +3031,7 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 	if (newUavObjInstanceCB) {
 		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(&obj->base));
 	}
-	return InstanceDataOffset(instEntry);
+	return instEntry;
 }
 
 /**
@@ -1950,17 +3065,10 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 		if (instId >= uavo_multi->num_instances)
 			return NULL;
 
-		// Look for specified instance ID
-		uint16_t instance = 0;
-		struct UAVOMultiInst *instEntry;
-		LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-			if (instance++ == instId) {
-				/* Found it */
-				return &(instEntry->instance);
-			}
-		}
-		/* Instance was not found */
-		return NULL;
+		/* Instance count is only bumped after the table entry is
+		 * written, so the entry is valid here. */
+		__sync_synchronize();
+		return uavo_multi->inst_table[instId];
 	}
 }
 
@@ -1975,7 +3083,7 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
  */
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb, void *cbCtx, uint8_t eventMask,
-			uint16_t interval)
+			uint16_t interval, struct UAVOEventRing *ring)
 {
 	if (queue && cb) {
 		return -1;
@@ -1992,6 +3100,9 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 				((!event->cb) && event->cbInfo.queue == queue)) {
 			// Already connected, update event mask and throttling (if possible)
 			event->eventMask = eventMask;
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+			event->ring = ring;
+#endif
 			if (event->hasThrottle) {
 				if (interval == 0) {
 					event->hasThrottle = 0;
@@ -2025,7 +3136,7 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 		unused = &events_unused_throttled;
 	}
 
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 	if (*unused != NULL) {
 		// We can re-use the memory of a previously disconnected event
 		event = *unused;
@@ -2034,11 +3145,11 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 	else {
 		event =	(struct ObjectEventEntry *) PIOS_malloc_no_dma(mallocSize);
 		if (event == NULL) {
-			PIOS_Recursive_Mutex_Unlock(mutex);
+			unlockObjects();
 			return -1;
 		}
 	}
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 
 	memset(event, 0, mallocSize);
 	event->cb = cb;
@@ -2051,6 +3162,11 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 
 	event->eventMask = eventMask;
 	event->hasThrottle = 0;
+#if defined(UAVOBJ_EVENT_DISPATCHER)
+	event->ring = ring;
+#else
+	(void) ring;
+#endif
 
 	if (interval) {
 		event->hasThrottle = 1;
@@ -2086,14 +3202,14 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 				((!event->cb) && event->cbInfo.queue == queue)) {
 			LL_DELETE(obj->next_event, event);
 			// store the unused memory for future reuse
-			PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+			lockObjects();
 			if (event->hasThrottle) {
 				LL_APPEND(events_unused_throttled, event);
 			}
 			else {
 				LL_APPEND(events_unused, event);
 			}
-			PIOS_Recursive_Mutex_Unlock(mutex);
+			unlockObjects();
 			return 0;
 		}
 	}
@@ -2137,7 +3253,7 @@ uint8_t UAVObjCount()
 {
 	uint8_t count = 0;
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	// Look for object
 	struct UAVOData * tmp_obj;
@@ -2146,7 +3262,7 @@ uint8_t UAVObjCount()
 	}
 
 	// Release lock
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return count;
 }
 
@@ -2158,7 +3274,7 @@ uint32_t UAVObjIDByIndex(uint8_t index)
 {
 	uint8_t count = 0;
 	// Get lock
-	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	lockObjects();
 
 	// Look for object
 	struct UAVOData * tmp_obj;
@@ -2166,14 +3282,14 @@ uint32_t UAVObjIDByIndex(uint8_t index)
 		if (count == index)
 		{
 			// Release lock
-			PIOS_Recursive_Mutex_Unlock(mutex);
+			unlockObjects();
 			return tmp_obj->id;
 		}
 		++count;
 	}
 
 	// Release lock
-	PIOS_Recursive_Mutex_Unlock(mutex);
+	unlockObjects();
 	return 0;
 }
 
@@ -39,12 +39,20 @@
  */
 
 #include <string.h>
+#include "openpilot.h"
 #include "uavobjectmanager.h"
 #include "$(NAMELC).h"
 
 // Private variables
 static UAVObjHandle handle = NULL;
 
+#if defined(UAVOBJ_DIRTY_TRACKING)
+// Start offset of each field, followed by the object size
+static const uint16_t fieldOffsets[] = {
+$(FIELDOFFSETS)
+};
+#endif
+
 /**
  * Initialize object.
  * \return 0 Success
@@ -63,6 +71,13 @@ int32_t $(NAME)Initialize(void)
 	// Done
 	if (handle != 0)
 	{
+#if defined(UAVOBJ_DIRTY_TRACKING)
+		int32_t layout = UAVObjSetFieldLayout(handle, fieldOffsets,
+				sizeof(fieldOffsets) / sizeof(fieldOffsets[0]) - 1);
+
+		// A generated layout that does not match the object is a bug
+		PIOS_Assert(layout == 0);
+#endif
 		return 0;
 	}
 	else
@@ -60,6 +60,18 @@
 
 #define PIOS_RCVR_MAX_CHANNELS			12
 
+/* UAVObject manager: read object data without the global lock */
+#define UAVOBJ_SEQLOCK
+
+/* UAVObject manager: deliver asynchronous callbacks from a dispatcher thread */
+#define UAVOBJ_EVENT_DISPATCHER
+
+/* UAVObject manager: track which fields of each instance changed */
+#define UAVOBJ_DIRTY_TRACKING
+
+/* UAVObject manager: measure lock contention and event latency */
+#define UAVOBJ_PROFILE
+
 /* COM Module */
 #define PIOS_TELEM_STACK_SIZE           PIOS_THREAD_STACK_SIZE_MIN
 
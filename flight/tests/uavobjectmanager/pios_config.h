@@ -0,0 +1,12 @@
+#define PIOS_INCLUDE_FLASH
+#define PIOS_NO_HW
+#define FLIGHT_POSIX
+
+#define UAVOBJ_SEQLOCK
+#define UAVOBJ_EVENT_DISPATCHER
+#define UAVOBJ_EVENT_RING_LEN 16
+#define UAVOBJ_DIRTY_TRACKING
+#define UAVOBJ_PROFILE
+
+/* glibc malloc chunk header */
+#define UAVOBJ_HEAP_BLOCK_OVERHEAD sizeof(size_t)
@@ -0,0 +1,7 @@
+/* Stand-in for the generated TaskInfo UAVObject, needed by taskmonitor.h */
+#ifndef TASKINFO_H
+#define TASKINFO_H
+
+typedef uint8_t TaskInfoRunningElem;
+
+#endif /* TASKINFO_H */
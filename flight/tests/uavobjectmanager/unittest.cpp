@@ -0,0 +1,759 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <malloc.h>		/* mallinfo2 */
+#include <unistd.h>		/* usleep */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+extern "C" {
+
+#include "openpilot.h"
+#include "uavobjectmanager.h"	/* API for the object manager */
+
+}
+
+/* Same number of objects as shared/uavobjectdefinition */
+#define NUM_OBJECTS 122
+
+#define MULTI_OBJ_ID 0x5A5A0000
+#define MULTI_OBJ_SIZE 24
+
+#define STRESS_OBJ_ID 0x3C3C0000
+#define STRESS_OBJ_SIZE 64
+
+#define SLAB_OBJ_ID 0x1E1E0000
+#define SLAB_OBJ_SIZE 20
+
+static uint32_t obj_ids[NUM_OBJECTS];
+static UAVObjHandle obj_handles[NUM_OBJECTS];
+static UAVObjHandle multi_handle;
+static UAVObjHandle stress_handle;
+static UAVObjHandle slab_handle;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjManager : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    /* Object IDs are hashes; a fixed LCG gives a similar spread */
+    uint32_t id = 0x8f34288;
+
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+      id = id * 1664525 + 1013904223;
+
+      /* Data IDs are even, the meta object takes ID + 1 */
+      obj_ids[i] = id & ~1;
+      obj_handles[i] = UAVObjRegister(obj_ids[i], 1, 0,
+		      4 + (i % 64), NULL);
+      ASSERT_TRUE(obj_handles[i] != NULL);
+    }
+
+    multi_handle = UAVObjRegister(MULTI_OBJ_ID, 0, 0, MULTI_OBJ_SIZE,
+		    NULL);
+    ASSERT_TRUE(multi_handle != NULL);
+
+    stress_handle = UAVObjRegister(STRESS_OBJ_ID, 1, 0, STRESS_OBJ_SIZE,
+		    NULL);
+    ASSERT_TRUE(stress_handle != NULL);
+
+    slab_handle = UAVObjRegister(SLAB_OBJ_ID, 0, 0, SLAB_OBJ_SIZE, NULL);
+    ASSERT_TRUE(slab_handle != NULL);
+  }
+
+  virtual void SetUp() {
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(UAVObjManager, LookupById) {
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    EXPECT_EQ(obj_handles[i], UAVObjGetByID(obj_ids[i]));
+    EXPECT_EQ(obj_ids[i], UAVObjGetID(obj_handles[i]));
+  }
+};
+
+TEST_F(UAVObjManager, LookupMetaById) {
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    UAVObjHandle meta = UAVObjGetByID(obj_ids[i] + 1);
+
+    ASSERT_TRUE(meta != NULL);
+    EXPECT_TRUE(UAVObjIsMetaobject(meta));
+    EXPECT_EQ(UAVObjGetLinkedObj(obj_handles[i]), meta);
+    EXPECT_EQ(obj_ids[i] + 1, UAVObjGetID(meta));
+  }
+};
+
+TEST_F(UAVObjManager, LookupMissing) {
+  EXPECT_TRUE(UAVObjGetByID(0x12345678) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(MULTI_OBJ_ID + 2) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(MULTI_OBJ_ID - 1) == NULL);
+};
+
+TEST_F(UAVObjManager, DuplicateRegistration) {
+  EXPECT_TRUE(UAVObjRegister(obj_ids[0], 1, 0, 4, NULL) == NULL);
+  EXPECT_EQ(NUM_OBJECTS + 3, UAVObjCount());
+};
+
+TEST_F(UAVObjManager, MultiInstanceAccess) {
+  uint8_t data[MULTI_OBJ_SIZE];
+
+  while (UAVObjGetNumInstances(multi_handle) < 40) {
+    EXPECT_NE(0, UAVObjCreateInstance(multi_handle, NULL));
+  }
+
+  for (uint16_t inst = 0; inst < 40; inst++) {
+    memset(data, inst, sizeof(data));
+    EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, inst, data));
+  }
+
+  for (uint16_t inst = 0; inst < 40; inst++) {
+    memset(data, 0xff, sizeof(data));
+    EXPECT_EQ(0, UAVObjGetInstanceData(multi_handle, inst, data));
+
+    for (int i = 0; i < MULTI_OBJ_SIZE; i++) {
+      EXPECT_EQ(inst, data[i]);
+    }
+  }
+
+  EXPECT_EQ(-1, UAVObjGetInstanceData(multi_handle, 40, data));
+
+  /* Unpacking past the end creates the missing instances */
+  memset(data, 0xaa, sizeof(data));
+  EXPECT_EQ(0, UAVObjUnpack(multi_handle, 99, data));
+  EXPECT_EQ(100, UAVObjGetNumInstances(multi_handle));
+  EXPECT_EQ(0, UAVObjGetInstanceData(multi_handle, 39, data));
+  EXPECT_EQ(39, data[0]);
+};
+
+TEST_F(UAVObjManager, DirtyRanges) {
+  UAVObjHandle obj = obj_handles[63];
+  static const uint16_t offsets[] = { 0, 4, 8, 16, 40, 67 };
+  uint8_t data[67];
+  UAVObjDirtyRange ranges[4];
+
+  ASSERT_EQ(67u, UAVObjGetNumBytes(obj));
+  EXPECT_EQ(-1, UAVObjSetFieldLayout(obj, offsets, 4));
+  ASSERT_EQ(0, UAVObjSetFieldLayout(obj, offsets, 5));
+
+  EXPECT_EQ(0, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+
+  /* Only fields whose contents change are dirty */
+  memset(data, 0, sizeof(data));
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  data[5] = 1;
+  data[20] ^= 0xff;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+
+  ASSERT_EQ(2, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+  EXPECT_EQ(4, ranges[0].offset);
+  EXPECT_EQ(4, ranges[0].size);
+  EXPECT_EQ(16, ranges[1].offset);
+  EXPECT_EQ(24, ranges[1].size);
+
+  /* Cleared on read, and rewriting the same data changes nothing */
+  EXPECT_EQ(0, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  EXPECT_EQ(0, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+
+  /* A write spanning fields 1 and 2 merges into one range */
+  uint8_t span[6] = { 9, 9, 9, 9, 9, 9 };
+  ASSERT_EQ(0, UAVObjSetDataField(obj, span, 6, sizeof(span)));
+  ASSERT_EQ(1, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+  EXPECT_EQ(4, ranges[0].offset);
+  EXPECT_EQ(12, ranges[0].size);
+
+  /* Ranges beyond the limit are folded into the last one */
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  data[0]++;
+  data[8]++;
+  data[66]++;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  ASSERT_EQ(2, UAVObjGetDirtyRanges(obj, 0, ranges, 2));
+  EXPECT_EQ(0, ranges[0].offset);
+  EXPECT_EQ(4, ranges[0].size);
+  EXPECT_EQ(8, ranges[1].offset);
+  EXPECT_EQ(59, ranges[1].size);
+};
+
+TEST_F(UAVObjManager, FieldLayoutKeepsBitmap) {
+  UAVObjHandle obj = obj_handles[62];
+  static const uint16_t offsets[] = { 0, 2, 10, 66 };
+  uint8_t data[66];
+  UAVObjDirtyRange ranges[4];
+
+  /* The first write allocates a bitmap for the default layout */
+  memset(data, 0, sizeof(data));
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  data[0]++;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+
+  /* A new layout reuses it, with the changes so far cleared */
+  size_t heap_before = mallinfo2().uordblks;
+  ASSERT_EQ(0, UAVObjSetFieldLayout(obj, offsets, 3));
+  EXPECT_EQ(0, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+
+  data[12]++;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  EXPECT_EQ(heap_before, mallinfo2().uordblks);
+
+  ASSERT_EQ(1, UAVObjGetDirtyRanges(obj, 0, ranges, 4));
+  EXPECT_EQ(10, ranges[0].offset);
+  EXPECT_EQ(56, ranges[0].size);
+};
+
+TEST_F(UAVObjManager, DirtyRangesMultiInstance) {
+  static const uint16_t offsets[] = { 0, 8, 16, MULTI_OBJ_SIZE };
+  uint8_t data[MULTI_OBJ_SIZE];
+  UAVObjDirtyRange ranges[3];
+
+  ASSERT_EQ(0, UAVObjSetFieldLayout(multi_handle, offsets, 3));
+
+  while (UAVObjGetNumInstances(multi_handle) < 40) {
+    EXPECT_NE(0, UAVObjCreateInstance(multi_handle, NULL));
+  }
+
+  ASSERT_EQ(0, UAVObjGetInstanceData(multi_handle, 37, data));
+  data[MULTI_OBJ_SIZE - 1] ^= 0x55;
+  ASSERT_EQ(0, UAVObjSetInstanceData(multi_handle, 37, data));
+
+  EXPECT_EQ(0, UAVObjGetDirtyRanges(multi_handle, 36, ranges, 3));
+  ASSERT_EQ(1, UAVObjGetDirtyRanges(multi_handle, 37, ranges, 3));
+  EXPECT_EQ(16, ranges[0].offset);
+  EXPECT_EQ(8, ranges[0].size);
+
+  /* Earlier instances keep their state when the bitmaps grow */
+  ASSERT_EQ(0, UAVObjGetInstanceData(multi_handle, 2, data));
+  data[0] ^= 0x55;
+  ASSERT_EQ(0, UAVObjSetInstanceData(multi_handle, 2, data));
+  ASSERT_EQ(0, UAVObjUnpack(multi_handle, 39, data));
+  ASSERT_EQ(1, UAVObjGetDirtyRanges(multi_handle, 2, ranges, 3));
+  EXPECT_EQ(0, ranges[0].offset);
+
+  EXPECT_EQ(-1, UAVObjGetDirtyRanges(multi_handle, 999, ranges, 3));
+};
+
+#define BENCH_ROUNDS 20000
+
+#define SLAB_INSTANCES 500
+
+static uint64_t time_instance_reads(uint16_t inst)
+{
+  uint8_t data[SLAB_OBJ_SIZE];
+  uint64_t best = UINT64_MAX;
+
+  for (int round = 0; round < 5; round++) {
+    uint64_t start = now_ns();
+
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+      UAVObjGetInstanceData(slab_handle, inst, data);
+    }
+
+    uint64_t elapsed = now_ns() - start;
+
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  return best / BENCH_ROUNDS;
+}
+
+TEST_F(UAVObjManager, SlabInstances) {
+  uint8_t data[SLAB_OBJ_SIZE];
+  UAVObjStats before, after;
+
+  UAVObjGetStats(&before);
+  size_t heap_before = mallinfo2().uordblks;
+
+  while (UAVObjGetNumInstances(slab_handle) < SLAB_INSTANCES) {
+    ASSERT_NE(0, UAVObjCreateInstance(slab_handle, NULL));
+  }
+
+  size_t heap_used = mallinfo2().uordblks - heap_before;
+  UAVObjGetStats(&after);
+
+  uint32_t slab_used = after.instanceSlabBytes - before.instanceSlabBytes;
+
+  printf("%d instances of %d bytes: %zu bytes of heap, %u in slabs, "
+      "%u saved in total\n", SLAB_INSTANCES, SLAB_OBJ_SIZE, heap_used,
+      slab_used, after.instanceSlabBytesSaved);
+
+  /* Slabs are filled before another is allocated, with little overhead */
+  EXPECT_GE(slab_used, (SLAB_INSTANCES - 1) * SLAB_OBJ_SIZE * 1u);
+  EXPECT_LT(slab_used, (SLAB_INSTANCES - 1) * SLAB_OBJ_SIZE * 21u / 20);
+  EXPECT_GT(after.instanceSlabBytesSaved, before.instanceSlabBytesSaved);
+
+  /* The rest of the footprint is the instance table and its old copies */
+  EXPECT_LT(heap_used, slab_used + 4 * SLAB_INSTANCES * sizeof(void *));
+
+  for (uint16_t inst = 0; inst < SLAB_INSTANCES; inst++) {
+    memset(data, inst & 0xff, sizeof(data));
+    data[0] = inst >> 8;
+    ASSERT_EQ(0, UAVObjSetInstanceData(slab_handle, inst, data));
+  }
+
+  /* Neighbouring instances don't overlap */
+  for (uint16_t inst = 0; inst < SLAB_INSTANCES; inst++) {
+    ASSERT_EQ(0, UAVObjGetInstanceData(slab_handle, inst, data));
+    EXPECT_EQ(inst >> 8, data[0]);
+
+    for (int i = 1; i < SLAB_OBJ_SIZE; i++) {
+      EXPECT_EQ(inst & 0xff, data[i]);
+    }
+  }
+
+  /* Access time does not depend on the instance ID */
+  uint64_t first = time_instance_reads(0);
+  uint64_t last = time_instance_reads(SLAB_INSTANCES - 1);
+
+  printf("Instance 0: %llu ns/read, instance %d: %llu ns/read\n",
+      (unsigned long long) first, SLAB_INSTANCES - 1,
+      (unsigned long long) last);
+
+  EXPECT_LT(last, 2 * first + 50);
+};
+
+TEST_F(UAVObjManager, LookupBenchmark) {
+  uint64_t start = now_ns();
+  uintptr_t sum = 0;
+
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+      sum += (uintptr_t) UAVObjGetByID(obj_ids[i] + (r & 1));
+    }
+  }
+
+  uint64_t elapsed = now_ns() - start;
+
+  EXPECT_NE(0u, sum);
+
+  printf("UAVObjGetByID: %d objects, %.1f ns/lookup\n", NUM_OBJECTS,
+      (double) elapsed / (BENCH_ROUNDS * NUM_OBJECTS));
+};
+
+TEST_F(UAVObjManager, InstanceAccessBenchmark) {
+  uint8_t data[MULTI_OBJ_SIZE];
+  uint16_t num_inst = UAVObjGetNumInstances(multi_handle);
+
+  uint64_t start = now_ns();
+
+  for (int r = 0; r < BENCH_ROUNDS / 10; r++) {
+    for (uint16_t inst = 0; inst < num_inst; inst++) {
+      UAVObjGetInstanceData(multi_handle, inst, data);
+    }
+  }
+
+  uint64_t elapsed = now_ns() - start;
+
+  printf("UAVObjGetInstanceData: %d instances, %.1f ns/read\n", num_inst,
+      (double) elapsed / (BENCH_ROUNDS / 10 * num_inst));
+};
+
+#define STRESS_RUN_MS 200
+
+/* Readers check every byte matches the first, so torn reads are caught */
+static void stress_readers(int num_readers, uint64_t *reads, uint32_t *torn)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> total_reads(0);
+  std::atomic<uint32_t> total_torn(0);
+
+  std::thread writer([&]() {
+    uint8_t data[STRESS_OBJ_SIZE];
+    uint8_t val = 0;
+
+    while (!stop) {
+      memset(data, val++, sizeof(data));
+      UAVObjSetData(stress_handle, data);
+    }
+  });
+
+  std::vector<std::thread> readers;
+
+  for (int i = 0; i < num_readers; i++) {
+    readers.push_back(std::thread([&]() {
+      uint8_t data[STRESS_OBJ_SIZE];
+      uint64_t my_reads = 0;
+      uint32_t my_torn = 0;
+
+      while (!stop) {
+        UAVObjGetData(stress_handle, data);
+
+        for (int j = 1; j < STRESS_OBJ_SIZE; j++) {
+          if (data[j] != data[0]) {
+            my_torn++;
+            break;
+          }
+        }
+
+        my_reads++;
+      }
+
+      total_reads += my_reads;
+      total_torn += my_torn;
+    }));
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(STRESS_RUN_MS));
+  stop = true;
+
+  for (auto &t : readers) {
+    t.join();
+  }
+
+  writer.join();
+
+  *reads = total_reads;
+  *torn = total_torn;
+}
+
+TEST_F(UAVObjManager, ConcurrentReadStress) {
+  for (int num_readers = 1; num_readers <= 8; num_readers *= 2) {
+    uint64_t reads;
+    uint32_t torn;
+
+    stress_readers(num_readers, &reads, &torn);
+
+    EXPECT_EQ(0u, torn);
+    EXPECT_NE(0u, reads);
+
+    printf("%d reader(s) + 1 writer: %.2f Mreads/s\n", num_readers,
+        reads / (STRESS_RUN_MS * 1000.0));
+  }
+};
+
+struct async_sub {
+  std::atomic<uint32_t> delivered;
+  std::atomic<uint32_t> null_data;
+  std::atomic<bool> entered;
+  std::atomic<bool> hold;
+  std::thread::id thread;
+};
+
+static void async_cb(const UAVObjEvent *ev, void *ctx, void *obj_data,
+    int len)
+{
+  struct async_sub *sub = (struct async_sub *) ctx;
+
+  (void) ev;
+
+  sub->thread = std::this_thread::get_id();
+
+  if (obj_data == NULL && len == 0) {
+    sub->null_data++;
+  }
+
+  sub->entered = true;
+
+  while (sub->hold) {
+    std::this_thread::yield();
+  }
+
+  sub->delivered++;
+}
+
+static bool wait_delivered(struct async_sub *sub, uint32_t count)
+{
+  uint64_t deadline = now_ns() + 1000000000ULL;
+
+  while (sub->delivered < count) {
+    if (now_ns() > deadline) {
+      return false;
+    }
+
+    std::this_thread::yield();
+  }
+
+  /* Anything more would show up shortly */
+  usleep(20000);
+
+  return sub->delivered == count;
+}
+
+static void async_sub_init(struct async_sub *sub, bool hold)
+{
+  sub->delivered = 0;
+  sub->null_data = 0;
+  sub->entered = false;
+  sub->hold = hold;
+}
+
+/* Blocks the dispatcher in the callback of the first event */
+static void async_block_dispatcher(struct async_sub *sub, uint8_t *data)
+{
+  EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, 0, data));
+
+  while (!sub->entered) {
+    std::this_thread::yield();
+  }
+}
+
+TEST_F(UAVObjManager, AsyncDelivery) {
+  static struct async_sub sub;
+  uint8_t data[MULTI_OBJ_SIZE] = { 0 };
+
+  async_sub_init(&sub, false);
+
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(multi_handle, async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_DROP_OLDEST));
+
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, 0, data));
+    EXPECT_TRUE(wait_delivered(&sub, i + 1));
+  }
+
+  EXPECT_EQ(5u, sub.null_data);
+  EXPECT_NE(std::this_thread::get_id(), sub.thread);
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(multi_handle, async_cb, &sub));
+};
+
+TEST_F(UAVObjManager, AsyncDropOldest) {
+  static struct async_sub sub;
+  uint8_t data[MULTI_OBJ_SIZE] = { 0 };
+  UAVObjStats before, after;
+
+  async_sub_init(&sub, true);
+
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(multi_handle, async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_DROP_OLDEST));
+
+  async_block_dispatcher(&sub, data);
+
+  UAVObjGetStats(&before);
+
+  /* Writers are never blocked by the stuck subscriber */
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, i % 2, data));
+  }
+
+  UAVObjGetStats(&after);
+  EXPECT_EQ(100u - UAVOBJ_EVENT_RING_LEN,
+      after.eventQueueErrors - before.eventQueueErrors);
+  EXPECT_EQ((uint32_t) MULTI_OBJ_ID, after.lastQueueErrorID);
+
+  sub.hold = false;
+  EXPECT_TRUE(wait_delivered(&sub, 1 + UAVOBJ_EVENT_RING_LEN));
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(multi_handle, async_cb, &sub));
+};
+
+TEST_F(UAVObjManager, AsyncCoalesce) {
+  static struct async_sub sub;
+  uint8_t data[MULTI_OBJ_SIZE] = { 0 };
+  UAVObjStats before, after;
+
+  async_sub_init(&sub, true);
+
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(multi_handle, async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_COALESCE));
+
+  async_block_dispatcher(&sub, data);
+
+  UAVObjGetStats(&before);
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, i % 2, data));
+  }
+
+  /* One pending event per instance, nothing dropped */
+  UAVObjGetStats(&after);
+  EXPECT_EQ(before.eventQueueErrors, after.eventQueueErrors);
+
+  sub.hold = false;
+  EXPECT_TRUE(wait_delivered(&sub, 1 + 2));
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(multi_handle, async_cb, &sub));
+};
+
+TEST_F(UAVObjManager, AsyncCoalesceManyObjects) {
+  static struct async_sub sub;
+  uint8_t data[128] = { 0 };
+  UAVObjStats before, after;
+  const int first = 20, count = 3 * UAVOBJ_EVENT_RING_LEN;
+
+  async_sub_init(&sub, true);
+
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(multi_handle, async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_COALESCE));
+
+  for (int i = first; i < first + count; i++) {
+    ASSERT_EQ(0, UAVObjConnectCallbackAsync(obj_handles[i], async_cb, &sub,
+        EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_COALESCE));
+  }
+
+  async_block_dispatcher(&sub, data);
+
+  UAVObjGetStats(&before);
+
+  for (int i = first; i < first + count; i++) {
+    EXPECT_EQ(0, UAVObjSetData(obj_handles[i], data));
+  }
+
+  /* The ring has room for every object connected through it */
+  UAVObjGetStats(&after);
+  EXPECT_EQ(before.eventQueueErrors, after.eventQueueErrors);
+
+  sub.hold = false;
+  EXPECT_TRUE(wait_delivered(&sub, 1 + count));
+
+  for (int i = first; i < first + count; i++) {
+    EXPECT_EQ(0, UAVObjDisconnectCallback(obj_handles[i], async_cb, &sub));
+  }
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(multi_handle, async_cb, &sub));
+};
+
+TEST_F(UAVObjManager, AsyncDisconnectPurges) {
+  static struct async_sub sub;
+  uint8_t data[128] = { 0 };
+
+  async_sub_init(&sub, true);
+
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(multi_handle, async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_DROP_OLDEST));
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(obj_handles[70], async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_DROP_OLDEST));
+
+  async_block_dispatcher(&sub, data);
+
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(0, UAVObjSetData(obj_handles[70], data));
+  }
+  EXPECT_EQ(0, UAVObjSetInstanceData(multi_handle, 0, data));
+
+  /* Events queued for the object go away with the connection */
+  EXPECT_EQ(0, UAVObjDisconnectCallback(obj_handles[70], async_cb, &sub));
+
+  sub.hold = false;
+  EXPECT_TRUE(wait_delivered(&sub, 1 + 1));
+
+  EXPECT_EQ(0, UAVObjDisconnectCallback(multi_handle, async_cb, &sub));
+};
+
+static void slow_cb(const UAVObjEvent *ev, void *ctx, void *obj_data,
+    int len)
+{
+  (void) ev; (void) ctx; (void) obj_data; (void) len;
+
+  usleep(2000);
+}
+
+static uint32_t hist_total(const uint32_t *hist)
+{
+  uint32_t total = 0;
+
+  for (int i = 0; i < UAVOBJ_PROFILE_HIST_LEN; i++) {
+    total += hist[i];
+  }
+
+  return total;
+}
+
+TEST_F(UAVObjManager, Profile) {
+  UAVObjProfile prof;
+  uint8_t data[8] = { 0 };
+  static struct async_sub sub;
+
+  /* Start from a clean slate */
+  UAVObjGetProfile(&prof);
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(0, UAVObjSetData(obj_handles[5], data));
+  }
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(0, UAVObjSetData(obj_handles[6], data));
+  }
+
+  ASSERT_EQ(0, UAVObjConnectCallback(obj_handles[7], slow_cb, NULL,
+      EV_UPDATED));
+  ASSERT_EQ(0, UAVObjSetData(obj_handles[7], data));
+  ASSERT_EQ(0, UAVObjDisconnectCallback(obj_handles[7], slow_cb, NULL));
+
+  async_sub_init(&sub, false);
+  ASSERT_EQ(0, UAVObjConnectCallbackAsync(obj_handles[8], async_cb, &sub,
+      EV_UPDATED, 0, UAVOBJ_EV_OVERFLOW_DROP_OLDEST));
+  ASSERT_EQ(0, UAVObjSetData(obj_handles[8], data));
+  EXPECT_TRUE(wait_delivered(&sub, 1));
+  ASSERT_EQ(0, UAVObjDisconnectCallback(obj_handles[8], async_cb, &sub));
+
+  UAVObjGetProfile(&prof);
+
+  EXPECT_EQ(112u, prof.totalUpdates);
+  EXPECT_EQ(obj_ids[5], prof.busiestID[0]);
+  EXPECT_EQ(100u, prof.busiestUpdates[0]);
+  EXPECT_EQ(obj_ids[6], prof.busiestID[1]);
+  EXPECT_EQ(10u, prof.busiestUpdates[1]);
+
+  /* Every write takes the lock at least once */
+  EXPECT_LE(112u, hist_total(prof.lockWait));
+  EXPECT_EQ(hist_total(prof.lockWait), hist_total(prof.lockHold));
+  EXPECT_GE(prof.lockHoldMax, 2000u);
+
+  EXPECT_GE(prof.callbackTimeMax, 2000u);
+  EXPECT_EQ(obj_ids[7], prof.callbackTimeMaxID);
+
+  EXPECT_EQ(1u, hist_total(prof.eventLatency));
+
+  /* Counters are reset by reading them */
+  UAVObjGetProfile(&prof);
+  EXPECT_EQ(0u, prof.totalUpdates);
+  EXPECT_EQ(0u, prof.busiestUpdates[0]);
+};
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,8 @@
+/* Stand-in for flight/PiOS/openpilot.h, which needs generated UAVObjects */
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+#include "pios.h"
+#include "uavobjectmanager.h"
+
+#endif /* OPENPILOT_H */
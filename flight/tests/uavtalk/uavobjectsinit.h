@@ -0,0 +1,9 @@
+/* Stand-in for the generated uavobjectsinit.h; only the largest object
+ * size is needed, to size the UAVTalk buffers.
+ */
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+#define UAVOBJECTS_LARGEST 200
+
+#endif /* UAVOBJECTSINIT_H */
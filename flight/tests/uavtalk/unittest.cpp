@@ -0,0 +1,522 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+#include <vector>
+
+extern "C" {
+
+#include "openpilot.h"
+#include "uavobjectmanager.h"	/* API for the object manager */
+#include "uavtalk.h"		/* API for the telemetry protocol */
+#include "pios_crc.h"		/* PIOS_CRC32_updateCRC */
+
+}
+
+/* IDs avoid the sync byte so frames only resync where intended */
+#define SINGLE_OBJ_ID 0x10203040
+#define SINGLE_OBJ_SIZE 12
+
+#define MULTI_OBJ_ID 0x50607080
+#define MULTI_OBJ_SIZE 30
+#define MULTI_OBJ_INSTANCES 3
+
+#define BIG_OBJ_ID 0x0A0B0C0D
+#define BIG_OBJ_SIZE 150
+
+#define BENCH_BYTES (4 * 1024 * 1024)
+
+static UAVObjHandle single_handle;
+static UAVObjHandle multi_handle;
+static UAVObjHandle big_handle;
+
+/* The recorded telemetry stream, and what it should decode to */
+static std::vector<uint8_t> stream;
+static uint8_t single_data[SINGLE_OBJ_SIZE];
+static uint8_t multi_data[MULTI_OBJ_INSTANCES][MULTI_OBJ_SIZE];
+static uint8_t big_data[BIG_OBJ_SIZE];
+
+/* Expected counts for one pass over the stream */
+static uint32_t stream_objects;
+static int stream_nacks;
+static int stream_acks_sent;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int32_t record_output(void *ctx, uint8_t *data, int32_t length)
+{
+  std::vector<uint8_t> *out = (std::vector<uint8_t> *) ctx;
+
+  out->insert(out->end(), data, data + length);
+
+  return length;
+}
+
+struct receiver {
+  int acks;
+  int nacks;
+  int frames_sent;
+};
+
+static int32_t count_output(void *ctx, uint8_t *data, int32_t length)
+{
+  (void) data;
+
+  ((struct receiver *) ctx)->frames_sent++;
+
+  return length;
+}
+
+static void count_ack(void *ctx, uint32_t obj_id, uint16_t inst_id)
+{
+  (void) obj_id; (void) inst_id;
+
+  ((struct receiver *) ctx)->acks++;
+}
+
+static void count_nack(void *ctx, uint32_t obj_id, uint16_t inst_id)
+{
+  (void) obj_id; (void) inst_id;
+
+  ((struct receiver *) ctx)->nacks++;
+}
+
+static void record_req(void *ctx, uint32_t obj_id, uint16_t inst_id)
+{
+  (void) inst_id;
+
+  ((std::vector<uint32_t> *) ctx)->push_back(obj_id);
+}
+
+static void fill(uint8_t *data, int len, int seed)
+{
+  for (int i = 0; i < len; i++) {
+    data[i] = 0x40 | ((seed + i) & 0x3f);
+  }
+}
+
+static void clear_objects()
+{
+  uint8_t zero[BIG_OBJ_SIZE] = { 0 };
+
+  UAVObjSetData(single_handle, zero);
+  UAVObjSetData(big_handle, zero);
+
+  for (uint16_t i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+    UAVObjSetInstanceData(multi_handle, i, zero);
+  }
+}
+
+static void check_objects()
+{
+  uint8_t data[BIG_OBJ_SIZE];
+
+  ASSERT_EQ(0, UAVObjGetData(single_handle, data));
+  EXPECT_EQ(0, memcmp(data, single_data, SINGLE_OBJ_SIZE));
+
+  ASSERT_EQ(0, UAVObjGetData(big_handle, data));
+  EXPECT_EQ(0, memcmp(data, big_data, BIG_OBJ_SIZE));
+
+  for (uint16_t i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+    ASSERT_EQ(0, UAVObjGetInstanceData(multi_handle, i, data));
+    EXPECT_EQ(0, memcmp(data, multi_data[i], MULTI_OBJ_SIZE));
+  }
+}
+
+/* Feeds the stream through the byte-at-a-time state machine */
+static void decode_bytewise(UAVTalkConnection conn, const uint8_t *buf,
+    int len)
+{
+  for (int i = 0; i < len; i++) {
+    if (UAVTalkProcessInputStreamQuiet(conn, buf[i]) ==
+        UAVTALK_STATE_COMPLETE) {
+      UAVTalkReceiveObject(conn);
+    }
+  }
+}
+
+/* Feeds the stream through the bulk path in chunks of 1..max_chunk bytes */
+static void decode_bulk(UAVTalkConnection conn, const uint8_t *buf, int len,
+    int max_chunk)
+{
+  int i = 0;
+
+  while (i < len) {
+    int chunk = 1 + rand() % max_chunk;
+
+    if (chunk > len - i) {
+      chunk = len - i;
+    }
+
+    UAVTalkProcessInputStream(conn, (uint8_t *) buf + i, chunk);
+    i += chunk;
+  }
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVTalkRx : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    single_handle = UAVObjRegister(SINGLE_OBJ_ID, 1, 0, SINGLE_OBJ_SIZE,
+		    NULL);
+    ASSERT_TRUE(single_handle != NULL);
+
+    multi_handle = UAVObjRegister(MULTI_OBJ_ID, 0, 0, MULTI_OBJ_SIZE, NULL);
+    ASSERT_TRUE(multi_handle != NULL);
+
+    while (UAVObjGetNumInstances(multi_handle) < MULTI_OBJ_INSTANCES) {
+      ASSERT_NE(0, UAVObjCreateInstance(multi_handle, NULL));
+    }
+
+    big_handle = UAVObjRegister(BIG_OBJ_ID, 1, 0, BIG_OBJ_SIZE, NULL);
+    ASSERT_TRUE(big_handle != NULL);
+
+    fill(single_data, SINGLE_OBJ_SIZE, 1);
+    fill(big_data, BIG_OBJ_SIZE, 2);
+
+    for (int i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+      fill(multi_data[i], MULTI_OBJ_SIZE, 3 + i);
+    }
+
+    record_stream();
+  }
+
+  /* Records a representative mix of frames, as a link would carry them */
+  static void record_stream() {
+    UAVTalkConnection tx = UAVTalkInitialize(&stream, record_output,
+        NULL, NULL, NULL, NULL);
+    ASSERT_TRUE(tx != NULL);
+
+    ASSERT_EQ(0, UAVObjSetData(single_handle, single_data));
+    ASSERT_EQ(0, UAVObjSetData(big_handle, big_data));
+
+    for (uint16_t i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+      ASSERT_EQ(0, UAVObjSetInstanceData(multi_handle, i, multi_data[i]));
+    }
+
+    /* Line noise ahead of the first frame */
+    for (int i = 0; i < 7; i++) {
+      stream.push_back(0x3c ^ (i + 1));
+    }
+
+    EXPECT_EQ(0, UAVTalkSendObject(tx, single_handle, 0, 0));
+    EXPECT_EQ(0, UAVTalkSendObject(tx, big_handle, 0, 1));
+    EXPECT_EQ(0, UAVTalkSendObject(tx, multi_handle, 1, 0));
+    EXPECT_EQ(0, UAVTalkSendNack(tx, 0x12345678, 0));
+    stream_objects += 4;	/* The NACK counts as a received object */
+    stream_nacks++;
+    stream_acks_sent++;
+
+    /* A frame with a broken CRC, which is dropped */
+    size_t start = stream.size();
+    EXPECT_EQ(0, UAVTalkSendObject(tx, single_handle, 0, 0));
+    stream.back() ^= 0x5a;
+    ASSERT_GT(stream.size(), start);
+
+    for (uint16_t i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+      EXPECT_EQ(0, UAVTalkSendObjectBatched(tx, multi_handle, i));
+    }
+    EXPECT_EQ(0, UAVTalkSendObjectBatched(tx, single_handle, 0));
+    EXPECT_EQ(0, UAVTalkFlushBatch(tx));
+    stream_objects += MULTI_OBJ_INSTANCES + 1;
+
+    EXPECT_EQ(0, UAVTalkSendObject(tx, big_handle, 0, 0));
+    EXPECT_EQ(0, UAVTalkSendObject(tx, multi_handle, 2, 1));
+    stream_objects += 2;
+    stream_acks_sent++;
+  }
+
+  virtual void SetUp() {
+    clear_objects();
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(UAVTalkRx, BytewiseDecode) {
+  struct receiver rx = { 0, 0, 0 };
+  UAVTalkConnection conn = UAVTalkInitialize(&rx, count_output, count_ack,
+      NULL, NULL, NULL);
+  ASSERT_TRUE(conn != NULL);
+
+  decode_bytewise(conn, stream.data(), stream.size());
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(conn, &stats);
+
+  EXPECT_EQ(stream_objects, stats.rxObjects);
+  EXPECT_EQ(1u, stats.rxCRC);
+  EXPECT_EQ(stream_nacks, rx.acks);
+  EXPECT_EQ(stream_acks_sent, rx.frames_sent);
+
+  check_objects();
+};
+
+TEST_F(UAVTalkRx, NackCallback) {
+  struct receiver rx = { 0, 0, 0 };
+
+  /* With a nack callback, nacks no longer reach the ack callback */
+  UAVTalkConnection conn = UAVTalkInitialize(&rx, count_output, count_ack,
+      count_nack, NULL, NULL);
+  ASSERT_TRUE(conn != NULL);
+
+  decode_bytewise(conn, stream.data(), stream.size());
+
+  EXPECT_EQ(0, rx.acks);
+  EXPECT_EQ(stream_nacks, rx.nacks);
+};
+
+TEST_F(UAVTalkRx, BulkDecodeMatchesBytewise) {
+  srand(1234);
+
+  for (int max_chunk = 1; max_chunk <= 256; max_chunk *= 4) {
+    struct receiver rx = { 0, 0, 0 };
+    UAVTalkConnection conn = UAVTalkInitialize(&rx, count_output, count_ack,
+        NULL, NULL, NULL);
+    ASSERT_TRUE(conn != NULL);
+
+    clear_objects();
+
+    /* Twice over, so a frame straddles the seam between passes */
+    decode_bulk(conn, stream.data(), stream.size(), max_chunk);
+    decode_bulk(conn, stream.data(), stream.size(), max_chunk);
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(conn, &stats);
+
+    EXPECT_EQ(2 * stream_objects, stats.rxObjects) << "chunk " << max_chunk;
+    EXPECT_EQ(2 * stream.size(), stats.rxBytes) << "chunk " << max_chunk;
+    EXPECT_EQ(2u, stats.rxCRC) << "chunk " << max_chunk;
+    EXPECT_EQ(2 * stream_nacks, rx.acks) << "chunk " << max_chunk;
+    EXPECT_EQ(2 * stream_acks_sent, rx.frames_sent) << "chunk " << max_chunk;
+
+    check_objects();
+  }
+};
+
+TEST_F(UAVTalkRx, TruncatedFrame) {
+  struct receiver rx = { 0, 0, 0 };
+  UAVTalkConnection conn = UAVTalkInitialize(&rx, count_output, count_ack,
+      NULL, NULL, NULL);
+  ASSERT_TRUE(conn != NULL);
+
+  /* A frame cut short is resumed by the next call, not dropped */
+  UAVTalkProcessInputStream(conn, stream.data(), stream.size() - 3);
+  UAVTalkProcessInputStream(conn, stream.data() + stream.size() - 3, 3);
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(conn, &stats);
+
+  EXPECT_EQ(stream_objects, stats.rxObjects);
+
+  check_objects();
+};
+
+TEST_F(UAVTalkRx, RelayForwardsFrames) {
+  std::vector<uint8_t> relayed;
+  UAVTalkConnection in = UAVTalkInitialize(NULL, NULL, NULL, NULL, NULL, NULL);
+  UAVTalkConnection out = UAVTalkInitialize(&relayed, record_output,
+      NULL, NULL, NULL, NULL);
+  ASSERT_TRUE(in != NULL);
+  ASSERT_TRUE(out != NULL);
+
+  int frames = 0;
+
+  for (size_t i = 0; i < stream.size(); i++) {
+    if (UAVTalkProcessInputStreamQuiet(in, stream[i]) ==
+        UAVTALK_STATE_COMPLETE) {
+      EXPECT_EQ(0, UAVTalkRelayPacket(in, out));
+      frames++;
+    }
+  }
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(out, &stats);
+
+  EXPECT_EQ((uint32_t) frames, stats.relayedObjects);
+  EXPECT_EQ(relayed.size(), stats.relayedBytes);
+  EXPECT_EQ(relayed.size(), stats.txBytes);
+
+  /* Only the noise and the corrupt frame are left behind */
+  struct receiver rx = { 0, 0, 0 };
+  UAVTalkConnection check = UAVTalkInitialize(&rx, count_output, count_ack,
+      NULL, NULL, NULL);
+  ASSERT_TRUE(check != NULL);
+
+  decode_bytewise(check, relayed.data(), relayed.size());
+  UAVTalkGetStats(check, &stats);
+
+  EXPECT_EQ(stream_objects, stats.rxObjects);
+  EXPECT_EQ(0u, stats.rxCRC);
+  EXPECT_EQ(0u, stats.rxErrors);
+  EXPECT_EQ(stream_nacks, rx.acks);
+
+  check_objects();
+};
+
+TEST_F(UAVTalkRx, RelayRefusesInPlaceFrames) {
+  std::vector<uint8_t> relayed;
+  UAVTalkConnection in = UAVTalkInitialize(NULL, NULL, NULL, NULL, NULL, NULL);
+  UAVTalkConnection out = UAVTalkInitialize(&relayed, record_output,
+      NULL, NULL, NULL, NULL);
+  ASSERT_TRUE(in != NULL);
+  ASSERT_TRUE(out != NULL);
+
+  /* The last frame is parsed in place, so it is not in the rx buffer */
+  UAVTalkProcessInputStream(in, stream.data(), stream.size());
+
+  EXPECT_EQ(-1, UAVTalkRelayPacket(in, out));
+  EXPECT_TRUE(relayed.empty());
+};
+
+TEST_F(UAVTalkRx, DumpRequest) {
+  std::vector<uint8_t> frame;
+  UAVTalkConnection tx = UAVTalkInitialize(&frame, record_output,
+      NULL, NULL, NULL, NULL);
+  ASSERT_TRUE(tx != NULL);
+
+  /* A pending batch goes out ahead of the completion marker */
+  EXPECT_EQ(0, UAVTalkSendObjectBatched(tx, single_handle, 0));
+  EXPECT_EQ(0, UAVTalkSendDumpComplete(tx, 42));
+  EXPECT_FALSE(UAVTalkBatchPending(tx));
+
+  std::vector<uint32_t> reqs;
+  UAVTalkConnection rx = UAVTalkInitialize(&reqs, NULL, NULL, NULL,
+      record_req, NULL);
+  ASSERT_TRUE(rx != NULL);
+
+  decode_bytewise(rx, frame.data(), frame.size());
+
+  /* The marker is header only: 8 bytes and a CRC, count in the ID */
+  ASSERT_GE(frame.size(), 9u);
+  const uint8_t *marker = frame.data() + frame.size() - 9;
+  EXPECT_EQ(0x3c, marker[0]);	/* Sync byte */
+  EXPECT_EQ(42u, marker[4] | (marker[5] << 8) | (marker[6] << 16) |
+      ((uint32_t) marker[7] << 24));
+
+  ASSERT_EQ(1u, reqs.size());
+  EXPECT_EQ((uint32_t) UAVTALK_OBJID_DUMP_ALL, reqs[0]);
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(rx, &stats);
+  EXPECT_EQ(0u, stats.rxErrors);
+};
+
+TEST_F(UAVTalkRx, ChecksumFrame) {
+  std::vector<uint8_t> frame;
+  UAVTalkConnection tx = UAVTalkInitialize(&frame, record_output,
+      NULL, NULL, NULL, NULL);
+  ASSERT_TRUE(tx != NULL);
+
+  ASSERT_EQ(0, UAVObjSetData(single_handle, single_data));
+
+  for (uint16_t i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+    ASSERT_EQ(0, UAVObjSetInstanceData(multi_handle, i, multi_data[i]));
+  }
+
+  /* Checksums accumulate until flushed, and don't mix with objects */
+  EXPECT_EQ(0, UAVTalkSendChecksum(tx, single_handle));
+  EXPECT_EQ(0, UAVTalkSendChecksum(tx, multi_handle));
+  EXPECT_TRUE(UAVTalkBatchPending(tx));
+  EXPECT_EQ(0u, frame.size());
+  EXPECT_EQ(0, UAVTalkFlushBatch(tx));
+
+  ASSERT_EQ(8u + 2 * 8u + 1u, frame.size());
+  EXPECT_EQ(0x27, frame[1]);	/* OBJ_CRC */
+  EXPECT_EQ(2, frame[4]);		/* Record count */
+
+  uint32_t single_crc = PIOS_CRC32_updateCRC(0, single_data,
+      SINGLE_OBJ_SIZE);
+  uint32_t multi_crc = 0;
+
+  for (int i = 0; i < MULTI_OBJ_INSTANCES; i++) {
+    multi_crc = PIOS_CRC32_updateCRC(multi_crc, multi_data[i],
+        MULTI_OBJ_SIZE);
+  }
+
+  uint32_t rec[4];
+  memcpy(rec, frame.data() + 8, sizeof(rec));
+
+  EXPECT_EQ((uint32_t) SINGLE_OBJ_ID, rec[0]);
+  EXPECT_EQ(single_crc, rec[1]);
+  EXPECT_EQ((uint32_t) MULTI_OBJ_ID, rec[2]);
+  EXPECT_EQ(multi_crc, rec[3]);
+};
+
+TEST_F(UAVTalkRx, DecodeBenchmark) {
+  int passes = BENCH_BYTES / stream.size() + 1;
+  double bytes = (double) passes * stream.size();
+
+  UAVTalkConnection conn = UAVTalkInitialize(NULL, NULL, NULL, NULL, NULL, NULL);
+  ASSERT_TRUE(conn != NULL);
+
+  uint64_t start = now_ns();
+
+  for (int i = 0; i < passes; i++) {
+    decode_bytewise(conn, stream.data(), stream.size());
+  }
+
+  uint64_t bytewise = now_ns() - start;
+
+  start = now_ns();
+
+  for (int i = 0; i < passes; i++) {
+    UAVTalkProcessInputStream(conn, stream.data(), stream.size());
+  }
+
+  uint64_t bulk = now_ns() - start;
+
+  UAVTalkStats stats;
+  UAVTalkGetStats(conn, &stats);
+
+  EXPECT_EQ(2u * passes * stream_objects, stats.rxObjects);
+
+  printf("%zu byte stream: bytewise %.1f MB/s, bulk %.1f MB/s\n",
+      stream.size(), bytes * 1000 / bytewise, bytes * 1000 / bulk);
+};
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * @file       unittest_mocks.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Mocks of the PiOS services used by UAVTalk and the object manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios.h"
+#include "pios_thread.h"
+#include <time.h>
+
+uintptr_t pios_uavo_settings_fs_id;
+
+/* No settings storage; every load misses */
+int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	return 0;
+}
+
+int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id,
+		uint16_t obj_inst_id)
+{
+	return 0;
+}
+
+uint32_t PIOS_Thread_Systime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+bool PIOS_Thread_Period_Elapsed(const uint32_t prev_systime,
+		const uint32_t increment_ms)
+{
+	return increment_ms <= (PIOS_Thread_Systime() - prev_systime);
+}
+
+bool PIOS_Thread_FakeClock_IsActive(void)
+{
+	return false;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -51,11 +51,12 @@ KmlExport::KmlExport(QString inputLogFileName, QString outputKmlFileName)
     logFile.setFileName(inputLogFileName);
 
     // Create new UAVObject manager and initialize it with all UAVObjects
-    UAVObjectManager *kmlUAVObjectManager = new UAVObjectManager;
+    kmlUAVObjectManager = new UAVObjectManager;
     UAVObjectsInitialize(kmlUAVObjectManager);
 
-    // Connect new UAVO manager to a UAVTalk instance
-    kmlTalk = new UAVTalk(&logFile, kmlUAVObjectManager, false);
+    // Decode the log's frames in this thread, keeping every update
+    kmlDecoder = new UAVTalkDecoder(kmlUAVObjectManager);
+    kmlDecoder->setCoalescing(false);
 
     // Get the UAVObjects
     airspeedActual = AirspeedActual::GetInstance(kmlUAVObjectManager);
@@ -366,6 +367,7 @@ void KmlExport::parseLogFile()
 {
     qint64 packetSize;
     quint32 timeStampIdx;
+    QVector<UAVTalkDecoder::Frame> frames;
 
     // Read packets
     while (!logFile.atEnd()) {
@@ -394,12 +396,21 @@ void KmlExport::parseLogFile()
         QByteArray dataBuffer;
         dataBuffer.append(logFile.read(packetSize));
 
-        // Parse the packet. This operation passes the data to the kmlTalk object, which internally
-        // parses the data
-        // and then emits objectUpdated(UAVObject *) signals. These signals are connected to in the
-        // KmlExport constructor.
-        for (int i = 0; i < dataBuffer.size(); i++) {
-            kmlTalk->processInputByte(dataBuffer[i]);
+        // Decode the packet and unpack its updates into the objects, which emits the
+        // objectUpdated(UAVObject *) signals connected to in the KmlExport constructor.
+        kmlDecoder->decode(dataBuffer.constData(), dataBuffer.size(), timeStamp);
+        kmlDecoder->takeFrames(frames);
+
+        for (const UAVTalkDecoder::Frame &frame : frames) {
+            if (!frame.isObjectUpdate()) {
+                continue;
+            }
+
+            UAVObject *obj = kmlUAVObjectManager->getObject(frame.objId, frame.instId);
+
+            if (obj) {
+                obj->unpack(reinterpret_cast<const quint8 *>(frame.data.constData()));
+            }
         }
 
         timeStampIdx++;
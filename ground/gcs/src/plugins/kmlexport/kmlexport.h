@@ -38,6 +38,7 @@
 #include "kml/engine.h"
 
 #include "./uavtalk/uavtalk.h"
+#include "./uavtalk/uavtalkdecoder.h"
 
 #include "airspeedactual.h"
 #include "attitudeactual.h"
@@ -92,7 +93,8 @@ private:
     QList<quint32> timestampBuffer;
     QList<quint32> timestampPos;
 
-    UAVTalk *kmlTalk;
+    UAVObjectManager *kmlUAVObjectManager;
+    UAVTalkDecoder *kmlDecoder;
 
     AirspeedActual *airspeedActual;
     AttitudeActual *attitudeActual;
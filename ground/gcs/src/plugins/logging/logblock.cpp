@@ -0,0 +1,440 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logblock.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Compressed blocks of records, for compressed log files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "logblock.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <algorithm>
+#include <zlib.h>
+
+const char LogBlock::HEADER_TAG[] = "compression: zlib";
+
+// The index of a long log can outgrow a data block
+static const quint32 MAX_INDEX_SIZE = 1 << 28;
+
+// How much to search at a time for the next block past a corrupt one
+static const qint64 RESYNC_WINDOW = 65536;
+
+static void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+
+    out.append(static_cast<char>(value));
+}
+
+/**
+ * Read a varint, advancing data past it.
+ * \return false if it runs past end
+ */
+static bool readVarint(const char *&data, const char *end, quint64 &value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64 && data < end; shift += 7) {
+        quint8 byte = *data++;
+
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Find the next place at or after pos that starts with magic.
+ * \return its position, or end if there is none
+ */
+static qint64 findMagic(QFile &in, qint64 pos, qint64 end, quint32 magic)
+{
+    uchar magicBytes[sizeof(magic)];
+
+    qToLittleEndian(magic, magicBytes);
+
+    QByteArray wanted(reinterpret_cast<const char *>(magicBytes), sizeof(magicBytes));
+
+    while (pos + static_cast<qint64>(sizeof(magic)) <= end) {
+        in.seek(pos);
+
+        QByteArray window = in.read(qMin(RESYNC_WINDOW, end - pos));
+        int found = window.indexOf(wanted);
+
+        if (found >= 0) {
+            return pos + found;
+        }
+
+        if (window.size() < wanted.size()) {
+            break;
+        }
+
+        // The magic may straddle the end of the window
+        pos += window.size() - wanted.size() + 1;
+    }
+
+    return end;
+}
+
+LogBlock::LogBlock()
+    : filePos(0)
+    , fileNext(0)
+    , firstTime(0)
+    , lastTime(0)
+{
+}
+
+void LogBlock::clear()
+{
+    raw.clear();
+    recordList.clear();
+    filePos = 0;
+    fileNext = 0;
+    firstTime = 0;
+    lastTime = 0;
+}
+
+/**
+ * Find a record read from the block.
+ * \return the first record at or after offset, or nullptr if there is none
+ */
+const LogBlock::Record *LogBlock::find(int offset) const
+{
+    auto it = std::lower_bound(recordList.constBegin(), recordList.constEnd(), offset,
+                               [](const Record &r, int o) { return r.offset < o; });
+
+    return it == recordList.constEnd() ? nullptr : it;
+}
+
+/**
+ * Add a record to the block being written.
+ * \return the offset of the record in the block
+ */
+int LogBlock::append(quint64 timestamp, const char *data, int size)
+{
+    if (raw.isEmpty()) {
+        firstTime = timestamp;
+        lastTime = timestamp;
+    }
+
+    int offset = raw.size();
+    qint64 delta = static_cast<qint64>(timestamp - lastTime);
+
+    appendVarint(raw, (static_cast<quint64>(delta) << 1) ^ static_cast<quint64>(delta >> 63));
+    appendVarint(raw, size);
+    raw.append(data, size);
+
+    lastTime = timestamp;
+
+    return offset;
+}
+
+/**
+ * Compress data into a block.
+ * \return the block, or an empty array if it could not be compressed
+ */
+QByteArray LogBlock::compress(quint32 magic, const QByteArray &data, quint64 firstTimestamp)
+{
+    uLongf size = compressBound(data.size());
+    QByteArray frame(HEADER_SIZE + size, Qt::Uninitialized);
+    uchar *header = reinterpret_cast<uchar *>(frame.data());
+
+    if (compress2(header + HEADER_SIZE, &size, reinterpret_cast<const Bytef *>(data.constData()),
+                  data.size(), Z_DEFAULT_COMPRESSION)
+        != Z_OK) {
+        return QByteArray();
+    }
+
+    qToLittleEndian<quint32>(magic, header);
+    qToLittleEndian<quint32>(data.size(), header + 4);
+    qToLittleEndian<quint32>(size, header + 8);
+    qToLittleEndian<quint64>(firstTimestamp, header + 12);
+
+    frame.resize(HEADER_SIZE + size);
+
+    return frame;
+}
+
+/**
+ * Check the HEADER_SIZE bytes at header for the start of a block.
+ * \return the size of the whole block, or -1 if it is not one
+ */
+qint64 LogBlock::frameSize(const char *header, quint32 magic)
+{
+    const uchar *h = reinterpret_cast<const uchar *>(header);
+    quint32 rawSize = qFromLittleEndian<quint32>(h + 4);
+    quint32 compressedSize = qFromLittleEndian<quint32>(h + 8);
+
+    if (qFromLittleEndian<quint32>(h) != magic
+        || rawSize > (magic == DATA_MAGIC ? static_cast<quint32>(MAX_SIZE) : MAX_INDEX_SIZE)
+        || compressedSize > compressBound(rawSize)) {
+        return -1;
+    }
+
+    return HEADER_SIZE + compressedSize;
+}
+
+/**
+ * Decompress a block.
+ * \param[in] frame The block, header included
+ * \param[in] size Bytes available at frame
+ * \param[in] pos Where the block is in the log
+ * \param[in] magic What kind of block is expected
+ * \return true on success, otherwise the block is left empty
+ */
+bool LogBlock::unpack(const char *frame, qint64 size, qint64 pos, quint32 magic)
+{
+    qint64 frameBytes = size >= HEADER_SIZE ? frameSize(frame, magic) : -1;
+
+    clear();
+
+    if (frameBytes < 0 || frameBytes > size) {
+        return false;
+    }
+
+    const uchar *header = reinterpret_cast<const uchar *>(frame);
+    uLongf rawSize = qFromLittleEndian<quint32>(header + 4);
+
+    raw = QByteArray(rawSize, Qt::Uninitialized);
+
+    if (uncompress(reinterpret_cast<Bytef *>(raw.data()), &rawSize, header + HEADER_SIZE,
+                   frameBytes - HEADER_SIZE)
+            != Z_OK
+        || rawSize != static_cast<uLongf>(raw.size())) {
+        clear();
+        return false;
+    }
+
+    filePos = pos;
+    fileNext = pos + frameBytes;
+    firstTime = qFromLittleEndian<quint64>(header + 12);
+
+    if (magic == DATA_MAGIC && !parse()) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Read and decompress the block at pos.  If it is a corrupt data block,
+ * skip forward to the next good one.
+ * \param[in] end Where the blocks of the log end
+ * \return true on success, otherwise the block is left empty
+ */
+bool LogBlock::read(QFile &in, qint64 pos, qint64 end, quint32 magic)
+{
+    while (pos + HEADER_SIZE <= end) {
+        in.seek(pos);
+
+        QByteArray frame = in.read(HEADER_SIZE);
+        qint64 frameBytes = frame.size() == HEADER_SIZE ? frameSize(frame.constData(), magic) : -1;
+
+        if (frameBytes > 0 && pos + frameBytes <= end) {
+            frame.append(in.read(frameBytes - HEADER_SIZE));
+
+            if (unpack(frame.constData(), frame.size(), pos, magic)) {
+                return true;
+            }
+        }
+
+        if (magic != DATA_MAGIC) {
+            break;
+        }
+
+        qDebug() << "Corrupt log block at file location 0x" << QString("%1").arg(pos, 0, 16);
+
+        pos = findMagic(in, pos + 1, end, magic);
+    }
+
+    clear();
+
+    return false;
+}
+
+/**
+ * Split the uncompressed contents of a data block into records.
+ */
+bool LogBlock::parse()
+{
+    const char *begin = raw.constData();
+    const char *end = begin + raw.size();
+    const char *data = begin;
+    quint64 timestamp = firstTime;
+
+    while (data < end) {
+        Record record;
+        quint64 delta, size;
+
+        record.offset = data - begin;
+
+        if (!readVarint(data, end, delta) || !readVarint(data, end, size)
+            || size > static_cast<quint64>(end - data)) {
+            return false;
+        }
+
+        // Undo the zigzag encoding
+        timestamp += (delta >> 1) ^ (~(delta & 1) + 1);
+
+        record.timestamp = timestamp;
+        record.dataOffset = data - begin;
+        record.size = size;
+
+        recordList.append(record);
+
+        data += size;
+    }
+
+    lastTime = timestamp;
+
+    return true;
+}
+
+LogBlockReader::LogBlockReader(const QString &fileName, qint64 dataEnd)
+    : fileName(fileName)
+    , dataEnd(dataEnd)
+    , runStart(-1)
+    , nextPos(-1)
+    , generation(0)
+    , atEnd(true)
+    , running(true)
+{
+}
+
+LogBlockReader::~LogBlockReader()
+{
+    stop();
+    wait();
+}
+
+void LogBlockReader::stop()
+{
+    QMutexLocker lock(&mutex);
+
+    running = false;
+    changed.wakeAll();
+}
+
+/**
+ * Get the block at blockPos, or the next good one after it if it is
+ * corrupt, waiting for it to be decompressed if need be.  Reading ahead
+ * continues from there.
+ * \return false if the log ends first
+ */
+bool LogBlockReader::take(qint64 blockPos, LogBlock &block)
+{
+    QMutexLocker lock(&mutex);
+
+    // Start over from blockPos, unless it is what is being read ahead
+    if (blockPos < runStart || blockPos > nextPos) {
+        ready.clear();
+        runStart = blockPos;
+        nextPos = blockPos;
+        atEnd = false;
+        generation++;
+        changed.wakeAll();
+    }
+
+    forever {
+        while (!ready.isEmpty() && ready.head().pos() < blockPos) {
+            runStart = ready.dequeue().nextPos();
+        }
+
+        if (!ready.isEmpty()) {
+            block = ready.dequeue();
+            runStart = block.nextPos();
+            changed.wakeAll();
+
+            return true;
+        }
+
+        if (atEnd || !running) {
+            return false;
+        }
+
+        changed.wait(&mutex);
+    }
+}
+
+void LogBlockReader::run()
+{
+    QFile in(fileName);
+
+    if (!in.open(QIODevice::ReadOnly)) {
+        qWarning() << "Unable to open" << fileName << "to replay it";
+        stop();
+        return;
+    }
+
+    forever {
+        qint64 pos;
+        quint32 readGeneration;
+
+        {
+            QMutexLocker lock(&mutex);
+
+            while (running && (atEnd || ready.size() >= READ_AHEAD)) {
+                changed.wait(&mutex);
+            }
+
+            if (!running) {
+                return;
+            }
+
+            pos = nextPos;
+            readGeneration = generation;
+        }
+
+        LogBlock block;
+        bool ok = block.read(in, pos, dataEnd);
+
+        QMutexLocker lock(&mutex);
+
+        // Throw it away if take() started over meanwhile
+        if (readGeneration != generation) {
+            continue;
+        }
+
+        if (ok) {
+            ready.enqueue(block);
+            nextPos = block.nextPos();
+        } else {
+            atEnd = true;
+        }
+
+        changed.wakeAll();
+    }
+}
+
+/**
+ * @}
+ * @}
+ */
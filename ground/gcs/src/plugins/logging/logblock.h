@@ -0,0 +1,169 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logblock.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Compressed blocks of records, for compressed log files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LOGBLOCK_H
+#define LOGBLOCK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * A block of a compressed log (.drlogz).  After the usual text header, with
+ * an extra HEADER_TAG line, such a log is a series of blocks that are each
+ * compressed on their own, so that replay can start from any of them:
+ *
+ *   magic(u32) rawSize(u32) compressedSize(u32) firstTimestamp(u64)
+ *   zlib stream of rawSize bytes
+ *
+ * all little-endian.  Uncompressed, a data block holds records of
+ *
+ *   varint(timestamp delta) varint(size) payload
+ *
+ * Timestamps are in microseconds.  The delta is zigzag encoded and taken
+ * from the previous record, or from firstTimestamp for the first record of
+ * the block.
+ *
+ * Records are located by a position combining the file offset of their
+ * block and their offset within it, see position().
+ */
+class LogBlock
+{
+public:
+    struct Record
+    {
+        quint64 timestamp; // us
+        int offset;
+        int dataOffset;
+        int size;
+    };
+
+    static const quint32 DATA_MAGIC = 0x425a5244; // "DRZB"
+    static const quint32 INDEX_MAGIC = 0x495a5244; // "DRZI"
+    static const int HEADER_SIZE = 20;
+    static const int MAX_RECORD_HEADER = 15; // 64 and 32 bit varints
+
+    // Blocks are closed once this big, or after BLOCK_INTERVAL of log time
+    static const int TARGET_SIZE = 65536;
+    static const quint64 BLOCK_INTERVAL = 5000000; // us
+
+    static const int POS_SHIFT = 24;
+    static const int MAX_SIZE = 1 << POS_SHIFT;
+
+    static const char HEADER_TAG[];
+
+    static qint64 position(qint64 blockPos, int offset)
+    {
+        return (blockPos << POS_SHIFT) | offset;
+    }
+    static qint64 blockPos(qint64 position) { return position >> POS_SHIFT; }
+    static int offset(qint64 position) { return position & (MAX_SIZE - 1); }
+
+    LogBlock();
+
+    void clear();
+    bool isEmpty() const { return raw.isEmpty(); }
+    int size() const { return raw.size(); }
+
+    qint64 pos() const { return filePos; }
+    qint64 nextPos() const { return fileNext; }
+
+    quint64 firstTimestamp() const { return firstTime; }
+    const QVector<Record> &records() const { return recordList; }
+    const Record *find(int offset) const;
+    const char *recordData(const Record &record) const
+    {
+        return raw.constData() + record.dataOffset;
+    }
+
+    // The uncompressed contents
+    const QByteArray &data() const { return raw; }
+
+    // Writing
+    int append(quint64 timestamp, const char *data, int size);
+    QByteArray pack() const { return compress(DATA_MAGIC, raw, firstTime); }
+    static QByteArray compress(quint32 magic, const QByteArray &data,
+                               quint64 firstTimestamp = 0);
+
+    // Reading
+    static qint64 frameSize(const char *header, quint32 magic = DATA_MAGIC);
+    bool unpack(const char *frame, qint64 size, qint64 pos, quint32 magic = DATA_MAGIC);
+    bool read(QFile &in, qint64 pos, qint64 end, quint32 magic = DATA_MAGIC);
+
+private:
+    QByteArray raw;
+    QVector<Record> recordList;
+    qint64 filePos;
+    qint64 fileNext;
+    quint64 firstTime;
+    quint64 lastTime;
+
+    bool parse();
+};
+
+/**
+ * Reads and decompresses the blocks of a log ahead of replay, on its own
+ * thread and with its own handle on the file.
+ */
+class LogBlockReader : public QThread
+{
+    Q_OBJECT
+public:
+    LogBlockReader(const QString &fileName, qint64 dataEnd);
+    ~LogBlockReader();
+
+    bool take(qint64 blockPos, LogBlock &block);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    static const int READ_AHEAD = 4;
+
+    QString fileName;
+    qint64 dataEnd;
+
+    QMutex mutex;
+    QWaitCondition changed;
+    QQueue<LogBlock> ready;
+    qint64 runStart;
+    qint64 nextPos;
+    quint32 generation;
+    bool atEnd;
+    bool running;
+};
+
+#endif // LOGBLOCK_H
+
+/**
+ * @}
+ * @}
+ */
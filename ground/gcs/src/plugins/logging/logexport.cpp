@@ -0,0 +1,598 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logexport.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Decodes a log file into one table per object
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "logexport.h"
+#include "logindex.h"
+#include "logblock.h"
+#include "uavobjects/uavdataobject.h"
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+
+static const char COLUMNS_MAGIC[4] = { 'D', 'R', 'C', 'L' };
+static const quint32 COLUMNS_VERSION = 2;
+
+/**
+ * Work for the thread pool.
+ */
+class LogExportJob : public QRunnable
+{
+public:
+    LogExportJob(std::function<void()> work)
+        : work(work)
+    {
+    }
+
+    void run() { work(); }
+
+private:
+    std::function<void()> work;
+};
+
+template <typename T>
+static void appendValue(QByteArray &out, T value)
+{
+    uchar bytes[sizeof(T)];
+
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char *>(bytes), sizeof(T));
+}
+
+static void appendColumn(QByteArray &out, const QString &name, quint8 type, int size)
+{
+    QByteArray utf8 = name.toUtf8();
+
+    appendValue(out, static_cast<quint16>(utf8.size()));
+    out.append(utf8);
+    appendValue(out, type);
+    appendValue(out, static_cast<quint8>(size));
+}
+
+/**
+ * Bytes per element in the binary table.  Bitfields get a byte per bit.
+ */
+static int columnSize(UAVObjectField *field)
+{
+    switch (field->getType()) {
+    case UAVObjectField::INT16:
+    case UAVObjectField::UINT16:
+        return 2;
+    case UAVObjectField::INT32:
+    case UAVObjectField::UINT32:
+    case UAVObjectField::FLOAT32:
+        return 4;
+    case UAVObjectField::STRING:
+        return field->getNumElements();
+    default:
+        return 1;
+    }
+}
+
+static QByteArray csvText(const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+
+    if (utf8.contains(',') || utf8.contains('"') || utf8.contains('\n')) {
+        return '"' + utf8.replace("\"", "\"\"") + '"';
+    }
+
+    return utf8;
+}
+
+/**
+ * Writes the table of one object type.  Each writer decodes updates into
+ * its own copy of the object, so that writers can run in parallel.
+ */
+class LogExport::ObjectWriter
+{
+public:
+    ObjectWriter(UAVDataObject *prototype)
+        : obj(prototype->dirtyClone())
+        , fields(obj->getFields())
+        , columnCount(0)
+    {
+    }
+
+    ~ObjectWriter() { delete obj; }
+
+    bool open(const QString &outputDir, int formats, QString &error);
+    void write();
+
+    /** Updates to write next, in log order */
+    QVector<UAVTalkDecoder::Frame> pending;
+
+private:
+    UAVDataObject *obj;
+    QList<UAVObjectField *> fields;
+    QFile csv;
+    QFile columns;
+    int columnCount;
+
+    void unpack(const UAVTalkDecoder::Frame &frame);
+    void appendRow(QByteArray &text, const UAVTalkDecoder::Frame &frame);
+    void appendColumns(QVector<QByteArray> &values, const UAVTalkDecoder::Frame &frame);
+};
+
+bool LogExport::ObjectWriter::open(const QString &outputDir, int formats, QString &error)
+{
+    QString base = QDir(outputDir).filePath(obj->getName());
+
+    if (formats & CSV) {
+        csv.setFileName(base + ".csv");
+
+        if (!csv.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = QString("Unable to write %1: %2").arg(csv.fileName()).arg(csv.errorString());
+            return false;
+        }
+
+        QByteArray header("timestamp,instance");
+
+        for (UAVObjectField *field : fields) {
+            if (field->getType() == UAVObjectField::STRING || field->getNumElements() == 1) {
+                header += ',' + csvText(field->getName());
+                continue;
+            }
+
+            for (int i = 0; i < field->getNumElements(); i++) {
+                header += ',' + csvText(field->getName() + '[' + field->getElementName(i) + ']');
+            }
+        }
+
+        csv.write(header + '\n');
+    }
+
+    if (formats & COLUMNS) {
+        columns.setFileName(base + ".drcol");
+
+        if (!columns.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = QString("Unable to write %1: %2")
+                        .arg(columns.fileName())
+                        .arg(columns.errorString());
+            return false;
+        }
+
+        QByteArray names;
+
+        appendColumn(names, "timestamp", TIMESTAMP_TYPE, sizeof(quint64));
+        appendColumn(names, "instance", UAVObjectField::UINT16, sizeof(quint16));
+        columnCount = 2;
+
+        for (UAVObjectField *field : fields) {
+            if (field->getType() == UAVObjectField::STRING) {
+                appendColumn(names, field->getName(), field->getType(), columnSize(field));
+                columnCount++;
+                continue;
+            }
+
+            for (int i = 0; i < field->getNumElements(); i++) {
+                QString name = field->getName();
+
+                if (field->getNumElements() > 1) {
+                    name += '[' + field->getElementName(i) + ']';
+                }
+
+                appendColumn(names, name, field->getType(), columnSize(field));
+                columnCount++;
+            }
+        }
+
+        QByteArray header(COLUMNS_MAGIC, sizeof(COLUMNS_MAGIC));
+
+        appendValue(header, COLUMNS_VERSION);
+        appendValue(header, obj->getObjID());
+        appendValue(header, static_cast<quint32>(columnCount));
+
+        columns.write(header + names);
+    }
+
+    return true;
+}
+
+/**
+ * Write the pending updates to the tables and clear them.
+ */
+void LogExport::ObjectWriter::write()
+{
+    QByteArray text;
+    QVector<QByteArray> values(columnCount);
+
+    for (const UAVTalkDecoder::Frame &frame : pending) {
+        unpack(frame);
+
+        if (csv.isOpen()) {
+            appendRow(text, frame);
+        }
+
+        if (columns.isOpen()) {
+            appendColumns(values, frame);
+        }
+    }
+
+    if (csv.isOpen()) {
+        csv.write(text);
+    }
+
+    if (columns.isOpen()) {
+        QByteArray block;
+
+        appendValue(block, static_cast<quint32>(pending.size()));
+
+        for (const QByteArray &column : values) {
+            block += column;
+        }
+
+        columns.write(block);
+    }
+
+    pending.clear();
+}
+
+/**
+ * Decode an update into the fields.  UAVObject::unpack() would signal
+ * objectUnpacked, which queues an event to the GUI thread that owns the
+ * clone for every row, so the fields are unpacked directly instead.
+ */
+void LogExport::ObjectWriter::unpack(const UAVTalkDecoder::Frame &frame)
+{
+    const quint8 *data = reinterpret_cast<const quint8 *>(frame.data.constData());
+
+    for (UAVObjectField *field : fields) {
+        data += field->unpack(data);
+    }
+}
+
+void LogExport::ObjectWriter::appendRow(QByteArray &text, const UAVTalkDecoder::Frame &frame)
+{
+    text += QByteArray::number(frame.received);
+    text += ',';
+    text += QByteArray::number(frame.instId);
+
+    for (UAVObjectField *field : fields) {
+        int elements = field->getNumElements();
+
+        switch (field->getType()) {
+        case UAVObjectField::STRING:
+            text += ',' + csvText(field->getValue().toString());
+            break;
+        case UAVObjectField::ENUM:
+            for (int i = 0; i < elements; i++) {
+                text += ',' + csvText(field->getValue(i).toString());
+            }
+            break;
+        case UAVObjectField::FLOAT32:
+            for (int i = 0; i < elements; i++) {
+                text += ',' + QByteArray::number(field->get<float>(i), 'g', 7);
+            }
+            break;
+        case UAVObjectField::UINT32:
+            for (int i = 0; i < elements; i++) {
+                text += ',' + QByteArray::number(field->get<quint32>(i));
+            }
+            break;
+        default:
+            for (int i = 0; i < elements; i++) {
+                text += ',' + QByteArray::number(field->get<qint32>(i));
+            }
+        }
+    }
+
+    text += '\n';
+}
+
+void LogExport::ObjectWriter::appendColumns(QVector<QByteArray> &values,
+                                            const UAVTalkDecoder::Frame &frame)
+{
+    int column = 0;
+
+    appendValue(values[column++], static_cast<quint64>(frame.received));
+    appendValue(values[column++], frame.instId);
+
+    for (UAVObjectField *field : fields) {
+        int elements = field->getNumElements();
+
+        switch (field->getType()) {
+        case UAVObjectField::STRING: {
+            QByteArray text = field->getValue().toString().toLatin1();
+            text.resize(elements);
+            values[column++] += text;
+            break;
+        }
+        case UAVObjectField::INT16:
+            for (int i = 0; i < elements; i++) {
+                appendValue(values[column++], field->get<qint16>(i));
+            }
+            break;
+        case UAVObjectField::UINT16:
+            for (int i = 0; i < elements; i++) {
+                appendValue(values[column++], field->get<quint16>(i));
+            }
+            break;
+        case UAVObjectField::INT32:
+            for (int i = 0; i < elements; i++) {
+                appendValue(values[column++], field->get<qint32>(i));
+            }
+            break;
+        case UAVObjectField::UINT32:
+            for (int i = 0; i < elements; i++) {
+                appendValue(values[column++], field->get<quint32>(i));
+            }
+            break;
+        case UAVObjectField::FLOAT32:
+            for (int i = 0; i < elements; i++) {
+                float value = field->get<float>(i);
+                quint32 bits;
+
+                memcpy(&bits, &value, sizeof(bits));
+                appendValue(values[column++], bits);
+            }
+            break;
+        case UAVObjectField::INT8:
+            for (int i = 0; i < elements; i++) {
+                values[column++] += static_cast<char>(field->get<qint8>(i));
+            }
+            break;
+        default:
+            // Unsigned bytes, enums as their raw value, and bitfields
+            for (int i = 0; i < elements; i++) {
+                values[column++] += static_cast<char>(field->get<quint8>(i));
+            }
+        }
+    }
+}
+
+LogExport::LogExport(UAVObjectManager *objMngr)
+    : objMngr(objMngr)
+    , updates(0)
+{
+    for (int i = 0; i < pool.maxThreadCount(); i++) {
+        UAVTalkDecoder *decoder = new UAVTalkDecoder(objMngr);
+
+        // Every update must be exported, not just the latest
+        decoder->setCoalescing(false);
+        decoders.append(decoder);
+    }
+}
+
+LogExport::~LogExport()
+{
+    clear();
+    qDeleteAll(decoders);
+}
+
+void LogExport::clear()
+{
+    pool.waitForDone();
+    qDeleteAll(writers);
+    writers.clear();
+}
+
+/**
+ * Export every object update in a log.
+ * \param[in] logName The log to read
+ * \param[in] outputDir Where to write the tables, replacing any there
+ * \param[in] formats Which tables to write, see Format
+ * \return true on success, otherwise see errorString()
+ */
+bool LogExport::exportLog(const QString &logName, const QString &outputDir, int formats)
+{
+    clear();
+    error.clear();
+    updates = 0;
+
+    QFile file(logName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("Unable to open %1: %2").arg(logName).arg(file.errorString());
+        return false;
+    }
+
+    if (!QDir().mkpath(outputDir)) {
+        error = QString("Unable to create %1").arg(outputDir);
+        return false;
+    }
+
+    // Skip the header that LogFile writes, if there is one
+    qint64 dataStart = 0;
+    bool compressed = false;
+
+    for (int line = 0; line < 16 && !file.atEnd(); line++) {
+        QByteArray text = file.readLine().trimmed();
+
+        if (text == "##") {
+            dataStart = file.pos();
+            break;
+        }
+
+        compressed |= text == LogBlock::HEADER_TAG;
+    }
+
+    qint64 dataEnd = file.size();
+    uchar *mapped = file.map(0, dataEnd);
+
+    if (!mapped) {
+        error = QString("Unable to map %1: %2").arg(logName).arg(file.errorString());
+        return false;
+    }
+
+    const char *log = reinterpret_cast<const char *>(mapped);
+
+    if (dataEnd - dataStart >= LogIndex::TRAILER_SIZE) {
+        qint64 indexPos = LogIndex::trailerOffset(log + dataEnd - LogIndex::TRAILER_SIZE);
+
+        if (indexPos >= dataStart && indexPos < dataEnd) {
+            dataEnd = indexPos;
+        }
+    }
+
+    QVector<Record> records;
+    qint64 pos = dataStart;
+    bool ok = true;
+
+    records.reserve(BATCH_RECORDS);
+
+    // Records point into the blocks they came from until they are exported
+    QVector<LogBlock> blocks;
+    LogBlock block;
+
+    while (compressed && ok && pos + LogBlock::HEADER_SIZE <= dataEnd) {
+        // Skip forward a byte at a time past a corrupt block
+        if (!block.unpack(log + pos, dataEnd - pos, pos)) {
+            pos++;
+            continue;
+        }
+
+        for (const LogBlock::Record &r : block.records()) {
+            Record record = { r.timestamp, block.recordData(r), r.size };
+            records.append(record);
+        }
+
+        blocks.append(block);
+        pos = block.nextPos();
+
+        if (records.size() >= BATCH_RECORDS) {
+            ok = exportBatch(records, outputDir, formats);
+            records.clear();
+            blocks.clear();
+        }
+    }
+
+    while (!compressed && ok && pos + RECORD_HEADER_SIZE <= dataEnd) {
+        quint32 timestamp; // ms
+        qint64 dataSize;
+
+        memcpy(&timestamp, log + pos, sizeof(timestamp));
+        memcpy(&dataSize, log + pos + sizeof(timestamp), sizeof(dataSize));
+
+        // Skip forward to the next plausible record, as LogFile does
+        if ((dataSize & 0xFFFFFFFFFFFF0000) != 0) {
+            pos++;
+            continue;
+        }
+
+        if (pos + RECORD_HEADER_SIZE + dataSize > dataEnd) {
+            break;
+        }
+
+        Record record = { timestamp * static_cast<quint64>(1000), log + pos + RECORD_HEADER_SIZE,
+                          static_cast<int>(dataSize) };
+        records.append(record);
+
+        pos += RECORD_HEADER_SIZE + dataSize;
+
+        if (records.size() == BATCH_RECORDS) {
+            ok = exportBatch(records, outputDir, formats);
+            records.clear();
+        }
+    }
+
+    if (ok) {
+        ok = exportBatch(records, outputDir, formats);
+    }
+
+    // Close the tables before their data goes away
+    clear();
+    file.unmap(mapped);
+
+    return ok;
+}
+
+bool LogExport::exportBatch(const QVector<Record> &records, const QString &outputDir,
+                            int formats)
+{
+    int slices = decoders.size();
+    QVector<QVector<UAVTalkDecoder::Frame>> frames(slices);
+
+    // LogFile writes a whole frame per record, so slices decode independently
+    for (int i = 0; i < slices; i++) {
+        int begin = records.size() * i / slices;
+        int end = records.size() * (i + 1) / slices;
+        UAVTalkDecoder *decoder = decoders[i];
+        QVector<UAVTalkDecoder::Frame> *decoded = &frames[i];
+
+        pool.start(new LogExportJob([&records, begin, end, decoder, decoded]() {
+            for (int r = begin; r < end; r++) {
+                decoder->decode(records[r].data, records[r].size, records[r].timestamp);
+            }
+
+            decoder->takeFrames(*decoded);
+        }));
+    }
+
+    pool.waitForDone();
+
+    QVector<ObjectWriter *> pending;
+
+    for (const QVector<UAVTalkDecoder::Frame> &slice : frames) {
+        for (const UAVTalkDecoder::Frame &frame : slice) {
+            if (!frame.isObjectUpdate()) {
+                continue;
+            }
+
+            auto it = writers.constFind(frame.objId);
+
+            if (it == writers.constEnd()) {
+                // Only data objects are exported, not their metadata
+                UAVDataObject *obj = dynamic_cast<UAVDataObject *>(objMngr->getObject(frame.objId));
+                ObjectWriter *writer = obj ? new ObjectWriter(obj) : nullptr;
+
+                it = writers.insert(frame.objId, writer);
+
+                if (writer && !writer->open(outputDir, formats, error)) {
+                    return false;
+                }
+            }
+
+            ObjectWriter *writer = it.value();
+
+            if (!writer) {
+                continue;
+            }
+
+            if (writer->pending.isEmpty()) {
+                pending.append(writer);
+            }
+
+            writer->pending.append(frame);
+            updates++;
+        }
+    }
+
+    for (ObjectWriter *writer : pending) {
+        pool.start(new LogExportJob([writer]() { writer->write(); }));
+    }
+
+    pool.waitForDone();
+
+    return true;
+}
+
+/**
+ * @}
+ * @}
+ */
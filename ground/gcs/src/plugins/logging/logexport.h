@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logexport.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Decodes a log file into one table per object
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LOGEXPORT_H
+#define LOGEXPORT_H
+
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "uavobjects/uavobjectmanager.h"
+#include <uavtalk/uavtalkdecoder.h>
+
+/**
+ * Decodes every object update in a log, compressed or not, as fast as the
+ * CPU allows, with no replay pacing, and writes a table per object type:
+ * a row per update with the log timestamp in microseconds, the instance
+ * and a column per field element.
+ *
+ * Tables can be written as CSV (<Object>.csv) and in a binary columnar
+ * format (<Object>.drcol), all little-endian:
+ *
+ *   "DRCL" version(u32) objId(u32) columns(u32)
+ *   per column: nameLength(u16) name(UTF-8) type(u8) size(u8)
+ *   blocks of: rows(u32), then each column's values for those rows
+ *
+ * Column types are UAVObjectField::FieldType values, except for the
+ * timestamp column, which is TIMESTAMP_TYPE (a u64); a string column holds
+ * size bytes per row.  Each block is one batch of the log, so a reader can
+ * process a table without loading all of it.
+ *
+ * Batches of records are decoded on a pool of threads, and the tables are
+ * then written in parallel, one object type per thread.
+ */
+class LogExport
+{
+public:
+    enum Format { CSV = 0x01, COLUMNS = 0x02 };
+
+    static const quint8 TIMESTAMP_TYPE = 0x80;
+
+    LogExport(UAVObjectManager *objMngr);
+    ~LogExport();
+
+    bool exportLog(const QString &logName, const QString &outputDir, int formats = CSV | COLUMNS);
+
+    QString errorString() const { return error; }
+    quint32 exportedUpdates() const { return updates; }
+
+private:
+    static const int BATCH_RECORDS = 65536;
+    static const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+
+    struct Record
+    {
+        quint64 timestamp; // us
+        const char *data;
+        int size;
+    };
+
+    class ObjectWriter;
+
+    UAVObjectManager *objMngr;
+    QThreadPool pool;
+    QVector<UAVTalkDecoder *> decoders;
+    QHash<quint32, ObjectWriter *> writers;
+    QString error;
+    quint32 updates;
+
+    void clear();
+    bool exportBatch(const QVector<Record> &records, const QString &outputDir, int formats);
+};
+
+#endif // LOGEXPORT_H
+
+/**
+ * @}
+ * @}
+ */
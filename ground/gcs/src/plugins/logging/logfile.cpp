@@ -30,14 +30,33 @@
 #include <QTextStream>
 #include <QMainWindow>
 #include <QMessageBox>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QSaveFile>
 
 #include <coreplugin/icore.h>
 #include <coreplugin/coreconstants.h>
 
 LogFile::LogFile(QObject *parent)
     : QIODevice(parent)
-    , timestampBufferIdx(0)
+    , bufferHead(0)
+    , bufferTail(0)
+    , lastTimeStamp(0)
+    , playStart(0)
+    , playOffset(0)
+    , playbackSpeed(1)
+    , playing(false)
+    , compressed(false)
+    , blockReader(nullptr)
+    , mapped(nullptr)
+    , dataEnd(0)
+    , lastTimeStampPos(0)
+    , lastDataSize(0)
+    , firstTimestamp(0)
 {
+    // Replay sleeps until the next record is due, rather than polling
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
 
@@ -48,17 +67,18 @@ LogFile::LogFile(QObject *parent)
  */
 bool LogFile::open(OpenMode mode)
 {
-
-    // start a timer for playback
-    myTime.restart();
     if (file.isOpen()) {
         // We end up here when doing a replay, because the connection
         // manager will also try to open the QIODevice, even though we just
         // opened it after selecting the file, which happens before the
-        // connection manager call...
+        // connection manager call...  The clock must be left alone then,
+        // as replay is already paced from it.
         return true;
     }
 
+    // start the clock records are stamped with
+    clock.start();
+
     // Open file as either WriteOnly, or ReadOnly, depending on `mode` parameter
     if (file.open(mode) == false) {
         qDebug() << "Unable to open " << file.fileName() << " for logging";
@@ -89,7 +109,16 @@ bool LogFile::open(OpenMode mode)
                                .replace("0x", "");
         QTextStream out(&file);
 
-        out << "dRonin git hash:\n" << gitHash << "\n" << uavoHash << "\n##\n";
+        // Compressed logs say so in the header
+        compressed = file.fileName().endsWith(".drlogz");
+
+        out << "dRonin git hash:\n" << gitHash << "\n" << uavoHash << "\n";
+        if (compressed)
+            out << LogBlock::HEADER_TAG << "\n";
+        out << "##\n";
+
+        index.clear();
+        block.clear();
     } else if (mode == QIODevice::ReadOnly) {
         file.readLine(); // Read first line of log file. This assumes that the logfile is of the new
                          // format.
@@ -124,9 +153,13 @@ bool LogFile::open(OpenMode mode)
             msgBox.exec();
         }
 
-        QString tmpLine = file.readLine(); // Look for the header/body separation string.
+        QString tmpLine =
+            file.readLine().trimmed(); // Look for the header/body separation string.
         int cnt = 0;
-        while (tmpLine != "##\n" && cnt < 10 && !file.atEnd()) {
+        compressed = false;
+        while (tmpLine != "##" && cnt < 10 && !file.atEnd()) {
+            if (tmpLine == LogBlock::HEADER_TAG)
+                compressed = true;
             tmpLine = file.readLine().trimmed();
             cnt++;
         }
@@ -152,7 +185,8 @@ bool LogFile::open(OpenMode mode)
     // Must call parent function for QIODevice to pass calls to writeData
     // We always open ReadWrite, because otherwise we will get tons of warnings
     // during a logfile replay. Read nature is checked upon write ops below.
-    QIODevice::open(QIODevice::ReadWrite);
+    // dataBuffer already buffers replayed data, so QIODevice needn't as well.
+    QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
 
     return true;
 }
@@ -161,8 +195,22 @@ void LogFile::close()
 {
     emit aboutToClose();
 
+    playing = false;
     if (timer.isActive())
         timer.stop();
+    if (blockReader) {
+        delete blockReader;
+        blockReader = nullptr;
+    }
+    if (file.isOpen() && file.isWritable() && compressed)
+        writeBlock();
+    if (file.isOpen() && file.isWritable() && !index.isEmpty())
+        writeIndex();
+    block.clear();
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
     file.close();
     QIODevice::close();
 }
@@ -172,7 +220,38 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
     if (!file.isWritable())
         return dataSize;
 
-    quint32 timeStamp = myTime.elapsed();
+    // A monotonic clock, so records stay in order whatever the wall clock does
+    qint64 now = clock.nsecsElapsed();
+    quint32 timeStamp = now / 1000000;
+
+    if (compressed) {
+        // Compressed logs have room for microseconds
+        quint64 timeStampUs = now / 1000;
+
+        if (block.size() + dataSize + LogBlock::MAX_RECORD_HEADER > LogBlock::MAX_SIZE)
+            writeBlock();
+
+        if (dataSize + LogBlock::MAX_RECORD_HEADER > LogBlock::MAX_SIZE) {
+            qDebug() << "Logging: record of" << dataSize << "bytes is too big for a block";
+            return -1;
+        }
+
+        // The block goes where the file ends now, once it is full.  This
+        // must be read after any flush of the previous block above.
+        qint64 pos = file.pos();
+        int offset = block.append(timeStampUs, data, dataSize);
+
+        index.addRecord(timeStamp, LogBlock::position(pos, offset), data, dataSize);
+        emit bytesWritten(dataSize);
+
+        if (block.size() >= LogBlock::TARGET_SIZE
+            || timeStampUs - block.firstTimestamp() >= LogBlock::BLOCK_INTERVAL)
+            writeBlock();
+
+        return dataSize;
+    }
+
+    qint64 pos = file.pos();
 
     file.write(reinterpret_cast<char *>(&timeStamp), sizeof(timeStamp));
     file.write(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
@@ -181,136 +260,326 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
     if (written != -1)
         emit bytesWritten(written);
 
+    index.addRecord(timeStamp, pos, data, dataSize);
+
     return dataSize;
 }
 
+/**
+ * Compress the block being written and write it out.
+ */
+void LogFile::writeBlock()
+{
+    if (block.isEmpty())
+        return;
+
+    QByteArray frame = block.pack();
+
+    if (frame.isEmpty() || file.write(frame) != frame.size())
+        qDebug() << "Logging: unable to write a block of" << block.size() << "bytes";
+
+    block.clear();
+}
+
 qint64 LogFile::readData(char *data, qint64 maxSize)
 {
     QMutexLocker locker(&mutex);
-    qint64 toRead = qMin(maxSize, (qint64)dataBuffer.size());
-    memcpy(data, dataBuffer.data(), toRead);
-    dataBuffer.remove(0, toRead);
+    qint64 toRead = qMin(maxSize, bufferTail - bufferHead);
+    qint64 mask = dataBuffer.size() - 1;
+
+    // The data may wrap around the end of the buffer
+    qint64 first = qMin(toRead, dataBuffer.size() - (bufferHead & mask));
+    memcpy(data, dataBuffer.constData() + (bufferHead & mask), first);
+    memcpy(data + first, dataBuffer.constData(), toRead - first);
+
+    bufferHead += toRead;
+
     return toRead;
 }
 
 qint64 LogFile::bytesAvailable() const
 {
-    return dataBuffer.size();
+    return bufferTail - bufferHead;
 }
 
-void LogFile::timerFired()
+/**
+ * Queue replayed data to be read, growing dataBuffer if it is full.
+ */
+void LogFile::appendData(const char *data, qint64 size)
 {
-    qint64 dataSize;
+    QMutexLocker locker(&mutex);
+    qint64 used = bufferTail - bufferHead;
+
+    if (used + size > dataBuffer.size()) {
+        qint64 newSize = dataBuffer.isEmpty() ? MIN_BUFFER_SIZE : dataBuffer.size();
 
-    if (file.bytesAvailable() > 4) {
+        while (used + size > newSize) {
+            newSize *= 2;
+        }
 
-        int time;
-        time = myTime.elapsed();
+        // Move what is still unread to the start of the new buffer
+        QByteArray grown(newSize, Qt::Uninitialized);
+        qint64 mask = dataBuffer.size() - 1;
 
-        // Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset) * playbackSpeed)
-                > (lastTimeStamp - firstTimestamp))) {
-            lastPlayTime += ((time - lastPlayTimeOffset) * playbackSpeed);
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+        if (used) {
+            qint64 first = qMin(used, dataBuffer.size() - (bufferHead & mask));
+            memcpy(grown.data(), dataBuffer.constData() + (bufferHead & mask), first);
+            memcpy(grown.data() + first, dataBuffer.constData(), used - first);
+        }
 
-            file.seek(lastTimeStampPos + sizeof(lastTimeStamp));
+        dataBuffer.swap(grown);
+        bufferHead = 0;
+        bufferTail = used;
+    }
 
-            file.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+    qint64 mask = dataBuffer.size() - 1;
+    qint64 first = qMin(size, dataBuffer.size() - (bufferTail & mask));
 
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if (file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+    memcpy(dataBuffer.data() + (bufferTail & mask), data, first);
+    memcpy(dataBuffer.data(), data + first, size - first);
 
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
+    bufferTail += size;
+}
 
-            if (file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+/**
+ * Get part of the records of the log being replayed, from the mapping if
+ * the file could be mapped.  Otherwise it is read, and only valid until the
+ * next call.
+ * \return the data, or nullptr if it could not be read
+ */
+const char *LogFile::logData(qint64 pos, qint64 size)
+{
+    if (pos < 0 || pos + size > dataEnd) {
+        return nullptr;
+    }
 
-            lastTimeStampPos = timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
+    if (mapped) {
+        return reinterpret_cast<const char *>(mapped + pos);
+    }
 
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
-        }
-    } else {
-        stopReplay();
+    file.seek(pos);
+    readBuffer = file.read(size);
+
+    return readBuffer.size() == size ? readBuffer.constData() : nullptr;
+}
+
+/**
+ * How far replay has got, in us of log time since firstTimestamp.
+ */
+qint64 LogFile::playPosition() const
+{
+    if (!playing) {
+        return playStart;
     }
+
+    return playStart + (clock.nsecsElapsed() - playOffset) / 1000 * playbackSpeed;
 }
 
-bool LogFile::startReplay()
+/**
+ * Arm the timer for when the next record is due.
+ */
+void LogFile::scheduleReplay()
 {
-    dataBuffer.clear();
-    myTime.restart();
-    lastPlayTimeOffset = 0;
-    lastPlayTime = 0;
-    playbackSpeed = 1;
+    if (!playing || playbackSpeed <= 0) {
+        timer.stop();
+        return;
+    }
 
-    // Read all log timestamps into array
-    timestampBuffer.clear(); // Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx = file.pos();
-    timestampBufferIdx = 0;
-    lastTimeStamp = 0;
+    qint64 wait = (lastTimeStamp - firstTimestamp - playPosition()) / playbackSpeed;
 
-    while (!file.atEnd()) {
-        qint64 dataSize;
+    // Round up, so that the record is due by the time the timer fires
+    timer.start(wait > 0 ? (wait + 999) / 1000 : 0);
+}
+
+void LogFile::timerFired()
+{
+    qint64 now = playPosition();
+    bool replayed = false;
+
+    // Replay every record that is due, however close together they are
+    while (lastTimeStamp - firstTimestamp <= now) {
+        if (lastDataSize < 1 || lastDataSize > (1024 * 1024)) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << lastDataSize
+                     << "\n";
+            stopReplay();
+            return;
+        }
+
+        // findRecord() has already checked that the whole record is there
+        const char *data = recordData(lastTimeStampPos, lastDataSize);
+
+        if (!data) {
+            stopReplay();
+            return;
+        }
+
+        appendData(data, lastDataSize);
+        replayed = true;
+
+        lastTimeStampPos = nextRecordPos(lastTimeStampPos, lastDataSize);
+
+        if (!findRecord(lastTimeStampPos, lastTimeStamp, lastDataSize)) {
+            emit readyRead();
+            stopReplay();
+            return;
+        }
+    }
 
-        // Get time stamp position
-        timestampPos.append(file.pos());
+    // Once per tick rather than per packet, which is far cheaper at high speed
+    if (replayed) {
+        emit readyRead();
+    }
+
+    scheduleReplay();
+}
+
+/**
+ * Find the next intact record at or after pos, skipping forward a byte at a
+ * time past anything that cannot be a record header.
+ * \return false if the log ends first
+ */
+bool LogFile::findRecord(qint64 &pos, qint64 &timeStamp, qint64 &dataSize)
+{
+    if (compressed)
+        return findBlockRecord(pos, timeStamp, dataSize);
+
+    while (pos + RECORD_HEADER_SIZE <= dataEnd) {
+        const char *header = logData(pos, RECORD_HEADER_SIZE);
+        quint32 timeStampMs;
+
+        if (!header) {
+            return false;
+        }
 
         // Read timestamp and logfile packet size
-        file.read(reinterpret_cast<char *>(&lastTimeStamp), sizeof(lastTimeStamp));
-        file.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+        memcpy(&timeStampMs, header, sizeof(timeStampMs));
+        memcpy(&dataSize, header + sizeof(timeStampMs), sizeof(dataSize));
+
+        timeStamp = timeStampMs * static_cast<qint64>(1000);
 
         // Check if dataSize sync bytes are correct.
         // TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN
         // THE STRING OF SIX 0x00
         if ((dataSize & 0xFFFFFFFFFFFF0000) != 0) {
-            qDebug() << "Wrong sync byte. At file location 0x"
-                     << QString("%1").arg(file.pos(), 0, 16) << "Got 0x"
-                     << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000, 0, 16)
+            qDebug() << "Wrong sync byte. At file location 0x" << QString("%1").arg(pos, 0, 16)
+                     << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000, 0, 16)
                      << ", but expected 0x"
                         "00"
                         ".";
-            file.seek(timestampPos.last() + 1);
-            timestampPos.pop_back();
+            pos++;
             continue;
         }
 
-        // Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()) {
-            QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected "
-                                      "behavior"); //<--TODO: add hyperlink to webpage with better
-                                                   // description.
-            msgBox.exec();
+        return pos + RECORD_HEADER_SIZE + dataSize <= dataEnd;
+    }
+
+    return false;
+}
+
+/**
+ * Get the payload of the record at pos, found by findRecord().
+ * \return the data, or nullptr if it could not be read
+ */
+const char *LogFile::recordData(qint64 pos, qint64 dataSize)
+{
+    if (!compressed)
+        return logData(pos + RECORD_HEADER_SIZE, dataSize);
+
+    if (!loadBlock(LogBlock::blockPos(pos)) || block.pos() != LogBlock::blockPos(pos))
+        return nullptr;
+
+    const LogBlock::Record *record = block.find(LogBlock::offset(pos));
+
+    return record && record->size == dataSize ? block.recordData(*record) : nullptr;
+}
+
+/**
+ * \return where to look for the record after the one at pos
+ */
+qint64 LogFile::nextRecordPos(qint64 pos, qint64 dataSize) const
+{
+    // Within a block, any offset past the start of a record finds the next
+    return compressed ? pos + 1 : pos + RECORD_HEADER_SIZE + dataSize;
+}
+
+/**
+ * Make the block at blockPos, or the next good one after it, the one
+ * records are read from.
+ * \return false if the log ends first
+ */
+bool LogFile::loadBlock(qint64 blockPos)
+{
+    if (block.pos() == blockPos && block.nextPos() != 0)
+        return true;
+
+    return blockReader && blockReader->take(blockPos, block);
+}
+
+/**
+ * findRecord() for compressed logs, where pos combines the position of a
+ * block and of a record within it.
+ */
+bool LogFile::findBlockRecord(qint64 &pos, qint64 &timeStamp, qint64 &dataSize)
+{
+    qint64 blockPos = LogBlock::blockPos(pos);
+    int offset = LogBlock::offset(pos);
+
+    while (loadBlock(blockPos)) {
+        // A corrupt block was skipped
+        if (block.pos() != blockPos) {
+            blockPos = block.pos();
+            offset = 0;
+        }
+
+        const LogBlock::Record *record = block.find(offset);
+
+        if (record) {
+            pos = LogBlock::position(blockPos, record->offset);
+            timeStamp = record->timestamp;
+            dataSize = record->size;
+            return true;
+        }
+
+        blockPos = block.nextPos();
+        offset = 0;
+    }
+
+    return false;
+}
+
+bool LogFile::startReplay()
+{
+    dataBuffer.clear();
+    bufferHead = 0;
+    bufferTail = 0;
+    clock.start();
+    playStart = 0;
+    playbackSpeed = 1;
 
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
+    qint64 logFileStartIdx = file.pos();
+
+    lastTimeStampPos = logFileStartIdx;
+
+    if (compressed) {
+        lastTimeStampPos = LogBlock::position(logFileStartIdx, 0);
+    } else {
+        // Logs can be far bigger than we would want to read into memory; let
+        // the OS page the file in as it is replayed.
+        mapped = file.map(0, file.size());
+        if (!mapped) {
+            qDebug() << "Unable to map" << file.fileName() << ", reading it instead";
         }
+    }
 
-        timestampBuffer.append(lastTimeStamp);
+    bool indexed = loadIndex(logFileStartIdx);
 
-        file.seek(timestampPos.last() + sizeof(lastTimeStamp) + sizeof(dataSize) + dataSize);
+    if (indexed && compressed) {
+        blockReader = new LogBlockReader(file.fileName(), dataEnd);
+        blockReader->start();
     }
 
     // Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0) {
+    if (!indexed || !findRecord(lastTimeStampPos, lastTimeStamp, lastDataSize)) {
         QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found.");
@@ -320,19 +589,250 @@ bool LogFile::startReplay()
         return false;
     }
 
-    // Reset to log beginning.
-    file.seek(logFileStartIdx + sizeof(lastTimeStamp));
-    lastTimeStampPos = timestampPos[0];
-    lastTimeStamp = timestampBuffer[0];
-    firstTimestamp = timestampBuffer[0];
-    timestampBufferIdx = 1;
+    firstTimestamp = lastTimeStamp;
 
-    timer.setInterval(10);
-    timer.start();
+    // Indexing may have taken a while; start the clock from here
+    playOffset = clock.nsecsElapsed();
+    playing = true;
+    scheduleReplay();
     emit replayStarted();
     return true;
 }
 
+/**
+ * Get the index of the log being replayed: the one stored at its end,
+ * else the one cached next to it, else build it by reading the whole log.
+ * \return true if the log has any records
+ */
+bool LogFile::loadIndex(qint64 dataStart)
+{
+    dataEnd = file.size();
+
+    if (readIndex() || readSidecar()) {
+        return true;
+    }
+
+    if (!scanLog(dataStart)) {
+        return false;
+    }
+
+    writeSidecar();
+
+    return true;
+}
+
+/**
+ * Read the index written at the end of the log by writeIndex().
+ * \return true on success, with dataEnd set to the end of the log data
+ */
+bool LogFile::readIndex()
+{
+    qint64 size = file.size();
+
+    if (size < RECORD_HEADER_SIZE + LogIndex::TRAILER_SIZE) {
+        return false;
+    }
+
+    file.seek(size - LogIndex::TRAILER_SIZE);
+
+    QByteArray trailer = file.read(LogIndex::TRAILER_SIZE);
+
+    if (trailer.size() != LogIndex::TRAILER_SIZE) {
+        return false;
+    }
+
+    qint64 indexPos = LogIndex::trailerOffset(trailer.constData());
+
+    if (indexPos < 0 || indexPos >= size) {
+        return false;
+    }
+
+    if (compressed) {
+        LogBlock indexBlock;
+
+        if (!indexBlock.read(file, indexPos, size - LogIndex::TRAILER_SIZE, LogBlock::INDEX_MAGIC)
+            || !index.load(indexBlock.data())) {
+            return false;
+        }
+
+        dataEnd = indexPos;
+
+        return true;
+    }
+
+    // The index may be split over several records
+    QByteArray data;
+    qint64 pos = indexPos;
+
+    while (pos < size) {
+        quint32 timeStamp;
+        qint64 dataSize;
+
+        file.seek(pos);
+        file.read(reinterpret_cast<char *>(&timeStamp), sizeof(timeStamp));
+        file.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+
+        if (dataSize < 0 || dataSize > MAX_INDEX_RECORD
+            || pos + RECORD_HEADER_SIZE + dataSize > size) {
+            return false;
+        }
+
+        data.append(file.read(dataSize));
+        pos += RECORD_HEADER_SIZE + dataSize;
+    }
+
+    data.chop(LogIndex::TRAILER_SIZE);
+
+    if (!index.load(data)) {
+        return false;
+    }
+
+    dataEnd = indexPos;
+
+    return true;
+}
+
+/**
+ * Append the index to the log being written.  It is stored as ordinary
+ * records, each small enough that readers which don't know about the index
+ * skip over it as they would any other record they can't decode, followed
+ * by the trailer saying where the index starts.
+ */
+void LogFile::writeIndex()
+{
+    QByteArray data = index.save();
+    qint64 indexPos = file.pos();
+
+    // Compressed logs have no readers that don't know about the index
+    if (compressed) {
+        file.write(LogBlock::compress(LogBlock::INDEX_MAGIC, data));
+        file.write(LogIndex::trailer(indexPos));
+        return;
+    }
+    quint32 timeStamp = index.lastTimestamp();
+
+    for (qint64 written = 0; written < data.size();) {
+        QByteArray record = data.mid(written, MAX_INDEX_RECORD - LogIndex::TRAILER_SIZE);
+        written += record.size();
+
+        if (written == data.size()) {
+            record.append(LogIndex::trailer(indexPos));
+        }
+
+        qint64 dataSize = record.size();
+
+        file.write(reinterpret_cast<char *>(&timeStamp), sizeof(timeStamp));
+        file.write(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+        file.write(record);
+    }
+}
+
+/**
+ * Read the index cached for a log that has none of its own, if the log has
+ * not changed since.
+ */
+bool LogFile::readSidecar()
+{
+    QFile sidecar(sidecarName());
+
+    if (!sidecar.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&sidecar);
+    quint32 magic;
+    qint64 size, modified;
+    QByteArray data;
+
+    in >> magic >> size >> modified >> data;
+
+    if (in.status() != QDataStream::Ok || magic != SIDECAR_MAGIC || size != file.size()
+        || modified != QFileInfo(file).lastModified().toMSecsSinceEpoch()) {
+        return false;
+    }
+
+    return index.load(data);
+}
+
+/**
+ * Cache the index next to a log that has none of its own, so it only needs
+ * to be built once.  Failing to is harmless.
+ */
+void LogFile::writeSidecar()
+{
+    QSaveFile sidecar(sidecarName());
+
+    if (!sidecar.open(QIODevice::WriteOnly)) {
+        qDebug() << "Unable to cache the index of" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&sidecar);
+
+    out << SIDECAR_MAGIC << file.size() << QFileInfo(file).lastModified().toMSecsSinceEpoch()
+        << index.save();
+
+    sidecar.commit();
+}
+
+/**
+ * Build the index of a log that has none by reading every record header.
+ * \return true if the log has any records
+ */
+bool LogFile::scanLog(qint64 dataStart)
+{
+    qint64 pos = dataStart;
+    qint64 timeStamp;
+    qint64 dataSize;
+    bool warned = false;
+
+    index.clear();
+
+    auto addRecord = [&](quint32 time, qint64 recordPos, const char *data, qint64 size) {
+        // Check if timestamps are sequential.
+        if (!index.isEmpty() && time < index.lastTimestamp() && !warned) {
+            QMessageBox msgBox(dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()));
+            msgBox.setText("Corrupted file.");
+            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected "
+                                      "behavior"); //<--TODO: add hyperlink to webpage with better
+                                                   // description.
+            msgBox.exec();
+
+            qDebug() << "Timestamp: " << index.lastTimestamp() << " " << time;
+            warned = true;
+        }
+
+        index.addRecord(time, recordPos, data, size);
+    };
+
+    if (compressed) {
+        LogBlock scanned;
+
+        while (scanned.read(file, pos, dataEnd)) {
+            for (const LogBlock::Record &record : scanned.records()) {
+                addRecord(record.timestamp / 1000,
+                          LogBlock::position(scanned.pos(), record.offset),
+                          scanned.recordData(record), record.size);
+            }
+
+            pos = scanned.nextPos();
+        }
+
+        return !index.isEmpty();
+    }
+
+    while (findRecord(pos, timeStamp, dataSize)) {
+        // Only the start of the payload is needed, to tell which object it is
+        qint64 headSize = qMin(dataSize, static_cast<qint64>(8));
+
+        addRecord(timeStamp / 1000, pos, logData(pos + RECORD_HEADER_SIZE, headSize), headSize);
+
+        pos += RECORD_HEADER_SIZE + dataSize;
+    }
+
+    return !index.isEmpty();
+}
+
 bool LogFile::stopReplay()
 {
     close();
@@ -340,33 +840,83 @@ bool LogFile::stopReplay()
     return true;
 }
 
+void LogFile::setReplaySpeed(double val)
+{
+    // Carry on from where replay is, at the new speed
+    playStart = playPosition();
+    playOffset = clock.nsecsElapsed();
+    playbackSpeed = val;
+    qDebug() << "New playback speed: " << playbackSpeed;
+
+    scheduleReplay();
+}
+
 void LogFile::pauseReplay()
 {
+    playStart = playPosition();
+    playing = false;
     timer.stop();
 }
 
 void LogFile::resumeReplay()
 {
-    lastPlayTimeOffset = myTime.elapsed();
-    timer.start();
+    if (!file.isOpen())
+        return;
+
+    playOffset = clock.nsecsElapsed();
+    playing = true;
+    scheduleReplay();
 }
 
 /**
  * @brief LogFile::setReplayTime, sets the playback time
- * @param val, the time in
+ * @param val, the time in seconds
  */
 void LogFile::setReplayTime(double val)
 {
-    quint32 tmpIdx = 0;
-    while (timestampBuffer[tmpIdx++] <= val * 1000 && tmpIdx <= timestampBufferIdx) {
+    qint64 target = val * 1000000;
+    qint64 pos = index.find(target / 1000);
+    qint64 timeStamp;
+    qint64 dataSize;
+    bool found;
+
+    if (pos < 0) {
+        return;
+    }
+
+    // The index only holds some records; walk from there to the one wanted
+    while ((found = findRecord(pos, timeStamp, dataSize)) && timeStamp < target) {
+        pos = nextRecordPos(pos, dataSize);
+    }
+
+    if (!found) {
+        qDebug() << "Cannot replay at" << target / 1000 << ", the log ends at"
+                 << index.lastTimestamp();
+        return;
+    }
+
+    // Bring objects that are rarely sent up to date
+    for (qint64 objPos : index.latestObjects(pos)) {
+        qint64 objTimeStamp;
+        qint64 objDataSize;
+
+        const char *data = findRecord(objPos, objTimeStamp, objDataSize)
+            ? recordData(objPos, objDataSize)
+            : nullptr;
+
+        if (data) {
+            appendData(data, objDataSize);
+        }
     }
+    emit readyRead();
 
-    lastTimeStampPos = timestampPos[tmpIdx];
-    lastTimeStamp = timestampBuffer[tmpIdx];
-    timestampBufferIdx = tmpIdx;
+    lastTimeStampPos = pos;
+    lastTimeStamp = timeStamp;
+    lastDataSize = dataSize;
 
-    lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime = lastTimeStamp;
+    playStart = lastTimeStamp - firstTimestamp;
+    playOffset = clock.nsecsElapsed();
+    scheduleReplay();
 
-    qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val * 1000;
+    qDebug() << "Replaying at: " << lastTimeStamp / 1000 << ", but requestion at" << val * 1000;
 }
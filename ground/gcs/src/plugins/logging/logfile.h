@@ -28,12 +28,14 @@
 #define LOGFILE_H
 
 #include <QIODevice>
-#include <QTime>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
 #include "uavobjects/uavobjectmanager.h"
+#include "logindex.h"
+#include "logblock.h"
 #include <math.h>
 
 class LogFile : public QIODevice
@@ -53,11 +55,7 @@ public:
     bool stopReplay();
 
 public slots:
-    void setReplaySpeed(double val)
-    {
-        playbackSpeed = val;
-        qDebug() << "New playback speed: " << playbackSpeed;
-    }
+    void setReplaySpeed(double val);
     void setReplayTime(double val);
     void pauseReplay();
     void resumeReplay();
@@ -71,23 +69,67 @@ signals:
     void replayFinished();
 
 protected:
+    /* Ring buffer of replayed data not yet read.  Only the bytes from
+     * bufferHead to bufferTail, taken modulo its size, are valid.
+     */
     QByteArray dataBuffer;
+    qint64 bufferHead;
+    qint64 bufferTail;
     QTimer timer;
-    QTime myTime;
+    QElapsedTimer clock;
     QFile file;
-    quint32 lastTimeStamp;
-    quint32 lastPlayTime;
+    qint64 lastTimeStamp; // us
     QMutex mutex;
 
-    int lastPlayTimeOffset;
+    /* Replay has reached playStart (us of log time since firstTimestamp)
+     * at playOffset (ns of clock), and goes on at playbackSpeed from there.
+     */
+    qint64 playStart;
+    qint64 playOffset;
     double playbackSpeed;
+    bool playing;
 
 private:
-    QList<quint32> timestampBuffer;
-    QList<quint32> timestampPos;
-    quint32 timestampBufferIdx;
-    quint32 lastTimeStampPos;
-    quint32 firstTimestamp;
+    /* Each record is the timestamp, the payload size and the payload */
+    static const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+    static const qint64 MAX_INDEX_RECORD = 0xFFFF;
+    static const quint32 SIDECAR_MAGIC = 0x44524958; // "DRIX"
+
+    static const int MIN_BUFFER_SIZE = 65536;
+
+    LogIndex index;
+
+    /* Compressed logs are written a block at a time, and replayed from
+     * blocks decompressed ahead by blockReader.
+     */
+    bool compressed;
+    LogBlock block;
+    LogBlockReader *blockReader;
+
+    uchar *mapped;
+    QByteArray readBuffer;
+    qint64 dataEnd;
+    qint64 lastTimeStampPos;
+    qint64 lastDataSize;
+    qint64 firstTimestamp; // us
+
+    void appendData(const char *data, qint64 size);
+    const char *logData(qint64 pos, qint64 size);
+    qint64 playPosition() const;
+    void scheduleReplay();
+    bool findRecord(qint64 &pos, qint64 &timeStamp, qint64 &dataSize);
+    const char *recordData(qint64 pos, qint64 dataSize);
+    qint64 nextRecordPos(qint64 pos, qint64 dataSize) const;
+    bool loadBlock(qint64 blockPos);
+    bool findBlockRecord(qint64 &pos, qint64 &timeStamp, qint64 &dataSize);
+    void writeBlock();
+    bool loadIndex(qint64 dataStart);
+    bool readIndex();
+    void writeIndex();
+    QString sidecarName() const { return file.fileName() + ".idx"; }
+    bool readSidecar();
+    void writeSidecar();
+    bool scanLog(qint64 dataStart);
 };
 
 #endif // LOGFILE_H
@@ -10,9 +10,15 @@ include(../../plugins/scope/scope.pri)
 include(../../plugins/uavobjects/uavobjects.pri)
 include(../../plugins/uavobjectutil/uavobjectutil.pri)
 include(../../plugins/uavtalk/uavtalk.pri)
+include(../../libs/zlib/zlib.pri)
+
+unix: LIBS *= -lz
 
 HEADERS += loggingplugin.h \
     logfile.h \
+    logindex.h \
+    logblock.h \
+    logexport.h \
     logginggadgetwidget.h \
     logginggadget.h \
     logginggadgetfactory.h \
@@ -21,12 +27,19 @@ HEADERS += loggingplugin.h \
 
 SOURCES += loggingplugin.cpp \
     logfile.cpp \
+    logindex.cpp \
+    logblock.cpp \
+    logexport.cpp \
     logginggadgetwidget.cpp \
     logginggadget.cpp \
     logginggadgetfactory.cpp \
     loggingdevice.cpp \
     flightlogdownload.cpp
 
+contains(DEFINES, WITH_TESTS) {
+    SOURCES += loggingtests.cpp
+}
+
 OTHER_FILES += LoggingGadget.pluginspec
 
 FORMS += logging.ui \
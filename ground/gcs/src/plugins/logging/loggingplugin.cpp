@@ -31,12 +31,16 @@
 #include "loggingdevice.h"
 #include "logginggadgetfactory.h"
 #include "flightlogdownload.h"
+#include "logexport.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QtPlugin>
 #include <QThread>
 #include <QStringList>
 #include <QDir>
+#include <QFileInfo>
+#include <QTimer>
 #include <QFileDialog>
 #include <QList>
 #include <QErrorMessage>
@@ -79,7 +83,7 @@ QIODevice *LoggingConnection::openDevice(IDevice *deviceName)
 
     QString fileName = QFileDialog::getOpenFileName(
         dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()), tr("Open file"),
-        QString(""), tr("dRonin Log Files (*.drlog *.tll)"));
+        QString(""), tr("dRonin Log Files (*.drlog *.drlogz *.tll)"));
 
     if (!fileName.isNull()) {
         startReplay(fileName);
@@ -294,6 +298,7 @@ void LoggingThread::transactionCompleted(UAVObject *obj, bool success)
 
 LoggingPlugin::LoggingPlugin()
     : state(IDLE)
+    , exportFormats(LogExport::CSV | LogExport::COLUMNS)
 {
     logConnection = new LoggingConnection();
 }
@@ -312,8 +317,25 @@ LoggingPlugin::~LoggingPlugin()
  */
 bool LoggingPlugin::initialize(const QStringList &args, QString *errMsg)
 {
-    Q_UNUSED(args);
-    Q_UNUSED(errMsg);
+    // Arguments come as name, value pairs
+    for (int i = 0; i + 1 < args.size(); i += 2) {
+        const QString &value = args.at(i + 1);
+
+        if (args.at(i) == "exportlog") {
+            exportLogName = value;
+        } else if (args.at(i) == "exportdir") {
+            exportDir = value;
+        } else if (args.at(i) == "exportformat") {
+            if (value == "csv") {
+                exportFormats = LogExport::CSV;
+            } else if (value == "columns") {
+                exportFormats = LogExport::COLUMNS;
+            } else if (value != "all") {
+                *errMsg = tr("Unknown export format: %0").arg(value);
+                return false;
+            }
+        }
+    }
 
     loggingThread = NULL;
 
@@ -364,17 +386,23 @@ void LoggingPlugin::downloadLog()
 void LoggingPlugin::toggleLogging()
 {
     if (state == IDLE) {
+        QString compressedFilter = tr("Compressed dRonin Log (*.drlogz)");
+        QString selectedFilter;
 
         QString fileName = QFileDialog::getSaveFileName(
             dynamic_cast<QWidget *>(Core::ICore::instance()->mainWindow()), tr("Start Log"),
             QDir::homePath() + QDir::separator()
                 + tr("dRonin-%0.drlog")
                       .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss")),
-            tr("dRonin Log (*.drlog)"));
+            tr("dRonin Log (*.drlog)") + ";;" + compressedFilter, &selectedFilter);
 
         if (fileName.isEmpty())
             return;
 
+        // LogFile compresses logs by their name
+        if (selectedFilter == compressedFilter && fileName.endsWith(".drlog"))
+            fileName.append('z');
+
         startLogging(fileName);
         cmdLogging->action()->setText(tr("Stop logging"));
 
@@ -451,6 +479,39 @@ void LoggingPlugin::replayStarted()
 void LoggingPlugin::extensionsInitialized()
 {
     addAutoReleasedObject(logConnection);
+
+    if (!exportLogName.isEmpty()) {
+        // Let the rest of the application finish starting first
+        QTimer::singleShot(0, this, &LoggingPlugin::exportLog);
+    }
+}
+
+/**
+ * Export the log given on the command line, then quit.  Nothing is
+ * connected or replayed, so this works with -platform offscreen.
+ */
+void LoggingPlugin::exportLog()
+{
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    QString outputDir = exportDir;
+
+    if (outputDir.isEmpty()) {
+        outputDir = QFileInfo(exportLogName).absolutePath();
+    }
+
+    LogExport exporter(objManager);
+    bool ok = exporter.exportLog(exportLogName, outputDir, exportFormats);
+
+    if (ok) {
+        qDebug() << "Logging: exported" << exporter.exportedUpdates() << "updates from"
+                 << exportLogName << "to" << outputDir;
+    } else {
+        qWarning() << "Logging: export of" << exportLogName
+                   << "failed:" << exporter.errorString();
+    }
+
+    QCoreApplication::exit(ok ? 0 : 1);
 }
 
 void LoggingPlugin::shutdown()
@@ -142,11 +142,22 @@ private slots:
     void loggingStopped();
     void replayStarted();
     void replayStopped();
+    void exportLog();
 
 private:
     LoggingGadgetFactory *mf;
     Core::Command *cmdLogging;
     Core::Command *cmdDownload;
+
+    // Set by the exportlog plugin argument, to export a log and exit
+    QString exportLogName;
+    QString exportDir;
+    int exportFormats;
+
+#ifdef WITH_TESTS
+private Q_SLOTS:
+    void testReplayAfterReopen();
+#endif
 };
 #endif /* LoggingPLUGIN_H_ */
 /**
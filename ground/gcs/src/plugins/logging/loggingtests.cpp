@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * @file       loggingtests.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Tests of log replay
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "loggingplugin.h"
+#include "logfile.h"
+
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTest>
+
+/**
+ * The connection manager opens the device again once replay has started.
+ * That must not disturb the pacing of the replay.
+ */
+void LoggingPlugin::testReplayAfterReopen()
+{
+    const int recordGap = 400; // ms
+    const char record[] = "abcd";
+    const qint64 recordSize = sizeof(record) - 1;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString logName = dir.filePath("reopen.drlog");
+
+    {
+        LogFile log;
+
+        log.setFileName(logName);
+        QVERIFY(log.open(QIODevice::WriteOnly));
+        QCOMPARE(log.write(record, recordSize), recordSize);
+        QTest::qSleep(recordGap);
+        QCOMPARE(log.write(record, recordSize), recordSize);
+        log.close();
+    }
+
+    LogFile log;
+    QElapsedTimer replayTime;
+
+    log.setFileName(logName);
+    QVERIFY(log.open(QIODevice::ReadOnly));
+    QVERIFY(log.startReplay());
+    replayTime.start();
+
+    QTRY_COMPARE_WITH_TIMEOUT(log.bytesAvailable(), recordSize, recordGap / 2);
+
+    // As ConnectionManager does when it connects to the device
+    QTest::qWait(recordGap * 3 / 4);
+    QVERIFY(log.open(QIODevice::ReadWrite));
+
+    QTRY_COMPARE_WITH_TIMEOUT(log.bytesAvailable(), 2 * recordSize, recordGap);
+
+    // Had the reopen restarted the clock, this would be most of a gap late
+    QVERIFY(replayTime.elapsed() < recordGap * 3 / 2);
+
+    log.close();
+}
+
+/**
+ * @}
+ * @}
+ */
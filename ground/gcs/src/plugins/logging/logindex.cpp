@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logindex.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Timestamp and object index of a log file, for seeking in replay
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "logindex.h"
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+// UAVTalk frames start with sync(1) type(1) length(2) objId(4)
+#define SYNC_VAL 0x3C
+#define OBJID_OFFSET 4
+
+LogIndex::LogIndex()
+    : records(0)
+    , lastTime(0)
+{
+}
+
+void LogIndex::clear()
+{
+    entries.clear();
+    objects.clear();
+    records = 0;
+    lastTime = 0;
+}
+
+/**
+ * Add the next record of the log to the index.
+ * \param[in] timestamp Time the record was logged, in ms
+ * \param[in] offset Position of the record header in the file
+ * \param[in] data Start of the record payload
+ * \param[in] size Bytes available at data
+ */
+void LogIndex::addRecord(quint32 timestamp, qint64 offset, const char *data, qint64 size)
+{
+    Entry entry = { timestamp, offset };
+
+    // Keep the table sorted even if the log's timestamps are not
+    if ((records % RECORD_INTERVAL) == 0
+        && (entries.isEmpty() || entries.last().timestamp <= timestamp)) {
+        entries.append(entry);
+    }
+
+    records++;
+    lastTime = timestamp;
+
+    if (!data || size < OBJID_OFFSET + 4 || static_cast<quint8>(data[0]) != SYNC_VAL) {
+        return;
+    }
+
+    quint32 objId =
+        qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data + OBJID_OFFSET));
+    QVector<Entry> &seen = objects[objId];
+
+    if (!seen.isEmpty()
+        && (seen.last().timestamp / OBJECT_INTERVAL) == (timestamp / OBJECT_INTERVAL)) {
+        seen.last() = entry;
+    } else {
+        seen.append(entry);
+    }
+}
+
+/**
+ * Find where to start reading to reach a time.
+ * \return offset of the last indexed record logged at or before timestamp,
+ * the first record if there is none, or -1 if the index is empty
+ */
+qint64 LogIndex::find(quint32 timestamp) const
+{
+    if (entries.isEmpty()) {
+        return -1;
+    }
+
+    auto it = std::upper_bound(entries.constBegin(), entries.constEnd(), timestamp,
+                               [](quint32 t, const Entry &e) { return t < e.timestamp; });
+
+    if (it == entries.constBegin()) {
+        return it->offset;
+    }
+
+    return (it - 1)->offset;
+}
+
+/**
+ * Find the last indexed record of each object before a position.
+ * \return record offsets, in file order
+ */
+QVector<qint64> LogIndex::latestObjects(qint64 offset) const
+{
+    QVector<qint64> found;
+
+    for (const QVector<Entry> &seen : objects) {
+        auto it = std::lower_bound(seen.constBegin(), seen.constEnd(), offset,
+                                   [](const Entry &e, qint64 o) { return e.offset < o; });
+
+        if (it != seen.constBegin()) {
+            found.append((it - 1)->offset);
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+
+    return found;
+}
+
+/* Last bytes of a log that carries its own index */
+static const char TRAILER_MAGIC[8] = { 'd', 'R', 'L', 'o', 'g', 'I', 'd', 'x' };
+
+QByteArray LogIndex::trailer(qint64 indexOffset)
+{
+    uchar offset[sizeof(indexOffset)];
+
+    qToLittleEndian(indexOffset, offset);
+
+    return QByteArray(reinterpret_cast<const char *>(offset), sizeof(offset))
+        + QByteArray(TRAILER_MAGIC, sizeof(TRAILER_MAGIC));
+}
+
+/**
+ * Check the last TRAILER_SIZE bytes of a log for a trailer.
+ * \return where the index starts, or -1 if there is no trailer
+ */
+qint64 LogIndex::trailerOffset(const char *data)
+{
+    if (memcmp(data + sizeof(qint64), TRAILER_MAGIC, sizeof(TRAILER_MAGIC)) != 0) {
+        return -1;
+    }
+
+    return qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(data));
+}
+
+QByteArray LogIndex::save() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+
+    out << INDEX_VERSION << records << lastTime;
+
+    out << static_cast<quint32>(entries.size());
+    for (const Entry &e : entries) {
+        out << e.timestamp << e.offset;
+    }
+
+    out << static_cast<quint32>(objects.size());
+    for (auto it = objects.constBegin(); it != objects.constEnd(); ++it) {
+        out << it.key() << static_cast<quint32>(it.value().size());
+
+        for (const Entry &e : it.value()) {
+            out << e.timestamp << e.offset;
+        }
+    }
+
+    return data;
+}
+
+/**
+ * Replace the index with one previously saved.
+ * \return true on success, otherwise the index is left empty
+ */
+bool LogIndex::load(const QByteArray &data)
+{
+    QDataStream in(data);
+    quint32 version = 0, count = 0;
+
+    clear();
+
+    in >> version;
+
+    if (version != INDEX_VERSION) {
+        return false;
+    }
+
+    in >> records >> lastTime >> count;
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        Entry e;
+        in >> e.timestamp >> e.offset;
+        entries.append(e);
+    }
+
+    in >> count;
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        quint32 objId, seenCount;
+        in >> objId >> seenCount;
+
+        QVector<Entry> &seen = objects[objId];
+
+        for (quint32 j = 0; j < seenCount && in.status() == QDataStream::Ok; j++) {
+            Entry e;
+            in >> e.timestamp >> e.offset;
+            seen.append(e);
+        }
+    }
+
+    if (in.status() != QDataStream::Ok || entries.isEmpty()) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @}
+ * @}
+ */
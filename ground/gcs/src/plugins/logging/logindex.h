@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logindex.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup loggingplugin
+ * @{
+ * @brief Timestamp and object index of a log file, for seeking in replay
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LOGINDEX_H
+#define LOGINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+/**
+ * Sparse index of the records in a log file.  Every RECORD_INTERVAL'th
+ * record is kept in a table sorted by time, so a seek is a binary search
+ * followed by a short scan forward through the file.
+ *
+ * For each object the index also keeps where it was last logged within
+ * each OBJECT_INTERVAL of log time, so the state of objects that are only
+ * sent now and then can be restored after a seek.
+ */
+class LogIndex
+{
+public:
+    struct Entry
+    {
+        quint32 timestamp;
+        qint64 offset;
+    };
+
+    LogIndex();
+
+    void clear();
+    void addRecord(quint32 timestamp, qint64 offset, const char *data, qint64 size);
+
+    bool isEmpty() const { return records == 0; }
+    quint32 recordCount() const { return records; }
+    quint32 lastTimestamp() const { return lastTime; }
+
+    qint64 find(quint32 timestamp) const;
+    QVector<qint64> latestObjects(qint64 offset) const;
+
+    QByteArray save() const;
+    bool load(const QByteArray &data);
+
+    /* A log that carries its own index ends with a trailer giving where the
+     * index starts, which is also where the logged data ends.
+     */
+    static const int TRAILER_SIZE = 16;
+    static QByteArray trailer(qint64 indexOffset);
+    static qint64 trailerOffset(const char *data);
+
+private:
+    static const quint32 INDEX_VERSION = 1;
+    static const quint32 RECORD_INTERVAL = 256;
+    static const quint32 OBJECT_INTERVAL = 10000; // ms
+
+    QVector<Entry> entries;
+    QHash<quint32, QVector<Entry>> objects;
+    quint32 records;
+    quint32 lastTime;
+};
+
+#endif // LOGINDEX_H
+
+/**
+ * @}
+ * @}
+ */
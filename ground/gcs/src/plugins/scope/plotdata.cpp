@@ -149,14 +149,12 @@ double PlotData::valueAsDouble(UAVObject *obj, UAVObjectField *field, bool haveS
                                QString uavSubFieldName)
 {
     Q_UNUSED(obj);
-    QVariant value;
 
     if (haveSubField) {
         int indexOfSubField = field->getElementNames().indexOf(
             QRegExp(uavSubFieldName, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    } else
-        value = field->getValue();
+        return field->getDouble(indexOfSubField);
+    }
 
-    return value.toDouble();
+    return field->getDouble();
 }
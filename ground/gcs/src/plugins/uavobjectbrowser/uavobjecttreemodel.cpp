@@ -197,7 +197,8 @@ void UAVObjectTreeModel::addDataObject(UAVDataObject *obj)
 
 MetaObjectTreeItem *UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeItem *parent)
 {
-    connect(obj, &UAVObject::objectUpdated, this, &UAVObjectTreeModel::highlightUpdatedObject);
+    connect(obj, &UAVObject::objectUpdatedCoalesced, this,
+            &UAVObjectTreeModel::highlightUpdatedObject);
     MetaObjectTreeItem *meta = new MetaObjectTreeItem(obj, tr("Meta Data"));
 
     meta->setHighlightManager(m_highlightManager);
@@ -214,7 +215,8 @@ MetaObjectTreeItem *UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
 
 void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
 {
-    connect(obj, &UAVObject::objectUpdated, this, &UAVObjectTreeModel::highlightUpdatedObject);
+    connect(obj, &UAVObject::objectUpdatedCoalesced, this,
+            &UAVObjectTreeModel::highlightUpdatedObject);
     TreeItem *item;
     DataObjectTreeItem *p = static_cast<DataObjectTreeItem *>(parent);
     if (obj->isSingleInstance()) {
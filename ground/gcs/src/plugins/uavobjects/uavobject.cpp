@@ -51,6 +51,9 @@
 // Macros
 #define SET_BITS(var, shift, value, mask) var = (var & ~(mask << shift)) | (value << shift);
 
+quint64 UAVObject::coalescedUpdatesEmitted = 0;
+quint64 UAVObject::coalescedUpdatesDelivered = 0;
+
 /**
  * Constructor
  * @param objID The object ID
@@ -58,6 +61,8 @@
  * @param name Object name
  */
 UAVObject::UAVObject(quint32 objID, bool isSingleInst, const QString &name)
+    : coalesceTimer(nullptr)
+    , coalesceInterval(0)
 {
     this->objID = objID;
     this->instID = 0;
@@ -182,6 +187,85 @@ void UAVObject::updated()
     emit objectUpdated(this);
 }
 
+/**
+ * Set the shortest time between objectUpdatedCoalesced signals
+ * @param ms Interval in milliseconds, or 0 for once per event loop pass
+ */
+void UAVObject::setCoalescedUpdateInterval(int ms)
+{
+    coalesceInterval = ms;
+
+    if (coalesceTimer)
+        coalesceTimer->setInterval(ms);
+}
+
+/**
+ * Number of objectUpdated signals, over all objects, that had coalesced
+ * subscribers
+ */
+quint64 UAVObject::getCoalescedUpdatesEmitted()
+{
+    return coalescedUpdatesEmitted;
+}
+
+/**
+ * Number of objectUpdatedCoalesced signals sent, over all objects
+ */
+quint64 UAVObject::getCoalescedUpdatesDelivered()
+{
+    return coalescedUpdatesDelivered;
+}
+
+/**
+ * Start following objectUpdated once something subscribes to the
+ * coalesced signal.
+ */
+void UAVObject::connectNotify(const QMetaMethod &signal)
+{
+    if (signal != QMetaMethod::fromSignal(&UAVObject::objectUpdatedCoalesced) || coalesceTimer)
+        return;
+
+    coalesceTimer = new QTimer(this);
+    coalesceTimer->setSingleShot(true);
+    coalesceTimer->setInterval(coalesceInterval);
+    connect(coalesceTimer, &QTimer::timeout, this, &UAVObject::emitCoalescedUpdate);
+    connect(this, &UAVObject::objectUpdated, this, &UAVObject::scheduleCoalescedUpdate);
+}
+
+/**
+ * Stop following objectUpdated when the last coalesced subscriber leaves.
+ */
+void UAVObject::disconnectNotify(const QMetaMethod &signal)
+{
+    Q_UNUSED(signal);
+
+    if (!coalesceTimer
+        || isSignalConnected(QMetaMethod::fromSignal(&UAVObject::objectUpdatedCoalesced)))
+        return;
+
+    // Clear it first, as disconnecting below calls us again
+    QTimer *timer = coalesceTimer;
+    coalesceTimer = nullptr;
+
+    disconnect(this, &UAVObject::objectUpdated, this, &UAVObject::scheduleCoalescedUpdate);
+    timer->deleteLater();
+}
+
+void UAVObject::scheduleCoalescedUpdate()
+{
+    coalescedUpdatesEmitted++;
+
+    if (coalesceTimer && !coalesceTimer->isActive())
+        coalesceTimer->start();
+}
+
+void UAVObject::emitCoalescedUpdate()
+{
+    coalescedUpdatesDelivered++;
+
+    emit objectUpdatedCoalesced(this);
+}
+
 /**
  * Get the number of fields held by this object
  */
@@ -43,6 +43,8 @@
 #include <QString>
 #include <QList>
 #include <QFile>
+#include <QMetaMethod>
+#include <QTimer>
 #include <qglobal.h>
 #include "uavobjects/uavobjectfield.h"
 
@@ -125,8 +127,8 @@ public:
     QString getName();
     QString getDescription();
     quint32 getNumBytes();
-    qint32 pack(quint8 *dataOut);
-    qint32 unpack(const quint8 *dataIn);
+    virtual qint32 pack(quint8 *dataOut);
+    virtual qint32 unpack(const quint8 *dataIn);
     virtual void setMetadata(const Metadata &mdata) = 0;
     virtual Metadata getMetadata() = 0;
     virtual Metadata getDefaultMetadata() = 0;
@@ -141,6 +143,9 @@ public:
     void emitTransactionCompleted(bool success, bool nacked);
     void emitNewInstance(UAVObject *);
     void emitInstanceRemoved(UAVObject *);
+    void setCoalescedUpdateInterval(int ms);
+    static quint64 getCoalescedUpdatesEmitted();
+    static quint64 getCoalescedUpdatesDelivered();
 
     // Metadata accessors
     static void MetadataInitialize(Metadata &meta);
@@ -175,6 +180,18 @@ signals:
      */
     void objectUpdated(UAVObject *obj);
 
+    /**
+     * @brief Coalesced form of objectUpdated, for widgets that only need
+     * the latest data
+     * @param obj
+     *
+     * Sent at most once per event loop pass, or once per interval set with
+     * setCoalescedUpdateInterval(), however many times objectUpdated was
+     * emitted in between.  Nothing extra happens on updates until something
+     * connects to it.
+     */
+    void objectUpdatedCoalesced(UAVObject *obj);
+
     /**
      * @brief objectUpdatedAuto: triggered on "setData" only (Object data updated by changing the
      * data structure)
@@ -240,8 +257,13 @@ signals:
 
 private slots:
     void fieldUpdated(UAVObjectField *field);
+    void scheduleCoalescedUpdate();
+    void emitCoalescedUpdate();
 
 protected:
+    void connectNotify(const QMetaMethod &signal);
+    void disconnectNotify(const QMetaMethod &signal);
+
     quint32 objID;
     quint32 instID;
     bool isSingleInst;
@@ -253,6 +275,15 @@ protected:
     QList<UAVObjectField *> fields;
     void initializeFields(QList<UAVObjectField *> &fields, quint8 *data, quint32 numBytes);
     void setDescription(const QString &description);
+
+private:
+    QTimer *coalesceTimer;
+    int coalesceInterval;
+
+    // Profiling: objectUpdated signals seen while coalescing, and the
+    // coalesced signals actually sent, over all objects
+    static quint64 coalescedUpdatesEmitted;
+    static quint64 coalescedUpdatesDelivered;
 };
 
 #endif // UAVOBJECT_H
@@ -119,7 +119,9 @@ void UAVObjectField::constructorInitialize(const QString &name, const QString &u
         elementSize = sizeof(quint8);
         break;
     }
-    limitsInitialize(limits);
+    // Parsed on first use; most fields' limits are never looked at
+    this->limits = limits;
+    limitsParsed = false;
 
     // store default values, default to zero when not provided
     this->defaultValues = defaultValues;
@@ -131,7 +133,20 @@ void UAVObjectField::constructorInitialize(const QString &name, const QString &u
         enumToIndex.emplace(std::make_pair(indices.at(i), i));
 }
 
-void UAVObjectField::limitsInitialize(const QString &limits)
+/**
+ * Get the limits of each element, parsing them the first time.
+ */
+const QMap<int, QList<UAVObjectField::LimitStruct>> &UAVObjectField::getElementLimits() const
+{
+    if (!limitsParsed) {
+        limitsInitialize();
+        limitsParsed = true;
+    }
+
+    return elementLimits;
+}
+
+void UAVObjectField::limitsInitialize() const
 {
     /// format
     /// (TY)->type (EQ-equal;NE-not equal;BE-between;BI-bigger;SM-smaller)
@@ -227,10 +242,10 @@ void UAVObjectField::limitsInitialize(const QString &limits)
 
 bool UAVObjectField::isWithinLimits(QVariant var, int index, int board) const
 {
-    if (!elementLimits.keys().contains(index))
+    if (!getElementLimits().contains(index))
         return true;
 
-    foreach (const LimitStruct &struc, elementLimits.value(index)) {
+    foreach (const LimitStruct &struc, getElementLimits().value(index)) {
         if ((struc.board != board) && board != 0 && struc.board != 0)
             continue;
         switch (struc.type) {
@@ -449,7 +464,7 @@ bool UAVObjectField::isWithinLimits(QVariant var, int index, int board) const
 
 QVariant UAVObjectField::getMaxLimit(int index, int board) const
 {
-    if (!elementLimits.keys().contains(index)) {
+    if (!getElementLimits().contains(index)) {
         // if nothing explicitly specified, assume max possible value
         switch (type) {
         case INT8:
@@ -474,7 +489,7 @@ QVariant UAVObjectField::getMaxLimit(int index, int board) const
         return QVariant();
     }
 
-    foreach (const LimitStruct &struc, elementLimits.value(index)) {
+    foreach (const LimitStruct &struc, getElementLimits().value(index)) {
         if ((struc.board != board) && board != 0 && struc.board != 0)
             continue;
         switch (struc.type) {
@@ -499,7 +514,7 @@ QVariant UAVObjectField::getMaxLimit(int index, int board) const
 }
 QVariant UAVObjectField::getMinLimit(int index, int board) const
 {
-    if (!elementLimits.keys().contains(index)) {
+    if (!getElementLimits().contains(index)) {
         // if nothing explicitly specified, assume min possible value
         switch (type) {
         case INT8:
@@ -522,7 +537,7 @@ QVariant UAVObjectField::getMinLimit(int index, int board) const
         return QVariant();
     }
 
-    foreach (LimitStruct struc, elementLimits.value(index)) {
+    foreach (LimitStruct struc, getElementLimits().value(index)) {
         if ((struc.board != board) && board != 0 && struc.board != 0)
             return QVariant();
         switch (struc.type) {
@@ -873,15 +888,14 @@ QVariant UAVObjectField::getValue(int index) const
         return QVariant::fromValue(*static_cast<const quint32 *>(d));
     case FLOAT32:
         return QVariant::fromValue(*static_cast<const float *>(d));
-    case ENUM:
-        try {
-            auto i = enumToIndex.at(*static_cast<const quint8 *>(d));
-            return QVariant::fromValue(options[i]);
-        } catch (const std::out_of_range &e) {
-            qWarning() << "Invalid value" << *static_cast<const quint8 *>(d)
-                       << "for ENUM field" << name << ":" << e.what();
-        }
+    case ENUM: {
+        auto i = enumToIndex.find(*static_cast<const quint8 *>(d));
+        if (i != enumToIndex.end())
+            return QVariant::fromValue(options[i->second]);
+        qWarning() << "Invalid value" << *static_cast<const quint8 *>(d) << "for ENUM field"
+                   << name;
         return QVariant::fromValue(QStringLiteral("Bad Value"));
+    }
     case BITFIELD: {
         d = &data[offset + elementSize * static_cast<unsigned>(index / 8)];
         quint8 val = (*static_cast<const quint8 *>(d) >> (index % 8)) & 1;
@@ -1008,7 +1022,55 @@ void UAVObjectField::setValue(const QVariant &value, int index)
 
 double UAVObjectField::getDouble(int index) const
 {
-    return getValue(index).toDouble();
+    // Enums and strings convert from their text, as they always have
+    if (!isNumeric())
+        return getValue(index).toDouble();
+
+    return get<double>(index);
+}
+
+template <typename S>
+void UAVObjectField::copyElements(double *out) const
+{
+    const quint8 *d = &data[offset];
+
+    for (int i = 0; i < numElements; i++, d += sizeof(S))
+        out[i] = *reinterpret_cast<const S *>(d);
+}
+
+int UAVObjectField::copyAsDoubles(double *out) const
+{
+    switch (type) {
+    case INT8:
+        copyElements<qint8>(out);
+        break;
+    case INT16:
+        copyElements<qint16>(out);
+        break;
+    case INT32:
+        copyElements<qint32>(out);
+        break;
+    case UINT8:
+    case ENUM:
+        copyElements<quint8>(out);
+        break;
+    case UINT16:
+        copyElements<quint16>(out);
+        break;
+    case UINT32:
+        copyElements<quint32>(out);
+        break;
+    case FLOAT32:
+        copyElements<float>(out);
+        break;
+    case BITFIELD:
+    case STRING:
+        for (int i = 0; i < numElements; i++)
+            out[i] = get<double>(i);
+        break;
+    }
+
+    return numElements;
 }
 
 void UAVObjectField::setDouble(double value, int index)
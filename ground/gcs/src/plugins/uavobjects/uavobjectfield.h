@@ -99,6 +99,20 @@ public:
     void setValue(const QVariant &data, int index = 0);
     double getDouble(int index = 0) const;
     void setDouble(double value, int index = 0);
+    /**
+     * @brief Read an element without going through QVariant
+     * @param index The element to read
+     * @return The stored value converted to T: the raw value for enums,
+     * 0 or 1 for bitfields, and T() for strings or a bad index
+     */
+    template <typename T>
+    T get(int index = 0) const;
+    /**
+     * @brief Copy every element out as doubles, converted as by get()
+     * @param out Buffer with room for getNumElements() values
+     * @return The number of values written
+     */
+    int copyAsDoubles(double *out) const;
     size_t getNumBytes() const;
     bool isNumeric() const;
     bool isText() const;
@@ -146,7 +160,9 @@ protected:
     size_t offset;
     quint8 *data;
     UAVObject *obj;
-    QMap<int, QList<LimitStruct>> elementLimits;
+    QString limits;
+    mutable bool limitsParsed;
+    mutable QMap<int, QList<LimitStruct>> elementLimits;
     QString description;
     QList<QVariant> defaultValues;
     DisplayType display;
@@ -157,9 +173,48 @@ protected:
                                const QList<int> &indices, const QString &limits,
                                const QString &description, const QList<QVariant> defaultValues,
                                const DisplayType display);
-    void limitsInitialize(const QString &limits);
+    const QMap<int, QList<LimitStruct>> &getElementLimits() const;
+    void limitsInitialize() const;
+
+    template <typename S>
+    void copyElements(double *out) const;
 };
 
+template <typename T>
+T UAVObjectField::get(int index) const
+{
+    if (index < 0 || index >= numElements) {
+        return T();
+    }
+
+    const void *d = &data[offset + elementSize * static_cast<unsigned>(index)];
+
+    switch (type) {
+    case INT8:
+        return static_cast<T>(*static_cast<const qint8 *>(d));
+    case INT16:
+        return static_cast<T>(*static_cast<const qint16 *>(d));
+    case INT32:
+        return static_cast<T>(*static_cast<const qint32 *>(d));
+    case UINT8:
+    case ENUM:
+        return static_cast<T>(*static_cast<const quint8 *>(d));
+    case UINT16:
+        return static_cast<T>(*static_cast<const quint16 *>(d));
+    case UINT32:
+        return static_cast<T>(*static_cast<const quint32 *>(d));
+    case FLOAT32:
+        return static_cast<T>(*static_cast<const float *>(d));
+    case BITFIELD:
+        d = &data[offset + elementSize * static_cast<unsigned>(index / 8)];
+        return static_cast<T>((*static_cast<const quint8 *>(d) >> (index % 8)) & 1);
+    case STRING:
+        break;
+    }
+
+    return T();
+}
+
 #endif // UAVOBJECTFIELD_H
 
 /**
@@ -38,7 +38,9 @@
  * Constructor
  */
 UAVObjectManager::UAVObjectManager()
+    : idTableBits(0)
 {
+    resizeIdTable(MIN_ID_TABLE_BITS);
 }
 
 UAVObjectManager::~UAVObjectManager()
@@ -57,45 +59,9 @@ bool UAVObjectManager::registerObject(UAVDataObject *obj)
 {
     // Check if this object type is already in the list
     quint32 objID = obj->getObjID();
-    if (objects.contains(objID)) // Known object ID
-    {
-        if (objects.value(objID).contains(obj->getInstID())) // Instance already present
-            return false;
-        if (obj->isSingleInstance())
-            return false;
-        if (obj->getInstID() >= MAX_INSTANCES)
-            return false;
-        UAVDataObject *refObj = dynamic_cast<UAVDataObject *>(objects.value(objID).first());
-        if (refObj == NULL) {
-            return false;
-        }
-        UAVMetaObject *mobj = refObj->getMetaObject();
-        if (objects.value(objID).last()->getInstID() < obj->getInstID()) // Space between last
-                                                                         // existent instance and
-                                                                         // new one, lets fill the
-                                                                         // gaps
-        {
-            for (quint32 instidx = objects.value(objID).last()->getInstID() + 1;
-                 instidx < obj->getInstID(); ++instidx) {
-                UAVDataObject *cobj = obj->clone(instidx);
-                cobj->initialize(instidx, mobj);
-                QMap<quint32, UAVObject *> ppp;
-                ppp.insert(instidx, cobj);
-                objects[objID].insert(instidx, cobj);
-                getObject(cobj->getObjID())->emitNewInstance(cobj); // TODO??
-                emit newInstance(cobj);
-            }
-        } else if (obj->getInstID() == 0)
-            obj->initialize(objects.value(objID).last()->getObjID() + 1, mobj);
-        else {
-            return false;
-        }
-        // Add the actual object instance in the list
-        objects[objID].insert(obj->getInstID(), obj);
-        getObject(objID)->emitNewInstance(obj);
-        emit newInstance(obj);
-        return true;
-    } else {
+    int index = findObject(objID);
+
+    if (index < 0) {
         // If this point is reached then this is the first time this object type (ID) is added in
         // the list
         // create a new list of the instances, add in the object collection and create the object's
@@ -111,6 +77,46 @@ bool UAVObjectManager::registerObject(UAVDataObject *obj)
         addObject(mobj);
         return true;
     }
+
+    quint32 numInstances = objects.at(index).size();
+    quint32 instId = obj->getInstID();
+
+    if (obj->isSingleInstance())
+        return false;
+    if (numInstances == 0)
+        return false;
+
+    UAVDataObject *refObj = dynamic_cast<UAVDataObject *>(objects.at(index).first());
+    if (refObj == NULL) {
+        return false;
+    }
+    UAVMetaObject *mobj = refObj->getMetaObject();
+
+    // A new instance 0 of a known object is given the next free instance ID
+    if (instId == 0) {
+        instId = numInstances;
+        obj->initialize(instId, mobj);
+    }
+
+    if (instId < numInstances) // Instance already present
+        return false;
+    if (instId >= MAX_INSTANCES)
+        return false;
+
+    // Space between last existent instance and new one, lets fill the gaps
+    for (quint32 instidx = numInstances; instidx < instId; ++instidx) {
+        UAVDataObject *cobj = obj->clone(instidx);
+        cobj->initialize(instidx, mobj);
+        objects[index].append(cobj);
+        refObj->emitNewInstance(cobj); // TODO??
+        emit newInstance(cobj);
+    }
+
+    // Add the actual object instance in the list
+    objects[index].append(obj);
+    refObj->emitNewInstance(obj);
+    emit newInstance(obj);
+    return true;
 }
 
 /**
@@ -121,89 +127,158 @@ bool UAVObjectManager::registerObject(UAVDataObject *obj)
  */
 bool UAVObjectManager::unRegisterObject(UAVDataObject *obj)
 {
-    // Check if this object type is already in the list
-    quint32 objID = obj->getObjID();
     if (obj->isSingleInstance())
         return false;
-    quint32 instances = (quint32)objects.value(obj->getObjID()).count();
-    for (quint32 x = obj->getInstID(); x < instances; ++x) {
-        getObject(objects.value(objID).value(x)->getObjID())
-            ->emitInstanceRemoved(objects.value(objID).value(x));
-        emit instanceRemoved(objects.value(objID).value(x));
-        objects[objID].remove(x);
+
+    int index = findObject(obj->getObjID());
+    if (index < 0)
+        return true;
+
+    QVector<UAVObject *> &instances = objects[index];
+    int first = obj->getInstID();
+
+    for (int x = first; x < instances.size(); ++x) {
+        instances.first()->emitInstanceRemoved(instances.at(x));
+        emit instanceRemoved(instances.at(x));
     }
+
+    if (first < instances.size())
+        instances.resize(first);
+
     return true;
 }
 
 void UAVObjectManager::addObject(UAVObject *obj)
 {
     // Add to list
-    QMap<quint32, UAVObject *> list;
-    list.insert(obj->getInstID(), obj);
-    objects.insert(obj->getObjID(), list);
+    int index = objects.size();
 
-    objectsByName.insert(obj->getName(), list);
+    objects.append(QVector<UAVObject *>() << obj);
+    insertId(obj->getObjID(), index);
+    objectsByName.insert(obj->getName(), index);
 
     emit newObject(obj);
 }
 
 /**
- * Get all objects. A two dimentional QVector is returned. Objects are grouped by
- * instances of the same object type.
+ * Find where the instances of an object are kept.
+ * @returns The index in objects, or -1 if the object isn't registered
  */
-QVector<QVector<UAVObject *>> UAVObjectManager::getObjectsVector()
+int UAVObjectManager::findObject(quint32 objId) const
 {
-    QVector<QVector<UAVObject *>> vector;
-    foreach (const ObjectMap &map, objects.values()) {
-        QVector<UAVObject *> vec = map.values().toVector();
-        vector.append(vec);
+    // Fibonacci hashing spreads out the consecutive IDs of data and metaobjects
+    quint32 mask = (1u << idTableBits) - 1;
+    quint32 pos = (objId * 2654435769u) >> (32 - idTableBits);
+
+    forever {
+        const IdSlot &slot = idTable.at(pos);
+
+        if (slot.index < 0 || slot.objId == objId)
+            return slot.index;
+
+        pos = (pos + 1) & mask;
     }
-    return vector;
 }
 
-QHash<quint32, QMap<quint32, UAVObject *>> UAVObjectManager::getObjects()
+int UAVObjectManager::findObject(const QString &name) const
+{
+    return objectsByName.value(name, -1);
+}
+
+void UAVObjectManager::insertId(quint32 objId, int index)
+{
+    if ((objects.size() * 2) > idTable.size())
+        resizeIdTable(idTableBits + 1);
+
+    placeId(objId, index);
+}
+
+void UAVObjectManager::placeId(quint32 objId, int index)
+{
+    quint32 mask = (1u << idTableBits) - 1;
+    quint32 pos = (objId * 2654435769u) >> (32 - idTableBits);
+
+    while (idTable.at(pos).index >= 0)
+        pos = (pos + 1) & mask;
+
+    idTable[pos].objId = objId;
+    idTable[pos].index = index;
+}
+
+void UAVObjectManager::resizeIdTable(int bits)
+{
+    IdSlot empty = { 0, -1 };
+    QVector<IdSlot> old(1 << bits, empty);
+
+    idTable.swap(old);
+    idTableBits = bits;
+
+    for (const IdSlot &slot : old) {
+        if (slot.index >= 0)
+            placeId(slot.objId, slot.index);
+    }
+}
+
+/**
+ * Get all objects, grouped by instances of the same object type, without
+ * copying them.  The reference is only valid until objects are registered
+ * or unregistered; a group may be empty if all its instances were
+ * unregistered.
+ */
+const QVector<QVector<UAVObject *>> &UAVObjectManager::getObjectsView() const
 {
     return objects;
 }
 
 /**
- * Same as getObjects() but will only return DataObjects.
+ * Get all objects. A two dimentional QVector is returned. Objects are grouped by
+ * instances of the same object type.
+ */
+QVector<QVector<UAVObject *>> UAVObjectManager::getObjectsVector()
+{
+    return objects;
+}
+
+/**
+ * Same as getObjectsVector() but will only return DataObjects.
  */
 QVector<QVector<UAVDataObject *>> UAVObjectManager::getDataObjectsVector()
 {
     QVector<QVector<UAVDataObject *>> vector;
-    foreach (const ObjectMap &map, objects.values()) {
-        UAVDataObject *obj = dynamic_cast<UAVDataObject *>(map.first());
-        if (obj != NULL) {
-            QVector<UAVDataObject *> vec;
-            foreach (UAVObject *o, map) {
-                UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(o);
-                if (dobj)
-                    vec.append(dobj);
-            }
-            vector.append(vec);
+    for (const QVector<UAVObject *> &instances : objects) {
+        if (instances.isEmpty() || !dynamic_cast<UAVDataObject *>(instances.first()))
+            continue;
+
+        QVector<UAVDataObject *> vec;
+        vec.reserve(instances.size());
+        for (UAVObject *o : instances) {
+            UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(o);
+            if (dobj)
+                vec.append(dobj);
         }
+        vector.append(vec);
     }
     return vector;
 }
 
 /**
- * Same as getObjects() but will only return MetaObjects.
+ * Same as getObjectsVector() but will only return MetaObjects.
  */
 QVector<QVector<UAVMetaObject *>> UAVObjectManager::getMetaObjectsVector()
 {
     QVector<QVector<UAVMetaObject *>> vector;
-    foreach (const ObjectMap &map, objects.values()) {
-        UAVMetaObject *obj = dynamic_cast<UAVMetaObject *>(map.first());
-        if (obj != NULL) {
-            QVector<UAVMetaObject *> vec;
-            foreach (UAVObject *o, map) {
-                UAVMetaObject *mobj = dynamic_cast<UAVMetaObject *>(o);
-                if (mobj)
-                    vec.append(mobj);
-            }
-            vector.append(vec);
+    for (const QVector<UAVObject *> &instances : objects) {
+        if (instances.isEmpty() || !dynamic_cast<UAVMetaObject *>(instances.first()))
+            continue;
+
+        QVector<UAVMetaObject *> vec;
+        vec.reserve(instances.size());
+        for (UAVObject *o : instances) {
+            UAVMetaObject *mobj = dynamic_cast<UAVMetaObject *>(o);
+            if (mobj)
+                vec.append(mobj);
         }
+        vector.append(vec);
     }
     return vector;
 }
@@ -214,7 +289,12 @@ QVector<QVector<UAVMetaObject *>> UAVObjectManager::getMetaObjectsVector()
  */
 UAVObject *UAVObjectManager::getObject(const QString &name, quint32 instId)
 {
-    return getObject(name, 0, instId);
+    int index = findObject(name);
+
+    if (index < 0 || instId >= static_cast<quint32>(objects.at(index).size()))
+        return NULL;
+
+    return objects.at(index).at(instId);
 }
 
 /**
@@ -223,54 +303,61 @@ UAVObject *UAVObjectManager::getObject(const QString &name, quint32 instId)
  */
 UAVObject *UAVObjectManager::getObject(quint32 objId, quint32 instId)
 {
-    return getObject(NULL, objId, instId);
+    int index = findObject(objId);
+
+    if (index < 0 || instId >= static_cast<quint32>(objects.at(index).size()))
+        return NULL;
+
+    return objects.at(index).at(instId);
 }
 
 /**
- * Helper function for the public getObject() functions.
+ * Get all the instances of the object specified by name, without copying
+ * them.
  */
-UAVObject *UAVObjectManager::getObject(const QString &name, quint32 objId, quint32 instId)
+UAVObjectManager::InstancesView
+UAVObjectManager::getObjectInstancesView(const QString &name) const
 {
-    if (name != NULL) {
-        if (objectsByName.contains(name)) {
-            return objectsByName.value(name).value(instId);
-        }
+    int index = findObject(name);
 
-        return NULL;
-    } else if (objects.contains(objId))
-        return objects.value(objId).value(instId);
-    return NULL;
+    if (index < 0)
+        return InstancesView();
+
+    return InstancesView(objects.at(index).constData(), objects.at(index).size());
 }
 
 /**
- * Get all the instances of the object specified by name
+ * Get all the instances of the object specified by its ID, without copying
+ * them.
  */
-QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(const QString &name)
+UAVObjectManager::InstancesView UAVObjectManager::getObjectInstancesView(quint32 objId) const
 {
-    return getObjectInstancesVector(&name, 0);
+    int index = findObject(objId);
+
+    if (index < 0)
+        return InstancesView();
+
+    return InstancesView(objects.at(index).constData(), objects.at(index).size());
 }
 
 /**
- * Get all the instances of the object specified by its ID
+ * Get all the instances of the object specified by name
  */
-QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(quint32 objId)
+QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(const QString &name)
 {
-    return getObjectInstancesVector(NULL, objId);
+    int index = findObject(name);
+
+    return index < 0 ? QVector<UAVObject *>() : objects.at(index);
 }
 
 /**
- * Helper function for the public getObjectInstances()
+ * Get all the instances of the object specified by its ID
  */
-QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(const QString *name, quint32 objId)
+QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(quint32 objId)
 {
-    if (name != NULL) {
-        foreach (const ObjectMap &map, objects) {
-            if (map.first()->getName().compare(name) == 0)
-                return map.values().toVector();
-        }
-    } else if (objects.contains(objId))
-        return objects.value(objId).values().toVector();
-    return QVector<UAVObject *>();
+    int index = findObject(objId);
+
+    return index < 0 ? QVector<UAVObject *>() : objects.at(index);
 }
 
 /**
@@ -278,7 +365,9 @@ QVector<UAVObject *> UAVObjectManager::getObjectInstancesVector(const QString *n
  */
 qint32 UAVObjectManager::getNumInstances(const QString &name)
 {
-    return getNumInstances(&name, 0);
+    int index = findObject(name);
+
+    return index < 0 ? -1 : objects.at(index).size();
 }
 
 /**
@@ -286,22 +375,9 @@ qint32 UAVObjectManager::getNumInstances(const QString &name)
  */
 qint32 UAVObjectManager::getNumInstances(quint32 objId)
 {
-    return getNumInstances(NULL, objId);
-}
+    int index = findObject(objId);
 
-/**
- * Helper function for public getNumInstances
- */
-qint32 UAVObjectManager::getNumInstances(const QString *name, quint32 objId)
-{
-    if (name != NULL) {
-        foreach (const ObjectMap &map, objects) {
-            if (map.first()->getName().compare(name) == 0)
-                return map.count();
-        }
-    } else if (objects.contains(objId))
-        return objects.value(objId).count();
-    return -1;
+    return index < 0 ? -1 : objects.at(index).size();
 }
 
 UAVObjectField *UAVObjectManager::getField(const QString &objName, const QString &fieldName,
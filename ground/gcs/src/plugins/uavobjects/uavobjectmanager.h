@@ -48,12 +48,42 @@ class UAVOBJECTS_EXPORT UAVObjectManager : public QObject
     Q_OBJECT
 
 public:
+    /**
+     * The instances of one object type, indexed by instance ID, without
+     * copying them out of the manager.  Only valid until instances of that
+     * object are registered or unregistered.
+     */
+    class InstancesView
+    {
+    public:
+        InstancesView()
+            : objs(nullptr)
+            , count(0)
+        {
+        }
+        InstancesView(UAVObject *const *objs, int count)
+            : objs(objs)
+            , count(count)
+        {
+        }
+
+        UAVObject *const *begin() const { return objs; }
+        UAVObject *const *end() const { return objs + count; }
+        int size() const { return count; }
+        bool isEmpty() const { return count == 0; }
+        UAVObject *operator[](int i) const { return objs[i]; }
+        UAVObject *first() const { return objs[0]; }
+
+    private:
+        UAVObject *const *objs;
+        int count;
+    };
+
     UAVObjectManager();
     ~UAVObjectManager();
-    typedef QMap<quint32, UAVObject *> ObjectMap;
     bool registerObject(UAVDataObject *obj);
+    const QVector<QVector<UAVObject *>> &getObjectsView() const;
     QVector<QVector<UAVObject *>> getObjectsVector();
-    QHash<quint32, QMap<quint32, UAVObject *>> getObjects();
     QVector<QVector<UAVDataObject *>> getDataObjectsVector();
     QVector<QVector<UAVMetaObject *>> getMetaObjectsVector();
     UAVObject *getObject(const QString &name, quint32 instId = 0);
@@ -67,6 +97,8 @@ public:
      * @return The field if successful, null pointer otherwise
      */
     UAVObjectField *getField(const QString &objName, const QString &fieldName, quint32 instId = 0);
+    InstancesView getObjectInstancesView(const QString &name) const;
+    InstancesView getObjectInstancesView(quint32 objId) const;
     QVector<UAVObject *> getObjectInstancesVector(const QString &name);
     QVector<UAVObject *> getObjectInstancesVector(quint32 objId);
     qint32 getNumInstances(const QString &name);
@@ -79,13 +111,33 @@ signals:
 
 private:
     static const quint32 MAX_INSTANCES = 1000;
-    QHash<quint32, QMap<quint32, UAVObject *>> objects;
-    QHash<QString, QMap<quint32, UAVObject *>> objectsByName;
+    static const int MIN_ID_TABLE_BITS = 8;
+
+    struct IdSlot
+    {
+        quint32 objId;
+        int index; // Into objects, or -1 if the slot is free
+    };
+
+    /* Instances of each object type, indexed by instance ID; object types
+     * are never removed, so indices stay valid.
+     */
+    QVector<QVector<UAVObject *>> objects;
+
+    /* Open addressed, linearly probed map from object ID to index in
+     * objects.  Kept at most half full.
+     */
+    QVector<IdSlot> idTable;
+    int idTableBits;
+
+    QHash<QString, int> objectsByName;
 
     void addObject(UAVObject *obj);
-    UAVObject *getObject(const QString &name, quint32 objId, quint32 instId);
-    QVector<UAVObject *> getObjectInstancesVector(const QString *name, quint32 objId);
-    qint32 getNumInstances(const QString *name, quint32 objId);
+    int findObject(quint32 objId) const;
+    int findObject(const QString &name) const;
+    void insertId(quint32 objId, int index);
+    void placeId(quint32 objId, int index);
+    void resizeIdTable(int bits);
 };
 
 #endif // UAVOBJECTMANAGER_H
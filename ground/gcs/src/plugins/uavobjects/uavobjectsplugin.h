@@ -49,6 +49,19 @@ public:
 private Q_SLOTS:
     void testEnumFields();
     void testIntFields();
+    void testObjectRegistry();
+    void testRegisterNewInstance();
+    void benchmarkGetObject();
+    void benchmarkGetObjectInstances();
+    void testTypedFieldAccess();
+    void benchmarkFieldGetValue();
+    void benchmarkFieldGet();
+    void benchmarkFieldCopyAsDoubles();
+    void testGeneratedPack();
+    void benchmarkObjectUnpackGeneric();
+    void benchmarkObjectUnpack();
+    void testCoalescedUpdates();
+    void testFieldLimits();
 #endif
 };
 
@@ -31,6 +31,8 @@
 
 #include "uavdataobject.h"
 #include "uavobjectfield.h"
+#include "uavobjectmanager.h"
+#include <extensionsystem/pluginmanager.h>
 
 #include <QTest>
 #include <memory>
@@ -64,6 +66,310 @@ void UAVObjectsPlugin::testIntFields()
     QVERIFY(field->isDefaultValue(1));
 }
 
+void UAVObjectsPlugin::testObjectRegistry()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QVERIFY(objMngr);
+    QVERIFY(!objMngr->getObjectsView().isEmpty());
+
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        QVERIFY(!instances.isEmpty());
+
+        UAVObject *obj = instances.first();
+        UAVObjectManager::InstancesView view = objMngr->getObjectInstancesView(obj->getObjID());
+
+        QCOMPARE(view.size(), instances.size());
+        QCOMPARE(objMngr->getNumInstances(obj->getObjID()), instances.size());
+        QCOMPARE(objMngr->getObjectInstancesView(obj->getName()).size(), instances.size());
+
+        for (int i = 0; i < instances.size(); i++) {
+            QCOMPARE(view[i], instances[i]);
+            QCOMPARE(objMngr->getObject(obj->getObjID(), i), instances[i]);
+            QCOMPARE(objMngr->getObject(obj->getName(), i), instances[i]);
+        }
+
+        QVERIFY(!objMngr->getObject(obj->getObjID(), instances.size()));
+    }
+
+    QVERIFY(!objMngr->getObject(0x12345678));
+    QVERIFY(objMngr->getObjectInstancesView(QStringLiteral("NoSuchObject")).isEmpty());
+    QCOMPARE(objMngr->getNumInstances(QStringLiteral("NoSuchObject")), -1);
+}
+
+void UAVObjectsPlugin::testRegisterNewInstance()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QVERIFY(objMngr);
+
+    UAVDataObject *proto = nullptr;
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        proto = dynamic_cast<UAVDataObject *>(instances.first());
+        if (proto && !proto->isSingleInstance())
+            break;
+        proto = nullptr;
+    }
+    QVERIFY(proto);
+
+    UAVObjectManager registry;
+    std::unique_ptr<UAVDataObject> first(proto->dirtyClone());
+    std::unique_ptr<UAVDataObject> second(proto->dirtyClone());
+
+    QVERIFY(registry.registerObject(first.get()));
+
+    // Registering instance 0 again takes the next free instance ID
+    QVERIFY(registry.registerObject(second.get()));
+    QCOMPARE(second->getInstID(), 1u);
+    QCOMPARE(registry.getNumInstances(proto->getObjID()), 2);
+    QCOMPARE(registry.getObject(proto->getObjID(), 1), static_cast<UAVObject *>(second.get()));
+
+    delete first->getMetaObject();
+}
+
+void UAVObjectsPlugin::benchmarkGetObject()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QVERIFY(objMngr);
+
+    QVector<quint32> ids;
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView())
+        ids.append(instances.first()->getObjID());
+
+    UAVObject *found = nullptr;
+
+    QBENCHMARK {
+        for (quint32 id : ids)
+            found = objMngr->getObject(id);
+    }
+
+    QVERIFY(found);
+}
+
+void UAVObjectsPlugin::benchmarkGetObjectInstances()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QVERIFY(objMngr);
+
+    QVector<quint32> ids;
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView())
+        ids.append(instances.first()->getObjID());
+
+    int count = 0;
+
+    QBENCHMARK {
+        for (quint32 id : ids) {
+            for (UAVObject *obj : objMngr->getObjectInstancesView(id))
+                count += obj != nullptr;
+        }
+    }
+
+    QVERIFY(count > 0);
+}
+
+void UAVObjectsPlugin::testTypedFieldAccess()
+{
+    std::unique_ptr<UAVObjectField> field(new UAVObjectField("TestInt16", "photons", UAVObjectField::INT16, 3, {},
+                                    {}, QString(), QStringLiteral("Test some stuff")));
+    std::unique_ptr<UAVObjectField> bits(new UAVObjectField("TestBits", "photons", UAVObjectField::BITFIELD, 8, {},
+                                    {}, QString(), QStringLiteral("Test some stuff")));
+    qint16 testData[3] = { -300, 0, 1200 };
+    quint8 testBits[1] = { 0x05 };
+    double out[8];
+
+    field->initialize(reinterpret_cast<quint8 *>(testData), 0, nullptr);
+    QCOMPARE(field->get<int>(0), -300);
+    QCOMPARE(field->get<double>(2), 1200.0);
+    QCOMPARE(field->get<int>(3), 0);
+    QCOMPARE(field->getDouble(0), field->getValue(0).toDouble());
+    QCOMPARE(field->copyAsDoubles(out), 3);
+    QCOMPARE(out[0], -300.0);
+    QCOMPARE(out[1], 0.0);
+    QCOMPARE(out[2], 1200.0);
+
+    bits->initialize(testBits, 0, nullptr);
+    QCOMPARE(bits->copyAsDoubles(out), 8);
+    QCOMPARE(out[0], 1.0);
+    QCOMPARE(out[1], 0.0);
+    QCOMPARE(out[2], 1.0);
+    QCOMPARE(bits->get<int>(7), 0);
+}
+
+/* The field benchmarks read the same 16 element float array three ways, to
+ * compare the per-sample cost of each.
+ */
+static const int BENCHMARK_ELEMENTS = 16;
+
+static UAVObjectField *benchmarkField(float *data)
+{
+    UAVObjectField *field = new UAVObjectField("TestFloat", "photons", UAVObjectField::FLOAT32,
+                                               BENCHMARK_ELEMENTS, {}, {});
+
+    for (int i = 0; i < BENCHMARK_ELEMENTS; i++)
+        data[i] = i * 0.5f;
+
+    field->initialize(reinterpret_cast<quint8 *>(data), 0, nullptr);
+
+    return field;
+}
+
+void UAVObjectsPlugin::benchmarkFieldGetValue()
+{
+    float data[BENCHMARK_ELEMENTS];
+    std::unique_ptr<UAVObjectField> field(benchmarkField(data));
+    double sum = 0;
+
+    QBENCHMARK {
+        for (int i = 0; i < BENCHMARK_ELEMENTS; i++)
+            sum += field->getValue(i).toDouble();
+    }
+
+    QVERIFY(sum > 0);
+}
+
+void UAVObjectsPlugin::benchmarkFieldGet()
+{
+    float data[BENCHMARK_ELEMENTS];
+    std::unique_ptr<UAVObjectField> field(benchmarkField(data));
+    double sum = 0;
+
+    QBENCHMARK {
+        for (int i = 0; i < BENCHMARK_ELEMENTS; i++)
+            sum += field->get<double>(i);
+    }
+
+    QVERIFY(sum > 0);
+}
+
+void UAVObjectsPlugin::benchmarkFieldCopyAsDoubles()
+{
+    float data[BENCHMARK_ELEMENTS];
+    std::unique_ptr<UAVObjectField> field(benchmarkField(data));
+    double out[BENCHMARK_ELEMENTS];
+    double sum = 0;
+
+    QBENCHMARK {
+        field->copyAsDoubles(out);
+        sum += out[BENCHMARK_ELEMENTS - 1];
+    }
+
+    QVERIFY(sum > 0);
+}
+
+void UAVObjectsPlugin::testGeneratedPack()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    QVERIFY(objMngr);
+
+    for (const QVector<UAVDataObject *> &instances : objMngr->getDataObjectsVector()) {
+        UAVDataObject *obj = instances.first();
+        QByteArray in(obj->getNumBytes(), 0);
+        QByteArray fast(obj->getNumBytes(), 0);
+        QByteArray generic(obj->getNumBytes(), 0);
+
+        for (int i = 0; i < in.size(); i++)
+            in[i] = static_cast<char>(i * 7 + 3);
+
+        std::unique_ptr<UAVDataObject> copy(obj->dirtyClone());
+
+        copy->unpack(reinterpret_cast<const quint8 *>(in.constData()));
+        copy->pack(reinterpret_cast<quint8 *>(fast.data()));
+        copy->UAVObject::pack(reinterpret_cast<quint8 *>(generic.data()));
+        QCOMPARE(fast, in);
+        QCOMPARE(generic, in);
+
+        copy->UAVObject::unpack(reinterpret_cast<const quint8 *>(in.constData()));
+        copy->pack(reinterpret_cast<quint8 *>(fast.data()));
+        QCOMPARE(fast, in);
+    }
+}
+
+/* The unpack benchmarks decode into the largest object, once through the
+ * field by field path and once through the generated one.
+ */
+static UAVDataObject *largestObject()
+{
+    UAVObjectManager *objMngr =
+        ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+    UAVDataObject *largest = nullptr;
+
+    for (const QVector<UAVDataObject *> &instances : objMngr->getDataObjectsVector()) {
+        if (!largest || instances.first()->getNumBytes() > largest->getNumBytes())
+            largest = instances.first();
+    }
+
+    return largest->dirtyClone();
+}
+
+void UAVObjectsPlugin::benchmarkObjectUnpackGeneric()
+{
+    std::unique_ptr<UAVDataObject> obj(largestObject());
+    QByteArray in(obj->getNumBytes(), 1);
+
+    QBENCHMARK {
+        obj->UAVObject::unpack(reinterpret_cast<const quint8 *>(in.constData()));
+    }
+}
+
+void UAVObjectsPlugin::benchmarkObjectUnpack()
+{
+    std::unique_ptr<UAVDataObject> obj(largestObject());
+    QByteArray in(obj->getNumBytes(), 1);
+
+    QBENCHMARK {
+        obj->unpack(reinterpret_cast<const quint8 *>(in.constData()));
+    }
+}
+
+void UAVObjectsPlugin::testCoalescedUpdates()
+{
+    std::unique_ptr<UAVDataObject> obj(largestObject());
+    int delivered = 0;
+
+    // Not following updates until someone subscribes
+    quint64 emittedBefore = UAVObject::getCoalescedUpdatesEmitted();
+    obj->updated();
+    QCOMPARE(UAVObject::getCoalescedUpdatesEmitted(), emittedBefore);
+
+    auto conn = connect(obj.get(), &UAVObject::objectUpdatedCoalesced,
+                        [&delivered](UAVObject *) { delivered++; });
+
+    emittedBefore = UAVObject::getCoalescedUpdatesEmitted();
+    quint64 deliveredBefore = UAVObject::getCoalescedUpdatesDelivered();
+
+    for (int i = 0; i < 10; i++)
+        obj->updated();
+
+    QCOMPARE(delivered, 0);
+    QTRY_COMPARE(delivered, 1);
+    QCOMPARE(UAVObject::getCoalescedUpdatesEmitted() - emittedBefore, 10ull);
+    QCOMPARE(UAVObject::getCoalescedUpdatesDelivered() - deliveredBefore, 1ull);
+
+    disconnect(conn);
+    emittedBefore = UAVObject::getCoalescedUpdatesEmitted();
+    obj->updated();
+    QCOMPARE(UAVObject::getCoalescedUpdatesEmitted(), emittedBefore);
+}
+
+void UAVObjectsPlugin::testFieldLimits()
+{
+    std::unique_ptr<UAVObjectField> field(new UAVObjectField("TestLimits", "photons", UAVObjectField::FLOAT32, 3, {},
+                                    {}, QStringLiteral("%BI:3,%BE:2.3:5"), QStringLiteral("Test some stuff")));
+    float testData[3] = {};
+
+    field->initialize(reinterpret_cast<quint8 *>(testData), 0, nullptr);
+    QVERIFY(field->isWithinLimits(4.0f, 0));
+    QVERIFY(!field->isWithinLimits(2.0f, 0));
+    QVERIFY(field->isWithinLimits(2.5f, 1));
+    QVERIFY(!field->isWithinLimits(5.5f, 1));
+    QVERIFY(field->isWithinLimits(-100.0f, 2));
+    QCOMPARE(field->getMinLimit(1).toFloat(), 2.3f);
+    QCOMPARE(field->getMaxLimit(1).toFloat(), 5.0f);
+}
+
 /**
  * @}
  * @}
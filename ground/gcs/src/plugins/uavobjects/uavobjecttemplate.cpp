@@ -37,12 +37,13 @@
 
 #include "$(NAMELC).h"
 #include "uavobjects/uavobjectfield.h"
+#include <cstddef>
+#include <cstring>
 
 const QString $(NAME)::NAME = QString("$(NAME)");
 const QString $(NAME)::DESCRIPTION = QString("$(DESCRIPTION)");
-const QHash<QString, QString> $(NAME)::FIELD_DESCRIPTIONS{
-$(FIELDDESCRIPTIONS_STRINGS)};
 
+$(DATAFIELDOFFSETCHECKS)
 /**
  * Constructor
  */
@@ -113,6 +114,37 @@ void $(NAME)::setData(const DataFields& data)
     }
 }
 
+/**
+ * Pack the object data into a byte array.  The data fields are laid out
+ * as on the wire, so on little endian hosts this is a single copy.
+ * \return The number of bytes copied
+ */
+qint32 $(NAME)::pack(quint8 *dataOut)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(dataOut, &data, NUMBYTES);
+    return NUMBYTES;
+#else
+    return UAVDataObject::pack(dataOut);
+#endif
+}
+
+/**
+ * Unpack the object data from a byte array.
+ * \return The number of bytes copied
+ */
+qint32 $(NAME)::unpack(const quint8 *dataIn)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(&data, dataIn, NUMBYTES);
+    emit objectUnpacked(this); // trigger object updated event
+    emit objectUpdated(this);
+    return NUMBYTES;
+#else
+    return UAVDataObject::unpack(dataIn);
+#endif
+}
+
 void $(NAME)::emitNotifications()
 {
     $(NOTIFY_PROPERTIES_CHANGED)
@@ -69,13 +69,14 @@ $(DATAFIELDINFO)
     static const bool ISSINGLEINST = $(ISSINGLEINST);
     static const bool ISSETTINGS = $(ISSETTINGS);
     static const quint32 NUMBYTES = $(NUMBYTES);
-    static const QHash<QString, QString> FIELD_DESCRIPTIONS;
 
     // Functions
     $(NAME)();
 
     DataFields getData();
     void setData(const DataFields& data);
+    qint32 pack(quint8 *dataOut);
+    qint32 unpack(const quint8 *dataIn);
     Metadata getDefaultMetadata();
     UAVDataObject* clone(quint32 instID);
     UAVDataObject* dirtyClone();
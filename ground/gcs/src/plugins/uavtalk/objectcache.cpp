@@ -0,0 +1,252 @@
+/**
+ ******************************************************************************
+ *
+ * @file       objectcache.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Snapshot of a board's settings, kept between connections
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "objectcache.h"
+#include "firmwareiapobj.h"
+#include "utils/pathutils.h"
+#include <coreplugin/coreconstants.h>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+ObjectCache::ObjectCache(UAVObjectManager *objMngr)
+    : objMngr(objMngr)
+{
+}
+
+/**
+ * Identify the connected board and the object definitions it was built
+ * with.
+ * \return the key, or an empty string if the board isn't known yet
+ */
+QString ObjectCache::boardKey(UAVObjectManager *objMngr)
+{
+    FirmwareIAPObj *iapObj = FirmwareIAPObj::GetInstance(objMngr);
+
+    if (!iapObj || !iapObj->getIsPresentOnHardware()) {
+        return QString();
+    }
+
+    FirmwareIAPObj::DataFields iap = iapObj->getData();
+    QByteArray serial;
+
+    for (unsigned int i = 0; i < FirmwareIAPObj::CPUSERIAL_NUMELEM; i++)
+        serial.append(iap.CPUSerial[i]);
+
+    // See LogFile for the format of UAVOSHA1_STR
+    QString uavoHash = QString::fromLatin1(Core::Constants::UAVOSHA1_STR)
+                           .replace("\"{ ", "")
+                           .replace(" }\"", "")
+                           .replace(",", "")
+                           .replace("0x", "");
+
+    return QString("%1-%2-%3")
+        .arg(QString::fromLatin1(serial.toHex()))
+        .arg(iap.crc, 8, 16, QChar('0'))
+        .arg(uavoHash);
+}
+
+/**
+ * CRC32 as computed by the firmware: polynomial 0x04C11DB7, most
+ * significant bit first, no reflection or final XOR.
+ */
+quint32 ObjectCache::checksum(const QByteArray &data)
+{
+    quint32 crc = 0;
+
+    for (int i = 0; i < data.size(); i++) {
+        crc ^= static_cast<quint32>(static_cast<quint8>(data[i])) << 24;
+
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+QString ObjectCache::fileName(const QString &key)
+{
+    return Utils::PathUtils().GetStoragePath() + "objectcache" + QDir::separator() + key
+        + ".dat";
+}
+
+/**
+ * Read the snapshot saved for a board.
+ * \return true if there was one
+ */
+bool ObjectCache::load(const QString &key)
+{
+    entries.clear();
+
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    QFile file(fileName(key));
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic, version;
+
+    in >> magic >> version;
+
+    if (magic != FILE_MAGIC || version != FILE_VERSION) {
+        return false;
+    }
+
+    in >> entries;
+
+    if (in.status() != QDataStream::Ok) {
+        entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Snapshot the settings objects present on the board, with their
+ * metadata, replacing anything saved for it before.
+ * \return true on success
+ */
+bool ObjectCache::save(const QString &key)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    entries.clear();
+
+    for (const QVector<UAVObject *> &objs : objMngr->getObjectsView()) {
+        UAVDataObject *dobj = objs.isEmpty() ? nullptr : dynamic_cast<UAVDataObject *>(objs.first());
+
+        if (!dobj || !dobj->isSettings() || !dobj->getIsPresentOnHardware()) {
+            continue;
+        }
+
+        QList<QByteArray> instances;
+
+        // Indexed by instance ID
+        for (UAVObject *obj : objs) {
+            QByteArray data(obj->getNumBytes(), 0);
+            obj->pack(reinterpret_cast<quint8 *>(data.data()));
+            instances.append(data);
+        }
+
+        entries.insert(dobj->getObjID(), instances);
+
+        UAVMetaObject *mobj = dobj->getMetaObject();
+
+        if (mobj) {
+            QByteArray data(mobj->getNumBytes(), 0);
+            mobj->pack(reinterpret_cast<quint8 *>(data.data()));
+            entries.insert(mobj->getObjID(), QList<QByteArray>() << data);
+        }
+    }
+
+    QString name = fileName(key);
+    QDir().mkpath(QFileInfo(name).absolutePath());
+
+    QSaveFile file(name);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+
+    out << FILE_MAGIC << FILE_VERSION << entries;
+
+    return file.commit();
+}
+
+/**
+ * Restore an object from the snapshot if it matches what the board has.
+ * \param[in] objId Object to restore, data or metaobject
+ * \param[in] crc Checksum the board reported over all instances
+ * \return true if the object was restored, false if it must be fetched
+ */
+bool ObjectCache::restore(quint32 objId, quint32 crc)
+{
+    auto it = entries.constFind(objId);
+
+    if (it == entries.constEnd()) {
+        return false;
+    }
+
+    const QList<QByteArray> &instances = it.value();
+    UAVObject *first = objMngr->getObject(objId);
+
+    if (!first || instances.isEmpty()) {
+        return false;
+    }
+
+    QByteArray all;
+
+    foreach (const QByteArray &data, instances) {
+        if (data.size() != static_cast<int>(first->getNumBytes())) {
+            return false;
+        }
+
+        all.append(data);
+    }
+
+    if (checksum(all) != crc) {
+        return false;
+    }
+
+    for (int i = 0; i < instances.size(); i++) {
+        UAVObject *obj = objMngr->getObject(objId, i);
+
+        if (!obj) {
+            // Register missing instances, as a received update would
+            UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(first);
+
+            if (!dobj) {
+                return false;
+            }
+
+            UAVDataObject *instObj = dobj->clone(i);
+
+            if (!objMngr->registerObject(instObj)) {
+                return false;
+            }
+
+            obj = instObj;
+        }
+
+        obj->unpack(reinterpret_cast<const quint8 *>(instances[i].constData()));
+    }
+
+    return true;
+}
@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ *
+ * @file       objectcache.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Snapshot of a board's settings, kept between connections
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef OBJECTCACHE_H
+#define OBJECTCACHE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include "uavobjects/uavobjectmanager.h"
+
+/**
+ * Stores the settings objects received from a board, keyed by the board's
+ * CPU serial, firmware CRC and the UAVO definitions hash.  On reconnect the
+ * board sends a checksum per settings object, and objects whose checksum
+ * matches the snapshot are restored from it instead of being requested.
+ */
+class ObjectCache
+{
+public:
+    ObjectCache(UAVObjectManager *objMngr);
+
+    static QString boardKey(UAVObjectManager *objMngr);
+    static quint32 checksum(const QByteArray &data);
+
+    bool load(const QString &key);
+    bool save(const QString &key);
+    bool restore(quint32 objId, quint32 crc);
+
+private:
+    static const quint32 FILE_MAGIC = 0x4f424a43; // "OBJC"
+    static const quint32 FILE_VERSION = 1;
+
+    UAVObjectManager *objMngr;
+
+    /* Packed data of every instance of each object, in instance order */
+    QMap<quint32, QList<QByteArray>> entries;
+
+    static QString fileName(const QString &key);
+};
+
+#endif // OBJECTCACHE_H
@@ -36,7 +36,9 @@
 #include "telemetry.h"
 #include "hwtaulink.h"
 #include "objectpersistence.h"
+#include "flighttelemetrystats.h"
 #include <QTime>
+#include <QElapsedTimer>
 #include <QtGlobal>
 #include <stdlib.h>
 #include <QDebug>
@@ -103,6 +105,8 @@ Telemetry::Telemetry(UAVTalk *utalk, UAVObjectManager *objMngr)
     // Listen to transaction completions
     connect(utalk, &UAVTalk::ackReceived, this, &Telemetry::transactionSuccess);
     connect(utalk, &UAVTalk::nackReceived, this, &Telemetry::transactionFailure);
+    connect(utalk, &UAVTalk::objectDumpCompleted, this, &Telemetry::objectDumpCompleted);
+    connect(utalk, &UAVTalk::objectChecksumReceived, this, &Telemetry::objectChecksumReceived);
     // Get GCS stats object
     gcsStatsObj = GCSTelemetryStats::GetInstance(objMngr);
     // Setup and start the periodic timer
@@ -399,35 +403,65 @@ void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
     }
 }
 
+/**
+ * Ask the autopilot to stream all of its objects.  objectDumpCompleted is
+ * emitted once the last one has arrived.
+ */
+bool Telemetry::requestObjectDump(quint16 flags)
+{
+    return utalk->requestObjectDump(flags);
+}
+
 /* This is synchronous, so we use a primitive callback mechanism
  * instead of signal/slot.  Can have a future async variant if
  * necessary
+ *
+ * Several requests are kept in flight, each asking for a window of chunks.
+ * Chunks are stored by offset as they arrive, and a request whose window
+ * completes or times out with holes in it is re-issued from the first
+ * missing offset.
  */
 QByteArray *Telemetry::downloadFile(quint32 fileId, quint32 maxSize,
         std::function<void(quint32)>progressCb)
 {
-    quint32 curOffset = 0;
+    struct FileRequest {
+        quint32 offset;
+        quint32 end;
+        bool seqDone;
+        QElapsedTimer age;
+    };
+
+    FlightTelemetryStats *flightStatsObj = FlightTelemetryStats::GetInstance(objMngr);
+    bool windowed = flightStatsObj
+            && (flightStatsObj->getCapabilities() & UAVTalk::CAP_FILE_WINDOW);
+
+    /* Older firmware always answers with six 100 byte chunks */
+    quint32 chunkLen = windowed ? UAVTalk::MAX_FILE_CHUNK : 100;
+    quint32 window = windowed ? FILE_WINDOW : 6;
+    int maxInFlight = windowed ? FILE_REQS_IN_FLIGHT : 1;
 
     QByteArray *result = new QByteArray();
 
-    quint32 sizeGuess = 32 * 1024;
-
-    if (maxSize < sizeGuess) {
-        sizeGuess = maxSize;
-    }
-
     result->reserve(maxSize);
 
-    bool newReqNeeded = false;
+    QMap<quint32, quint32> chunks; // offset -> length
+    QList<FileRequest> pending;
+    quint32 fileEnd = maxSize;
+    quint32 nextOffset = 0;
+    quint32 contiguous = 0;
+    quint32 retransmits = 0;
     bool completed = false;
-    int inactivityCount = 0;
-    int failCount = 0;
+
+    QElapsedTimer transferTime;
+    QElapsedTimer lastActivity;
+    transferTime.start();
+    lastActivity.start();
 
     QEventLoop loop;
     QTimer timeStep;
 
     timeStep.setSingleShot(false);
-    timeStep.start(150);
+    timeStep.start(FILE_REQ_TIMEOUT_MS / 4);
 
     connect(&timeStep, &QTimer::timeout, &loop, &QEventLoop::quit);
 
@@ -438,60 +472,142 @@ QByteArray *Telemetry::downloadFile(quint32 fileId, quint32 maxSize,
                         return;
                     }
 
-                    if (offset != curOffset) {
-                        if (lastInSeq) {
-                            newReqNeeded = true;
-                            loop.exit();
+                    lastActivity.start();
+
+                    if (eof && (offset + dataLen < fileEnd)) {
+                        fileEnd = offset + dataLen;
+                    }
+
+                    if (offset + dataLen > fileEnd) {
+                        dataLen = (offset < fileEnd) ? (fileEnd - offset) : 0;
+                    }
+
+                    /* The flight side may clamp our chunk size */
+                    if (!eof && dataLen && dataLen < chunkLen) {
+                        chunkLen = dataLen;
+                    }
+
+                    if (dataLen && !chunks.contains(offset)) {
+                        if ((quint32)result->size() < offset + dataLen) {
+                            result->resize(offset + dataLen);
                         }
 
-                        return;
+                        memcpy(result->data() + offset, data, dataLen);
+                        chunks.insert(offset, dataLen);
                     }
 
-                    result->append((const char *) data, dataLen);
+                    for (FileRequest &req : pending) {
+                        if (offset >= req.offset && offset < req.end
+                                && (lastInSeq || eof)) {
+                            req.seqDone = true;
+                        }
+                    }
 
-                    curOffset += dataLen;
+                    quint32 oldContiguous = contiguous;
 
-                    if (eof) {
-                        completed = true;
-                        loop.exit();
-                    } else if (lastInSeq) {
-                        newReqNeeded = true;
-                        loop.exit();
+                    for (auto it = chunks.find(contiguous); it != chunks.end()
+                            && it.key() == contiguous; ++it) {
+                        contiguous += it.value();
                     }
 
-                    inactivityCount = 0;
-                    failCount = 0;
+                    if (contiguous >= fileEnd) {
+                        completed = true;
+                    }
 
-                    if (progressCb) {
-                        progressCb(curOffset);
+                    if (progressCb && contiguous != oldContiguous) {
+                        progressCb(contiguous);
                     }
+
+                    loop.exit();
                 }
             );
 
-    while (curOffset < maxSize && (!completed)) {
-        utalk->requestFile(fileId, curOffset);
+    while (!completed) {
+        /* Retire or re-issue requests.  A request is re-issued from its
+         * first hole when its window has been delivered, or it timed out.
+         */
+        for (int i = 0; i < pending.size(); ) {
+            FileRequest &req = pending[i];
+
+            quint32 end = qMin(req.end, fileEnd);
+            quint32 hole = req.offset;
+
+            auto it = chunks.lowerBound(hole);
+            while (hole < end && it != chunks.end() && it.key() == hole) {
+                hole += it.value();
+                ++it;
+            }
+
+            if (hole >= end) {
+                pending.removeAt(i);
+                continue;
+            }
+
+            if (req.seqDone || req.age.elapsed() > FILE_REQ_TIMEOUT_MS) {
+                quint32 holeEnd = (it != chunks.end()) ? qMin(it.key(), end) : end;
+                quint32 holeChunks = (holeEnd - hole + chunkLen - 1) / chunkLen;
+
+                req.offset = hole;
+                req.seqDone = false;
+                req.age.start();
+
+                if (windowed) {
+                    utalk->requestFile(fileId, hole, chunkLen,
+                                       qMin(holeChunks, window));
+                } else {
+                    utalk->requestFile(fileId, hole);
+                }
+
+                retransmits++;
+            }
+
+            i++;
+        }
+
+        while (pending.size() < maxInFlight && nextOffset < fileEnd) {
+            FileRequest req;
 
-        newReqNeeded = false;
-        inactivityCount = 0;
+            req.offset = nextOffset;
+            req.end = nextOffset + chunkLen * window;
+            req.seqDone = false;
+            req.age.start();
 
-        do {
-            if ((inactivityCount++) > 10) {
-                qDebug() << "Retrying file transfer because of inactivity";
-                failCount++;
-                break;
+            if (windowed) {
+                utalk->requestFile(fileId, nextOffset, chunkLen, window);
+            } else {
+                utalk->requestFile(fileId, nextOffset);
             }
 
-            loop.exec();
+            nextOffset = req.end;
+            pending.append(req);
+        }
 
-        } while (curOffset < maxSize && (!completed) && (!newReqNeeded));
+        if (completed || (pending.isEmpty() && nextOffset >= fileEnd)) {
+            break;
+        }
 
-        if (failCount > 5) {
+        if (lastActivity.elapsed() > FILE_IDLE_TIMEOUT_MS) {
             qDebug() << "Aborting file transfer";
             delete result;
             return NULL;
         }
+
+        loop.exec();
     }
 
+    result->resize(qMin(contiguous, fileEnd));
+
+    qint64 elapsedMs = qMax<qint64>(transferTime.elapsed(), 1);
+
+    qInfo() << QString("File %1: %2 bytes in %3 ms (%4 bytes/s, %5 retransmits, %6)")
+                       .arg(fileId)
+                       .arg(result->size())
+                       .arg(elapsedMs)
+                       .arg(result->size() * 1000 / elapsedMs)
+                       .arg(retransmits)
+                       .arg(windowed ? QString("window %1 x %2 bytes").arg(window).arg(chunkLen)
+                                     : QString("legacy requests"));
+
     return result;
 }
 
@@ -715,6 +831,9 @@ Telemetry::TelemetryStats Telemetry::getStats()
     stats.txErrors = utalkStats.txErrors + txErrors;
     stats.rxErrors = utalkStats.rxErrors;
     stats.txRetries = txRetries;
+    stats.rxBacklog = utalkStats.rxBacklog;
+    stats.rxCoalesced = utalkStats.rxCoalesced;
+    stats.rxLatencyMax = utalkStats.rxLatencyMax;
 
     txErrors = 0;
     txRetries = 0;
@@ -79,6 +79,9 @@ public:
         quint32 txErrors;
         quint32 rxErrors;
         quint32 txRetries;
+        quint32 rxBacklog;
+        quint32 rxCoalesced;
+        quint32 rxLatencyMax;
     } TelemetryStats;
 
     Telemetry(UAVTalk *utalk, UAVObjectManager *objMngr);
@@ -88,8 +91,11 @@ public:
             std::function<void(quint32)>progressCb = nullptr);
 
     void transactionTimeout(ObjectTransactionInfo *info);
+    bool requestObjectDump(quint16 flags = 0);
 
 signals:
+    void objectDumpCompleted(quint32 count);
+    void objectChecksumReceived(quint32 objId, quint32 crc);
 
 private:
     // Constants
@@ -102,6 +108,13 @@ private:
     static const int MIN_UPDATE_PERIOD_MS = 1;
     static const int MAX_QUEUE_SIZE = 20;
 
+    // File transfers: chunks per request, requests kept in flight, and
+    // how long to wait before re-requesting missing chunks or giving up
+    static const int FILE_WINDOW = 8;
+    static const int FILE_REQS_IN_FLIGHT = 4;
+    static const int FILE_REQ_TIMEOUT_MS = 600;
+    static const int FILE_IDLE_TIMEOUT_MS = 5000;
+
     // Types
     /**
      * Events generated by objects
@@ -31,6 +31,7 @@
  */
 
 #include "telemetrymonitor.h"
+#include "objectcache.h"
 #include "coreplugin/connectionmanager.h"
 #include "coreplugin/icore.h"
 #include "firmwareiapobj.h"
@@ -38,6 +39,8 @@
 // Timeout for the object fetching phase, the system will stop fetching objects and emit connected
 // after this
 #define OBJECT_RETRIEVE_TIMEOUT 20000
+// Give up on an object dump after this and fetch what's missing one by one
+#define OBJECT_DUMP_TIMEOUT 10000
 // IAP object is very important, retry if not able to get it the first time
 #define IAP_OBJECT_RETRIES 3
 
@@ -99,6 +102,7 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel)
     , tel(tel)
     , queue(decltype(queue)(queueCompare))
     , requestsInFlight(0)
+    , dumpInProgress(false)
 {
     this->connectionTimer = new QTime();
     // Get stats objects
@@ -115,6 +119,10 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel)
     connect(statsTimer, &QTimer::timeout, this, &TelemetryMonitor::processStatsUpdates);
     connect(objectRetrieveTimeout, &QTimer::timeout, this,
             &TelemetryMonitor::objectRetrieveTimeoutCB);
+    connect(tel, &Telemetry::objectDumpCompleted, this,
+            &TelemetryMonitor::objectDumpCompleted);
+    connect(tel, &Telemetry::objectChecksumReceived, this,
+            &TelemetryMonitor::objectChecksumReceived);
     statsTimer->start(STATS_CONNECT_PERIOD_MS);
 
     Core::ConnectionManager *cm = Core::ICore::instance()->connectionManager();
@@ -132,8 +140,8 @@ TelemetryMonitor::~TelemetryMonitor()
     GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
     gcsStats.Status = GCSTelemetryStats::STATUS_DISCONNECTED;
 
-    foreach (UAVObjectManager::ObjectMap map, objMngr->getObjects()) {
-        foreach (UAVObject *obj, map.values()) {
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        for (UAVObject *obj : instances) {
             UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
             if (dobj)
                 dobj->resetIsPresentOnHardware();
@@ -156,14 +164,31 @@ void TelemetryMonitor::startRetrievingObjects()
     /* Clear the queue */
     queue = decltype(queue)(queueCompare);
 
-    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
-    foreach (UAVObjectManager::ObjectMap map, objMngr->getObjects().values()) {
-        UAVObject *obj = map.first();
+    /* If the autopilot can stream everything in one go, that beats a
+     * round trip per object.  Fall back to requesting objects one at a
+     * time if the dump doesn't complete.  Settings can come as checksums,
+     * to be checked against what we cached last time.
+     */
+    FlightTelemetryStats::DataFields flightStats = flightStatsObj->getData();
+    quint16 dumpFlags = 0;
 
-        /* Enqueue everything; decide later whether to bother retrieving. */
-        queue.push(obj);
+    if (flightStats.Capabilities & UAVTalk::CAP_OBJ_CRC) {
+        dumpFlags |= UAVTalk::DUMP_SETTINGS_CRC;
+    }
+
+    dumpChecksums.clear();
+
+    if ((flightStats.Capabilities & UAVTalk::CAP_OBJ_DUMP) && tel->requestObjectDump(dumpFlags)) {
+        TELEMETRYMONITOR_QXTLOG_DEBUG(
+            QString("%0 requested object dump from the autopilot").arg(Q_FUNC_INFO));
+        dumpInProgress = true;
+        objectRetrieveTimeout->start(OBJECT_DUMP_TIMEOUT);
+        return;
     }
 
+    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
+    enqueueObjects(false);
+
     // Start retrieving
     TELEMETRYMONITOR_QXTLOG_DEBUG(
         QString(
@@ -172,6 +197,165 @@ void TelemetryMonitor::startRetrievingObjects()
     retrieveNextObject();
 }
 
+/**
+ * Queue objects to be requested from the autopilot.
+ * \param[in] unknownOnly Only queue data objects we haven't heard about
+ * yet, and their metaobjects
+ */
+void TelemetryMonitor::enqueueObjects(bool unknownOnly)
+{
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        if (instances.isEmpty()) {
+            continue;
+        }
+
+        UAVObject *obj = instances.first();
+
+        if (unknownOnly) {
+            UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+
+            if (!dobj || dobj->getPresenceKnown()) {
+                continue;
+            }
+
+            queue.push(dobj->getMetaObject());
+        }
+
+        /* Enqueue everything; decide later whether to bother retrieving. */
+        queue.push(obj);
+    }
+}
+
+/**
+ * Called when the autopilot has finished an object dump.  Anything we
+ * didn't hear about isn't on the hardware, as long as we saw as many
+ * objects as the autopilot says it sent.
+ */
+void TelemetryMonitor::objectDumpCompleted(quint32 count)
+{
+    if (!dumpInProgress) {
+        return;
+    }
+
+    dumpInProgress = false;
+
+    restoreFromCache();
+
+    quint32 seen = 0;
+    QList<UAVDataObject *> unseen;
+
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        UAVDataObject *dobj =
+            instances.isEmpty() ? nullptr : dynamic_cast<UAVDataObject *>(instances.first());
+
+        if (!dobj) {
+            continue;
+        }
+
+        if (dobj->getIsPresentOnHardware()) {
+            seen++;
+        } else if (!dobj->getPresenceKnown()) {
+            unseen.append(dobj);
+        }
+    }
+
+    objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
+
+    if (seen < count) {
+        qInfo() << QString("%0 object dump incomplete (%1 of %2 objects), requesting the rest")
+                       .arg(Q_FUNC_INFO)
+                       .arg(seen)
+                       .arg(count);
+
+        enqueueObjects(true);
+    } else {
+        foreach (UAVDataObject *dobj, unseen) {
+            dobj->setIsPresentOnHardware(false);
+        }
+
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 object dump completed (%1 objects)")
+                                          .arg(Q_FUNC_INFO)
+                                          .arg(count));
+    }
+
+    // Fetches whatever the cache couldn't provide, then reports connected
+    retrieveNextObject();
+}
+
+/**
+ * Called for each settings object the autopilot sent as a checksum
+ * during a dump.
+ */
+void TelemetryMonitor::objectChecksumReceived(quint32 objId, quint32 crc)
+{
+    if (dumpInProgress) {
+        dumpChecksums.insert(objId, crc);
+    }
+}
+
+/**
+ * Restore the settings the autopilot sent checksums for from the cached
+ * snapshot, and queue those that don't match it for retrieval.
+ */
+void TelemetryMonitor::restoreFromCache()
+{
+    if (dumpChecksums.isEmpty()) {
+        return;
+    }
+
+    ObjectCache cache(objMngr);
+    bool loaded = cache.load(ObjectCache::boardKey(objMngr));
+    int restored = 0;
+
+    for (auto it = dumpChecksums.constBegin(); it != dumpChecksums.constEnd(); ++it) {
+        if (loaded && cache.restore(it.key(), it.value())) {
+            restored++;
+            continue;
+        }
+
+        UAVObject *obj = objMngr->getObject(it.key());
+
+        if (!obj) {
+            continue;
+        }
+
+        /* The board has it, we just don't have its current contents */
+        UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
+
+        if (dobj) {
+            dobj->setIsPresentOnHardware(true);
+        }
+
+        queue.push(obj);
+    }
+
+    qInfo() << QString("%0 restored %1 of %2 settings objects from cache")
+                   .arg(Q_FUNC_INFO)
+                   .arg(restored)
+                   .arg(dumpChecksums.size());
+
+    dumpChecksums.clear();
+}
+
+/**
+ * Snapshot the board's settings, if it can later tell us which of them
+ * changed.
+ */
+void TelemetryMonitor::saveToCache()
+{
+    FlightTelemetryStats::DataFields flightStats = flightStatsObj->getData();
+
+    if (!(flightStats.Capabilities & UAVTalk::CAP_OBJ_CRC)) {
+        return;
+    }
+
+    ObjectCache cache(objMngr);
+
+    if (!cache.save(ObjectCache::boardKey(objMngr))) {
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 could not save object cache").arg(Q_FUNC_INFO));
+    }
+}
+
 /**
  * Retrieve the next object in the queue
  */
@@ -187,6 +371,7 @@ void TelemetryMonitor::retrieveNextObject()
         connectionStatus = CON_CONNECTED_MANAGED;
         emit connected();
         objectRetrieveTimeout->stop();
+        saveToCache();
         return;
     }
 
@@ -354,6 +539,18 @@ void TelemetryMonitor::flightStatsUpdated(UAVObject *obj)
 
 void TelemetryMonitor::objectRetrieveTimeoutCB()
 {
+    if (dumpInProgress) {
+        qInfo() << QString("%0 object dump timed out, requesting objects individually")
+                       .arg(Q_FUNC_INFO);
+
+        dumpInProgress = false;
+        objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
+        restoreFromCache();
+        enqueueObjects(true);
+        retrieveNextObject();
+        return;
+    }
+
     qInfo() <<
         QString("%0 reached timeout for object retrieval, clearing queue")
         .arg(Q_FUNC_INFO);
@@ -387,6 +584,9 @@ void TelemetryMonitor::processStatsUpdates()
     gcsStats.TxFailures += telStats.txErrors;
     gcsStats.TxRetries += telStats.txRetries;
 
+    // Advertise the protocol extensions we can decode
+    gcsStats.Capabilities = UAVTalk::CAP_OBJ_BATCH;
+
     // Check for a connection timeout
     bool connectionTimeout;
     if (telStats.rxObjects > 0) {
@@ -434,9 +634,17 @@ void TelemetryMonitor::processStatsUpdates()
         startRetrievingObjects();
     } else if (gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_CONNECT_PERIOD_MS);
+
+        // Catch settings changed during the session
+        if (connectionStatus == CON_CONNECTED_MANAGED) {
+            saveToCache();
+        }
+
         connectionStatus = CON_DISCONNECTED;
-        foreach (UAVObjectManager::ObjectMap map, objMngr->getObjects()) {
-            foreach (UAVObject *obj, map.values()) {
+        dumpInProgress = false;
+        objectRetrieveTimeout->stop();
+        for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+            for (UAVObject *obj : instances) {
                 UAVDataObject *dobj = dynamic_cast<UAVDataObject *>(obj);
                 if (dobj)
                     dobj->resetIsPresentOnHardware();
@@ -73,6 +73,8 @@ public slots:
     void flightStatsUpdated(UAVObject *obj);
 private slots:
     void objectRetrieveTimeoutCB();
+    void objectDumpCompleted(quint32 count);
+    void objectChecksumReceived(quint32 objId, quint32 crc);
     void newInstanceSlot(UAVObject *);
 
 private:
@@ -99,9 +101,14 @@ private:
     QTime *connectionTimer;
     QTimer *objectRetrieveTimeout;
     int requestsInFlight;
+    bool dumpInProgress;
+    QMap<quint32, quint32> dumpChecksums;
 
     void startRetrievingObjects();
+    void enqueueObjects(bool unknownOnly);
     void retrieveNextObject();
+    void restoreFromCache();
+    void saveToCache();
 };
 
 #endif // TELEMETRYMONITOR_H
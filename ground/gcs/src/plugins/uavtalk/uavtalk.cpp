@@ -33,6 +33,7 @@
  */
 
 #include "uavtalk.h"
+#include "uavtalkdecoder.h"
 #include <QtEndian>
 #include <QDebug>
 #include <extensionsystem/pluginmanager.h>
@@ -76,12 +77,14 @@ UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr, bool canBlock)
     this->objMngr = objMngr;
     this->canBlock = canBlock;
 
-    startOffset = 0;
-    filledBytes = 0;
-
     memset(&stats, 0, sizeof(ComStats));
 
+    decoder = new UAVTalkDecoder(objMngr);
+
+    connect(decoder, &UAVTalkDecoder::framesReady, this, &UAVTalk::processDecodedFrames);
     connect(io.data(), &QIODevice::readyRead, this, &UAVTalk::processInputStream);
+
+    decoder->start();
 }
 
 UAVTalk::~UAVTalk()
@@ -89,6 +92,8 @@ UAVTalk::~UAVTalk()
     // According to Qt, it is not necessary to disconnect upon
     // object deletion.
     // disconnect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
+
+    delete decoder;
 }
 
 /**
@@ -100,36 +105,48 @@ UAVTalk::ComStats UAVTalk::getStats()
 
     memset(&stats, 0, sizeof(ComStats));
 
+    decoder->takeStats(ret);
+
     return ret;
 }
 
 /**
- * Called each time there are data in the input buffer
+ * Called each time there are data in the input buffer.  The bytes are
+ * only handed to the decoder thread here, which signals back when it has
+ * complete frames.
  */
 void UAVTalk::processInputStream()
 {
-    while (io && io->isReadable()) {
-        if (startOffset > (sizeof(rxBuffer) - MAX_PACKET_LENGTH)) {
-            /* If we're not sure there's room for a frame, shift things left in
-             * the buffer so that we can do a bigger read.
-             */
-            memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
-
-            filledBytes -= startOffset;
-            startOffset = 0;
-        }
+    if (!io || !io->isReadable()) {
+        return;
+    }
 
-        int bytes = io->read(reinterpret_cast<char *>(rxBuffer + filledBytes),
-                             sizeof(rxBuffer) - filledBytes);
+    QByteArray data = io->readAll();
 
-        if (bytes <= 0) {
-            return;
-        }
+    if (data.isEmpty()) {
+        return;
+    }
 
-        filledBytes += bytes;
-        stats.rxBytes += bytes;
+    stats.rxBytes += data.size();
 
-        while (processInput());
+    decoder->pushData(data);
+}
+
+/**
+ * Act on the frames the decoder thread has checked and staged so far.
+ */
+void UAVTalk::processDecodedFrames()
+{
+    QVector<UAVTalkDecoder::Frame> frames;
+
+    decoder->takeFrames(frames);
+
+    for (UAVTalkDecoder::Frame &frame : frames) {
+        quint32 latency = (decoder->elapsedNs() - frame.received) / 1000;
+
+        stats.rxLatencyMax = qMax(stats.rxLatencyMax, latency);
+
+        receiveFrame(frame.type, frame.objId, frame.instId, frame.data);
     }
 }
 
@@ -207,137 +224,52 @@ bool UAVTalk::receiveFileChunk(quint32 fileId, quint8 *data, quint32 length)
 }
 
 /**
- * Process a frame from input, if available.
- * \return False if there was insufficient data for a frame, true if trying
- * again is worthwhile.
+ * Process a frame that passed the framing and length checks.
+ * \param type Type of received frame
+ * \param objId Object ID field of the frame
+ * \param instId Instance ID, for object frames
+ * \param data Payload, after any instance ID
  */
-bool UAVTalk::processInput()
+void UAVTalk::receiveFrame(quint8 type, quint32 objId, quint16 instId, QByteArray &data)
 {
-    unsigned int bytesAvail = filledBytes - startOffset;
+    quint8 *payload = reinterpret_cast<quint8 *>(data.data());
+    quint32 payloadBytes = data.size();
 
-    if (bytesAvail < sizeof(UAVTalkHeader)) {
-        return false;
-    }
-
-    UAVTalkHeader *hdr = reinterpret_cast<UAVTalkHeader *>(rxBuffer + startOffset);
-
-    /* Basic framing checks.  If these fail, skip forward one byte and retry
-     * to capture stream sync.
-     */
-    if (hdr->sync != SYNC_VAL) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if ((hdr->type & VER_MASK) != TYPE_VER) {
-        startOffset++;
-        stats.rxErrors++;
-
-        return true;
-    }
-
-    if (hdr->size < sizeof(UAVTalkHeader)) {
-        startOffset++;
-        stats.rxErrors++;
+    if (type == TYPE_FILEDATA) {
+        receiveFileChunk(objId, payload, payloadBytes);
 
-        return true;
+        return;
     }
 
-    /* OK, let's ensure we have enough bytes for the whole frame.
-     * Size doesn't include CRC, so add one.
-     */
-
-    if ((hdr->size + 1u) > bytesAvail) {
-        return false;
-    }
-
-    quint8 ourCrc = updateCRC(0, rxBuffer + startOffset, hdr->size);
-    quint8 *theirCrc = rxBuffer + startOffset + hdr->size;
-
-    if (ourCrc != *theirCrc) {
-        /* Since we can't trust hdr->size for sure, we should just skip
-         * forward one byte.
-         */
-
-        startOffset++;
-        stats.rxErrors++;
+    if (type == TYPE_OBJ_CRC) {
+        for (unsigned int i = 0; i < payloadBytes; i += 8) {
+            emit objectChecksumReceived(qFromLittleEndian<quint32>(payload + i),
+                                        qFromLittleEndian<quint32>(payload + i + 4));
+        }
 
-        return true;
+        return;
     }
 
-    quint8 *payload = rxBuffer + startOffset + sizeof(*hdr);
-    unsigned int payloadBytes = hdr->size - sizeof(*hdr);
-
-    /* At this point, we'll advance startOffset for the entire length of
-     * frame, and not touch startOffset again this function!
-     */
-    startOffset += hdr->size + 1;
-
-    /* OK, we have a complete frame as encoded on the wire.  Time to do things
-     * with it.
-     */
-    quint8 rxType = hdr->type & TYPE_MASK;
+    if (type == TYPE_OBJ_DUMP) {
+        /* End of a dump; the object ID field holds the object count */
+        emit objectDumpCompleted(objId);
 
-    quint32 rxObjId = qFromLittleEndian(hdr->objId);
-
-    if (rxType == TYPE_FILEDATA) {
-        return receiveFileChunk(rxObjId, payload, payloadBytes);
+        return;
     }
 
-    UAVObject *rxObj = objMngr->getObject(rxObjId);
-
-    if (rxObj == nullptr) {
+    if (objMngr->getObject(objId) == nullptr) {
         stats.rxErrors++;
         UAVTALK_QXTLOG_DEBUG("UAVTalk: unknown object");
 
-        if (rxType == TYPE_OBJ_REQ || rxType == TYPE_OBJ_ACK) {
+        if (type == TYPE_OBJ_REQ || type == TYPE_OBJ_ACK) {
             UAVTALK_QXTLOG_DEBUG("UAVTalk: (transmitting NACK)");
-            transmitNack(rxObjId);
-        }
-
-        return true;
-    }
-
-    quint16 rxInstId = 0;
-
-    if (!rxObj->isSingleInstance()) {
-        if ((rxType != TYPE_NACK) || (payloadBytes == 2)) {
-            /* Receiving the instid is optional on an nack-- can just mean
-             * "nack everything" */
-            rxInstId = *(payload++);
-            rxInstId |= *(payload++) << 8;
-
-            payloadBytes -= 2;
-        }
-    }
-
-    /* XXX timestamps */
-
-    // Check data length
-    if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
-        if (payloadBytes != 0) {
-            UAVTALK_QXTLOG_DEBUG("UAVTalk: Unexpected data in req/ack/nack");
-            stats.rxErrors++;
-
-            return true;
+            transmitNack(objId);
         }
-    } else {
-        if (payloadBytes != rxObj->getNumBytes()) {
-            UAVTALK_QXTLOG_DEBUG("UAVTalk: Unexpected payload size for obj");
-            stats.rxErrors++;
 
-            return true;
-        }
+        return;
     }
 
-    receiveObject(rxType, rxObjId, rxInstId, payload, payloadBytes);
-    stats.rxObjectBytes += payloadBytes;
-    stats.rxObjects++;
-
-    // Done
-    return true;
+    receiveObject(type, objId, instId, payload, payloadBytes);
 }
 
 /**
@@ -606,8 +538,13 @@ bool UAVTalk::transmitFrame(quint32 length, bool incrTxObj)
  * Send a request for file data.
  * \param[in] fileId The file id to request.
  * \param[in] offset The first requested chunk of the file.
+ * \param[in] chunkLen Bytes per data message, or 0 for the legacy request
+ * format.  Only use nonzero values when the remote end advertises
+ * CAP_FILE_WINDOW.
+ * \param[in] window Number of data messages to send before waiting for the
+ * next request.
  */
-bool UAVTalk::requestFile(quint32 fileId, quint32 offset)
+bool UAVTalk::requestFile(quint32 fileId, quint32 offset, quint8 chunkLen, quint8 window)
 {
     txBuffer[0] = SYNC_VAL;
     txBuffer[1] = TYPE_VER | TYPE_FILEREQ;
@@ -618,7 +555,30 @@ bool UAVTalk::requestFile(quint32 fileId, quint32 offset)
 
     // qDebug() << "Sent file req offs=" << offset;
 
-    return transmitFrame(14);
+    if (chunkLen == 0) {
+        return transmitFrame(14);
+    }
+
+    txBuffer[14] = chunkLen;
+    txBuffer[15] = window;
+
+    return transmitFrame(16);
+}
+
+/**
+ * Ask the remote end to send every object it has, all instances and
+ * metadata, followed by a completion marker.  Only use this when the
+ * remote end advertises CAP_OBJ_DUMP.
+ * \param[in] flags DUMP_* flags; DUMP_SETTINGS_CRC needs CAP_OBJ_CRC.
+ */
+bool UAVTalk::requestObjectDump(quint16 flags)
+{
+    txBuffer[0] = SYNC_VAL;
+    txBuffer[1] = TYPE_VER | TYPE_OBJ_DUMP;
+    // The flags go where the object ID normally would
+    qToLittleEndian<quint32>(flags, &txBuffer[4]);
+
+    return transmitFrame(8, false);
 }
 
 /**
@@ -43,6 +43,8 @@
 #include "uavtalk_global.h"
 #include <QtNetwork/QUdpSocket>
 
+class UAVTalkDecoder;
+
 class UAVTALK_EXPORT UAVTalk : public QObject
 {
     Q_OBJECT
@@ -58,18 +60,32 @@ public:
         quint32 txObjects;
         quint32 txErrors;
         quint32 rxErrors;
+        quint32 rxBacklog; // Most decoded frames waiting for the GUI thread
+        quint32 rxCoalesced; // Object updates replaced by newer ones before use
+        quint32 rxLatencyMax; // Longest time from receipt to use, in us
     };
 
+    // Protocol capabilities, advertised in the telemetry stats objects
+    static const quint32 CAP_OBJ_BATCH = 0x00000001; // Can decode batch frames
+    static const quint32 CAP_FILE_WINDOW = 0x00000002; // Honours window/chunk size in file requests
+    static const quint32 CAP_OBJ_DUMP = 0x00000004; // Answers object dump requests
+    static const quint32 CAP_OBJ_CRC = 0x00000008; // Can send settings as checksums in a dump
+
+    // Object dump request flags
+    static const quint16 DUMP_SETTINGS_CRC = 0x0001; // Send settings as checksums, not data
+
+    // Largest file chunk that fits in one frame
+    static const int MAX_FILE_CHUNK = 242;
+
     UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr, bool canBlock = true);
     ~UAVTalk();
     bool sendObject(UAVObject *obj, bool acked, bool allInstances);
     bool sendObjectRequest(UAVObject *obj, bool allInstances);
-    bool requestFile(quint32 fileId, quint32 offset);
+    bool requestFile(quint32 fileId, quint32 offset, quint8 chunkLen = 0, quint8 window = 0);
+    bool requestObjectDump(quint16 flags = 0);
 
     ComStats getStats();
 
-    bool processInput();
-
 signals:
     // The only signals we send to the upper level are when we
     // either receive an ACK or a NACK for a request.
@@ -80,10 +96,17 @@ signals:
     void fileDataReceived(quint32 fileId, quint32 offset, quint8 *data,
             quint32 dataLen, bool eof, bool lastInSeq);
 
+    // Or when the remote end has sent everything we asked for in a dump
+    void objectDumpCompleted(quint32 count);
+    void objectChecksumReceived(quint32 objId, quint32 crc);
+
 private slots:
     void processInputStream(void);
+    void processDecodedFrames(void);
 
 protected:
+    friend class UAVTalkDecoder;
+
     // Constants
     static const int VER_MASK = 0x70;
     static const int TYPE_MASK = 0x0f;
@@ -94,6 +117,9 @@ protected:
     static const int TYPE_OBJ_ACK = 0x02;
     static const int TYPE_ACK = 0x03;
     static const int TYPE_NACK = 0x04;
+    static const int TYPE_OBJ_BATCH = 0x05;
+    static const int TYPE_OBJ_DUMP = 0x06;
+    static const int TYPE_OBJ_CRC = 0x07;
     static const int TYPE_FILEREQ = 0x08;
     static const int TYPE_FILEDATA = 0x09;
 
@@ -127,6 +153,13 @@ protected:
         quint8 flags;
     };
 
+    // Header of each object carried in a batch frame, followed by its data
+    struct UAVTalkBatchRecord {
+        quint32 objId;
+        quint16 instId;
+        quint8 length;
+    };
+
     static const quint8 FILEDATA_FLAG_EOF = 0x01;
     static const quint8 FILEDATA_FLAG_LAST = 0x02;
 #pragma pack(pop)
@@ -136,15 +169,10 @@ protected:
     UAVObjectManager *objMngr;
     bool canBlock;
 
-    // This is a tradeoff between the frequency of the need to
-    // compact/copy left and buffer size.
-    quint8 rxBuffer[MAX_PACKET_LENGTH * 12];
     quint8 txBuffer[MAX_PACKET_LENGTH];
 
-    // Variables used by the receive state machine
-
-    quint32 startOffset;
-    quint32 filledBytes;
+    // Framing and CRC checks happen on this thread
+    UAVTalkDecoder *decoder;
 
     ComStats stats;
 
@@ -153,11 +181,12 @@ protected:
     bool receiveObject(quint8 type, quint32 objId, quint16 instId,
             quint8 *data, quint32 length);
     bool receiveFileChunk(quint32 fileId, quint8 *data, quint32 length);
+    void receiveFrame(quint8 type, quint32 objId, quint16 instId, QByteArray &data);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject *obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject *obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
+    static quint8 updateCRC(quint8 crc, const quint8 *data, qint32 length);
     bool transmitFrame(quint32 length, bool incrTxObj = true);
 };
 
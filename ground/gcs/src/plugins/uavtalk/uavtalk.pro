@@ -16,12 +16,16 @@ HEADERS += uavtalk.h \
     telemetrymonitor.h \
     telemetrymanager.h \
     uavtalk_global.h \
-    telemetry.h
+    telemetry.h \
+    objectcache.h \
+    uavtalkdecoder.h
 
 SOURCES += uavtalk.cpp \
     uavtalkplugin.cpp \
     telemetrymonitor.cpp \
     telemetrymanager.cpp \
-    telemetry.cpp
+    telemetry.cpp \
+    objectcache.cpp \
+    uavtalkdecoder.cpp
 
 OTHER_FILES += UAVTalk.pluginspec
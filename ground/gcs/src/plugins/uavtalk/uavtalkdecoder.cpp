@@ -0,0 +1,383 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalkdecoder.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Decodes received UAVTalk frames away from the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "uavtalkdecoder.h"
+#include <QtEndian>
+#include <QDebug>
+
+#define SYNC_VAL 0x3C
+
+UAVTalkDecoder::UAVTalkDecoder(UAVObjectManager *objMngr)
+    : inputReceived(0)
+    , running(true)
+    , coalescing(true)
+    , startOffset(0)
+    , filledBytes(0)
+{
+    for (const QVector<UAVObject *> &instances : objMngr->getObjectsView()) {
+        if (instances.isEmpty()) {
+            continue;
+        }
+
+        UAVObject *obj = instances.first();
+        ObjectType type = { obj->getNumBytes(), obj->isSingleInstance() };
+
+        types.insert(obj->getObjID(), type);
+    }
+
+    memset(&outputStats, 0, sizeof(outputStats));
+
+    clock.start();
+}
+
+UAVTalkDecoder::~UAVTalkDecoder()
+{
+    stop();
+
+    if (wait(10000) == false)
+        qWarning() << "Cannot terminate UAVTalkDecoder";
+}
+
+void UAVTalkDecoder::stop()
+{
+    QMutexLocker lock(&inputMtx);
+
+    running = false;
+    inputReady.wakeAll();
+}
+
+void UAVTalkDecoder::pushData(const QByteArray &data)
+{
+    QMutexLocker lock(&inputMtx);
+
+    if (input.isEmpty()) {
+        inputReceived = elapsedNs();
+    }
+
+    input.append(data);
+    inputReady.wakeAll();
+}
+
+void UAVTalkDecoder::takeFrames(QVector<Frame> &frames)
+{
+    QMutexLocker lock(&outputMtx);
+
+    frames.clear();
+    frames.swap(output);
+    queuedObjects.clear();
+}
+
+void UAVTalkDecoder::takeStats(UAVTalk::ComStats &stats)
+{
+    QMutexLocker lock(&outputMtx);
+
+    stats.rxObjectBytes += outputStats.rxObjectBytes;
+    stats.rxObjects += outputStats.rxObjects;
+    stats.rxErrors += outputStats.rxErrors;
+    stats.rxCoalesced += outputStats.rxCoalesced;
+    stats.rxBacklog = qMax(stats.rxBacklog, outputStats.rxBacklog);
+
+    memset(&outputStats, 0, sizeof(outputStats));
+
+    // Start the next peak from what is still waiting now
+    outputStats.rxBacklog = output.size();
+}
+
+void UAVTalkDecoder::run()
+{
+    forever {
+        QByteArray data;
+        qint64 received;
+
+        {
+            QMutexLocker lock(&inputMtx);
+
+            while (running && input.isEmpty()) {
+                inputReady.wait(&inputMtx);
+            }
+
+            if (!running) {
+                return;
+            }
+
+            data.swap(input);
+            received = inputReceived;
+        }
+
+        decode(data.constData(), data.size(), received);
+    }
+}
+
+void UAVTalkDecoder::decode(const char *data, int size, qint64 received)
+{
+    int consumed = 0;
+
+    while (consumed < size) {
+        if (startOffset > (sizeof(rxBuffer) - UAVTalk::MAX_PACKET_LENGTH)) {
+            /* If we're not sure there's room for a frame, shift things
+             * left in the buffer so that we can copy more in.
+             */
+            memmove(rxBuffer, rxBuffer + startOffset, filledBytes - startOffset);
+
+            filledBytes -= startOffset;
+            startOffset = 0;
+        }
+
+        int bytes = qMin(size - consumed, static_cast<int>(sizeof(rxBuffer) - filledBytes));
+
+        memcpy(rxBuffer + filledBytes, data + consumed, bytes);
+
+        filledBytes += bytes;
+        consumed += bytes;
+
+        while (decodeFrame(received));
+    }
+}
+
+/**
+ * Decode a frame from the buffer, if available.
+ * \return False if there was insufficient data for a frame, true if trying
+ * again is worthwhile.
+ */
+bool UAVTalkDecoder::decodeFrame(qint64 received)
+{
+    unsigned int bytesAvail = filledBytes - startOffset;
+
+    if (bytesAvail < sizeof(UAVTalk::UAVTalkHeader)) {
+        return false;
+    }
+
+    UAVTalk::UAVTalkHeader *hdr =
+        reinterpret_cast<UAVTalk::UAVTalkHeader *>(rxBuffer + startOffset);
+
+    /* Basic framing checks.  If these fail, skip forward one byte and retry
+     * to capture stream sync.
+     */
+    if (hdr->sync != SYNC_VAL || (hdr->type & UAVTalk::VER_MASK) != UAVTalk::TYPE_VER
+        || hdr->size < sizeof(UAVTalk::UAVTalkHeader)) {
+        startOffset++;
+        countError();
+
+        return true;
+    }
+
+    /* OK, let's ensure we have enough bytes for the whole frame.
+     * Size doesn't include CRC, so add one.
+     */
+    if ((hdr->size + 1u) > bytesAvail) {
+        return false;
+    }
+
+    quint8 ourCrc = UAVTalk::updateCRC(0, rxBuffer + startOffset, hdr->size);
+    quint8 *theirCrc = rxBuffer + startOffset + hdr->size;
+
+    if (ourCrc != *theirCrc) {
+        /* Since we can't trust hdr->size for sure, we should just skip
+         * forward one byte.
+         */
+        startOffset++;
+        countError();
+
+        return true;
+    }
+
+    const quint8 *payload = rxBuffer + startOffset + sizeof(*hdr);
+    unsigned int payloadBytes = hdr->size - sizeof(*hdr);
+
+    /* At this point, we'll advance startOffset for the entire length of
+     * frame, and not touch startOffset again this function!
+     */
+    startOffset += hdr->size + 1;
+
+    quint8 rxType = hdr->type & UAVTalk::TYPE_MASK;
+    quint32 rxObjId = qFromLittleEndian(hdr->objId);
+
+    switch (rxType) {
+    case UAVTalk::TYPE_OBJ_BATCH:
+        /* The object ID field holds the record count */
+        decodeBatch(rxObjId, payload, payloadBytes, received);
+        return true;
+    case UAVTalk::TYPE_OBJ_CRC:
+        /* The object ID field holds the record count; each record is an
+         * object ID and the CRC32 of all its instances.
+         */
+        if ((rxObjId & 0xff) * 8 != payloadBytes) {
+            countError();
+            return true;
+        }
+        // fall through
+    case UAVTalk::TYPE_FILEDATA:
+    case UAVTalk::TYPE_OBJ_DUMP:
+        queueFrame(rxType, rxObjId, 0, payload, payloadBytes, received);
+        return true;
+    }
+
+    auto type = types.constFind(rxObjId);
+
+    if (type == types.constEnd()) {
+        if (rxType == UAVTalk::TYPE_OBJ_REQ || rxType == UAVTalk::TYPE_OBJ_ACK) {
+            /* The GUI thread counts these, as it must NACK them */
+            queueFrame(rxType, rxObjId, 0, nullptr, 0, received);
+        } else {
+            countError();
+        }
+
+        return true;
+    }
+
+    quint16 rxInstId = 0;
+
+    if (!type->singleInstance) {
+        if ((rxType != UAVTalk::TYPE_NACK) || (payloadBytes == 2)) {
+            /* Receiving the instid is optional on an nack-- can just mean
+             * "nack everything" */
+            if (payloadBytes < 2) {
+                countError();
+                return true;
+            }
+
+            rxInstId = qFromLittleEndian<quint16>(payload);
+
+            payload += 2;
+            payloadBytes -= 2;
+        }
+    }
+
+    // Check data length
+    if (rxType == UAVTalk::TYPE_OBJ_REQ || rxType == UAVTalk::TYPE_ACK
+        || rxType == UAVTalk::TYPE_NACK) {
+        if (payloadBytes != 0) {
+            countError();
+            return true;
+        }
+    } else if (payloadBytes != type->numBytes) {
+        countError();
+        return true;
+    }
+
+    queueFrame(rxType, rxObjId, rxInstId, payload, payloadBytes, received);
+
+    return true;
+}
+
+/**
+ * Split a frame carrying several object updates into one update per object.
+ * \param count The number of records the sender put in the frame
+ * \param data Buffer to the first record
+ * \param length Number of bytes of records
+ */
+void UAVTalkDecoder::decodeBatch(quint32 count, const quint8 *data, quint32 length,
+                                 qint64 received)
+{
+    quint32 records = 0;
+
+    while (length >= sizeof(UAVTalk::UAVTalkBatchRecord)) {
+        const UAVTalk::UAVTalkBatchRecord *rec =
+            reinterpret_cast<const UAVTalk::UAVTalkBatchRecord *>(data);
+
+        quint32 objId = qFromLittleEndian(rec->objId);
+        quint16 instId = qFromLittleEndian(rec->instId);
+        quint32 objLength = rec->length;
+
+        data += sizeof(*rec);
+        length -= sizeof(*rec);
+
+        if (objLength > length) {
+            break;
+        }
+
+        auto type = types.constFind(objId);
+
+        if (type == types.constEnd() || objLength != type->numBytes) {
+            countError();
+        } else {
+            queueFrame(UAVTalk::TYPE_OBJ, objId, instId, data, objLength, received);
+        }
+
+        data += objLength;
+        length -= objLength;
+        records++;
+    }
+
+    if (length != 0 || records != count) {
+        countError();
+    }
+}
+
+/**
+ * Hand a decoded frame to the GUI thread.  A plain object update replaces
+ * any update of the same instance that is still waiting.
+ */
+void UAVTalkDecoder::queueFrame(quint8 type, quint32 objId, quint16 instId, const quint8 *data,
+                                quint32 length, qint64 received)
+{
+    QByteArray payload(reinterpret_cast<const char *>(data), length);
+    quint64 key = (static_cast<quint64>(objId) << 16) | instId;
+    bool isObject = type <= UAVTalk::TYPE_NACK && types.contains(objId);
+
+    QMutexLocker lock(&outputMtx);
+
+    if (isObject) {
+        outputStats.rxObjects++;
+        outputStats.rxObjectBytes += length;
+    }
+
+    if (type == UAVTalk::TYPE_OBJ && coalescing) {
+        auto queued = queuedObjects.constFind(key);
+
+        if (queued != queuedObjects.constEnd()) {
+            // Keep the original time, to report how stale the object got
+            output[queued.value()].data = payload;
+            outputStats.rxCoalesced++;
+
+            return;
+        }
+    } else if (type == UAVTalk::TYPE_OBJ_ACK) {
+        // Later updates must not be applied before this one
+        queuedObjects.remove(key);
+    }
+
+    Frame frame = { type, objId, instId, payload, received };
+    bool wasEmpty = output.isEmpty();
+
+    if (type == UAVTalk::TYPE_OBJ && coalescing) {
+        queuedObjects.insert(key, output.size());
+    }
+
+    output.append(frame);
+    outputStats.rxBacklog = qMax(outputStats.rxBacklog, static_cast<quint32>(output.size()));
+
+    if (wasEmpty) {
+        emit framesReady();
+    }
+}
+
+void UAVTalkDecoder::countError()
+{
+    QMutexLocker lock(&outputMtx);
+
+    outputStats.rxErrors++;
+}
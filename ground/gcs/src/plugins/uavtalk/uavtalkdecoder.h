@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavtalkdecoder.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2018
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Decodes received UAVTalk frames away from the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef UAVTALKDECODER_H
+#define UAVTALKDECODER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include "uavtalk.h"
+
+/**
+ * Thread that does the framing and CRC checks for a UAVTalk link, and
+ * copies the payload of each good frame into a staging queue that the GUI
+ * thread drains.  Object updates still waiting in the queue are replaced by
+ * newer updates of the same instance, so a busy GUI thread only ever sees
+ * the latest data instead of falling further behind.
+ *
+ * Unpacking into the UAVObjects stays on the GUI thread, which owns them.
+ */
+class UAVTALK_EXPORT UAVTalkDecoder : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Frame
+    {
+        quint8 type;
+        quint32 objId;
+        quint16 instId;
+        QByteArray data;
+        qint64 received; // When the bytes were handed to us, see elapsedNs() and decode()
+
+        /** An object update, as opposed to a request, ack or file data */
+        bool isObjectUpdate() const
+        {
+            return type == UAVTalk::TYPE_OBJ || type == UAVTalk::TYPE_OBJ_ACK;
+        }
+    };
+
+    UAVTalkDecoder(UAVObjectManager *objMngr);
+    virtual ~UAVTalkDecoder();
+
+    /** Queue received bytes for decoding without waiting */
+    void pushData(const QByteArray &data);
+
+    /**
+     * Decode bytes on the calling thread, for a decoder whose thread was
+     * never started.  Used to read logs as fast as possible.
+     */
+    void decode(const char *data, int size, qint64 received);
+
+    /** Whether queued object updates are replaced by newer ones */
+    void setCoalescing(bool enabled) { coalescing = enabled; }
+
+    /** Take the frames decoded so far, oldest first */
+    void takeFrames(QVector<Frame> &frames);
+
+    /** Add our counters to stats and reset them */
+    void takeStats(UAVTalk::ComStats &stats);
+
+    qint64 elapsedNs() const { return clock.nsecsElapsed(); }
+
+    void stop();
+
+signals:
+    void framesReady();
+
+protected:
+    void run();
+
+private:
+    struct ObjectType
+    {
+        quint32 numBytes;
+        bool singleInstance;
+    };
+
+    /* Object definitions are fixed once the object manager is populated;
+     * keep our own copy so that we never touch it from this thread.
+     */
+    QHash<quint32, ObjectType> types;
+
+    QElapsedTimer clock;
+
+    /** Raw bytes not yet decoded, and when the oldest of them arrived */
+    QByteArray input;
+    qint64 inputReceived;
+    bool running;
+    QMutex inputMtx;
+    QWaitCondition inputReady;
+
+    /** Decoded frames, and the position of each queued object update */
+    QVector<Frame> output;
+    QHash<quint64, int> queuedObjects;
+    bool coalescing;
+    UAVTalk::ComStats outputStats;
+    QMutex outputMtx;
+
+    // Only touched by the decoder thread
+    quint8 rxBuffer[UAVTalk::MAX_PACKET_LENGTH * 12];
+    quint32 startOffset;
+    quint32 filledBytes;
+
+    bool decodeFrame(qint64 received);
+    void decodeBatch(quint32 count, const quint8 *data, quint32 length, qint64 received);
+    void queueFrame(quint8 type, quint32 objId, quint16 instId, const quint8 *data,
+                    quint32 length, qint64 received);
+    void countError();
+};
+
+#endif // UAVTALKDECODER_H
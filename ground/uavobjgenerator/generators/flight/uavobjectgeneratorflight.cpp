@@ -162,6 +162,15 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo *info)
     }
     outInclude.replace(QString("$(DATAFIELDS)"), fields);
 
+    // Replace the $(FIELDOFFSETS) tag
+    QString fieldOffsets;
+    for (int n = 0; n < info->fields.length(); ++n) {
+        fieldOffsets.append(
+            QString("\toffsetof(%1Data, %2),\r\n").arg(info->name).arg(info->fields[n]->name));
+    }
+    fieldOffsets.append(QString("\tsizeof(%1Data)").arg(info->name));
+    outCode.replace(QString("$(FIELDOFFSETS)"), fieldOffsets);
+
     // Replace the $(DATAFIELDINFO) tag
     QString enums;
     for (int n = 0; n < info->fields.length(); ++n) {
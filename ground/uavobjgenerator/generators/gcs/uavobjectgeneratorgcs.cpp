@@ -130,11 +130,19 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
 
     outInclude.replace(QString("$(PARENT_INCLUDES)"), parentIncludes);
 
-    // Replace the $(DATAFIELDS) tag
+    // Replace the $(DATAFIELDS) tag, and check that the compiler lays the
+    // fields out as they are packed on the wire, so pack/unpack can copy
+    // the whole struct
     QString type;
     QString fields;
+    QString offsetChecks;
+    int offset = 0;
     for (int n = 0; n < info->fields.length(); ++n)
     {
+        offsetChecks.append( QString("static_assert(offsetof(%1::DataFields, %2) == %3, \"%2 must be at its wire offset\");\n")
+                             .arg(info->name).arg(info->fields[n]->name).arg(offset) );
+        offset += info->fields[n]->numBytes * info->fields[n]->numElements;
+
         // Determine type
         type = fieldTypeStrCPP[info->fields[n]->type];
         // Append field
@@ -149,6 +157,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
         }
     }
     outInclude.replace(QString("$(DATAFIELDS)"), fields);
+    outCode.replace(QString("$(DATAFIELDOFFSETCHECKS)"), offsetChecks);
 
     // Replace $(PROPERTIES) and related tags
     QString properties;
@@ -157,7 +166,6 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
     QString propertySetters;
     QString propertyNotifications;
     QString propertyNotificationsImpl;
-    QString fieldDescriptionsStrings;
 
     //to avoid name conflicts
     QStringList reservedProperties;
@@ -273,12 +281,10 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
         propertiesImpl +=
                         QString("QString %1::get%2_Description() const\n"
                                 "{\n"
-                                "   return FIELD_DESCRIPTIONS[\"%2\"];\n"
+                                "   return QStringLiteral(\"%3\");\n"
                                 "}\n")
-                        .arg(info->name).arg(field->name);
-        fieldDescriptionsStrings += 
-                        QString("    {\"%1\", \"%2\"},\n")
-                        .arg(field->name).arg(escape_raw_string(field->description));
+                        .arg(info->name).arg(field->name)
+                        .arg(escape_raw_string(field->description));
     }
 
     outInclude.replace(QString("$(PROPERTIES)"), properties);
@@ -288,37 +294,43 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
 
     outCode.replace(QString("$(PROPERTIES_IMPL)"), propertiesImpl);
     outCode.replace(QString("$(NOTIFY_PROPERTIES_CHANGED)"), propertyNotificationsImpl);
-    outCode.replace(QString("$(FIELDDESCRIPTIONS_STRINGS)"), fieldDescriptionsStrings);
 
-    // Replace the $(FIELDSINIT) tag
+    // Replace the $(FIELDSINIT) tag.  The name, option and index lists are
+    // built once per object type and shared by all instances; descriptions
+    // are literals, so neither needs any work per instance.
     QString finit;
     for (int n = 0; n < info->fields.length(); ++n)
     {
         // Setup element names
         QString varElemName = info->fields[n]->name + "ElemNames";
-        finit.append( QString("    QStringList %1;\n").arg(varElemName) );
+        finit.append( QString("    static const QStringList %1 = { ").arg(varElemName) );
         QStringList elemNames = info->fields[n]->elementNames;
         for (int m = 0; m < elemNames.length(); ++m) {
-            finit.append( QString("    %1.append(\"%2\");\n")
-                          .arg(varElemName)
+            finit.append( QString("%1QStringLiteral(\"%2\")")
+                          .arg(QString(m ? ", " : ""))
                           .arg(elemNames[m]) );
         }
+        finit.append(" };\n");
+
+        // Appended rather than passed to arg(), as descriptions may hold '%'
+        const QString description = "QStringLiteral(\"" +
+                escape_raw_string(info->fields[n]->description) + "\")";
 
         // Only for enum types
         if (info->fields[n]->type == FIELDTYPE_ENUM) {
             // Form list of enum names
-            finit.append( QString("    QStringList %1EnumOptions = { ")
+            finit.append( QString("    static const QStringList %1EnumOptions = { ")
                           .arg( info->fields[n]->name) );
 
             QStringList options = info->fields[n]->options;
             for (int m = 0; m < options.length(); ++m)
             {
-                finit.append( QString("%1\"%2\"")
+                finit.append( QString("%1QStringLiteral(\"%2\")")
                               .arg(QString(m ? ", " : ""))
                               .arg(options[m]) );
             }
 
-            finit.append("};\n");
+            finit.append(" };\n");
 #if 0
             /* Perhaps use this type in the future, when gcs cleaned up */
             finit.append( QString("    QList<%1Options> %2EnumIndices = { ")
@@ -326,7 +338,7 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
                         .arg( info->fields[n]->name ) );
 #endif
 
-            finit.append( QString("    QList<int> %2EnumIndices = { ")
+            finit.append( QString("    static const QList<int> %2EnumIndices = { ")
                         .arg( info->fields[n]->name ) );
 
             // Form list of enum values, because they may not be contiguous
@@ -342,25 +354,29 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
 
             const QString defaultValuesInit = "\"" + info->fields[n]->defaultValues.join("\",\"") + "\"";
 
-            finit.append( QString("    fields.append( new UAVObjectField(QString(\"%1\"), QString(\"%2\"), UAVObjectField::ENUM, %3, %4, %5, QString(\"%6\"), FIELD_DESCRIPTIONS[\"%1\"], QList<QVariant>({%7})));\n")
+            finit.append( QString("    fields.append( new UAVObjectField(QString(\"%1\"), QString(\"%2\"), UAVObjectField::ENUM, %3, %4, %5, QString(\"%6\"), ")
                           .arg(info->fields[n]->name)
                           .arg(info->fields[n]->units)
                           .arg(varElemName)
                           .arg(info->fields[n]->name + "EnumOptions")
                           .arg(info->fields[n]->name + "EnumIndices")
                           .arg(info->fields[n]->limitValues)
+                          + description +
+                          QString(", QList<QVariant>({%1})));\n")
                           .arg(defaultValuesInit));
         }
         // For all other types
         else {
             const QString defaultValuesInit = info->fields[n]->defaultValues.join(',');
 
-            finit.append( QString("    fields.append( new UAVObjectField(QString(\"%1\"), QString(\"%2\"), UAVObjectField::%3, %4, QStringList(), QList<int>(), QString(\"%5\"), FIELD_DESCRIPTIONS[\"%1\"], QList<QVariant>({%7}), UAVObjectField::%8));\n")
+            finit.append( QString("    fields.append( new UAVObjectField(QString(\"%1\"), QString(\"%2\"), UAVObjectField::%3, %4, QStringList(), QList<int>(), QString(\"%5\"), ")
                           .arg(info->fields[n]->name)
                           .arg(info->fields[n]->units)
                           .arg(fieldTypeStrCPPClass[info->fields[n]->type])
                           .arg(varElemName)
                           .arg(info->fields[n]->limitValues)
+                          + description +
+                          QString(", QList<QVariant>({%1}), UAVObjectField::%2));\n")
                           .arg(defaultValuesInit)
                           .arg(displayTypeStrCPPClass[info->fields[n]->display]));
         }